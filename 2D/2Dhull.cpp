@@ -1,187 +1,261 @@
 ﻿#include "2Dhull.hpp"
 
 #include <algorithm>
+#include <array>
+#include <exception>
+#include <future>
+#include <span>
 
 #include <clipper2/clipper.h>
 
+#include "base/thread_pool.hpp"
+
 namespace HsBa::Slicer
 {
-	static double CrossProduct(const Point2& o, const Point2& a, const Point2& b)
+	namespace
 	{
-		return Clipper2Lib::CrossProduct(a - o, b - o);
-	}
-
-	static double CrossProductD(const Point2D& o, const Point2D& a, const Point2D& b)
-	{
-		return Clipper2Lib::CrossProduct(a - o, b - o);
-	}
+		// points per task for the parallel hull, smaller inputs are done in one go
+		constexpr size_t HULL_CHUNK_POINTS = 1 << 16;
 
-	static bool CmpFromAngleDistance(const Point2& left, const Point2& right)
-	{
-		double cp = Clipper2Lib::CrossProduct(left, right);
-		if (cp == 0) {
-			return (left.x * left.x + left.y * left.y) < (right.x * right.x + right.y * right.y);
+		template <typename Point>
+		double TurnCross(const Point& o, const Point& a, const Point& b)
+		{
+			return (static_cast<double>(a.x) - o.x) * (static_cast<double>(b.y) - o.y) -
+				(static_cast<double>(a.y) - o.y) * (static_cast<double>(b.x) - o.x);
 		}
-		return cp > 0;
-	}
 
-	static bool CmpFromAngleDistanceD(const Point2D& left, const Point2D& right)
-	{
-		double cp = Clipper2Lib::CrossProduct(left, right);
-		if (cp == 0) {
-			return (left.x * left.x + left.y * left.y) < (right.x * right.x + right.y * right.y);
+		// Andrew's monotone chain, sorts points in place
+		template <typename Path>
+		Path MonotoneChain(Path& points)
+		{
+			using Point = typename Path::value_type;
+			std::sort(points.begin(), points.end(), [](const Point& l, const Point& r) {
+				return l.x < r.x || (l.x == r.x && l.y < r.y);
+				});
+			points.erase(std::unique(points.begin(), points.end()), points.end());
+			if (points.size() < 3) return points;
+			Path hull(2 * points.size());
+			size_t k = 0;
+			for (const auto& p : points)
+			{
+				while (k >= 2 && TurnCross(hull[k - 2], hull[k - 1], p) <= 0) --k;
+				hull[k++] = p;
+			}
+			for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;)
+			{
+				while (k >= lower && TurnCross(hull[k - 2], hull[k - 1], points[i]) <= 0) --k;
+				hull[k++] = points[i];
+			}
+			// the last point repeats the first
+			hull.resize(k - 1);
+			return hull;
 		}
-		return cp > 0;
-	}
 
-	Polygon ConcaveHullSimulation(const Polygon& polygon, int numAdditionalPoints)
-	{
+		// Akl-Toussaint: points strictly inside the octagon of the extreme points in the
+		// axis and diagonal directions can't be on the hull
+		template <typename Point>
+		class OctagonFilter
+		{
+		public:
+			void Extend(const Point& p)
+			{
+				const double x = static_cast<double>(p.x), y = static_cast<double>(p.y);
+				const double key[8] = { x, x + y, y, y - x, -x, -x - y, -y, x - y };
+				for (int d = 0; d < 8; ++d)
+				{
+					if (!valid_ || key[d] > best_[d])
+					{
+						best_[d] = key[d];
+						extreme_[d] = p;
+					}
+				}
+				valid_ = true;
+			}
 
-		auto convexHullPoints = ConvexHull(polygon);
+			// counter-clockwise octagon, degenerate corners repeat
+			bool Inside(const Point& p) const
+			{
+				if (!valid_) return false;
+				for (int d = 0; d < 8; ++d)
+				{
+					const auto& a = extreme_[d];
+					const auto& b = extreme_[(d + 1) % 8];
+					if (a == b) continue;
+					if (TurnCross(a, b, p) <= 0) return false;
+				}
+				return true;
+			}
 
-		auto& concaveHullPoints = convexHullPoints;
+			void AppendExtremes(std::vector<Point>& out) const
+			{
+				if (valid_) out.insert(out.end(), extreme_.begin(), extreme_.end());
+			}
 
-		for (size_t i = 0; i != convexHullPoints.size(); ++i) {
-			size_t j = (i + 1) % convexHullPoints.size();
+		private:
+			bool valid_ = false;
+			std::array<double, 8> best_{};
+			std::array<Point, 8> extreme_{};
+		};
 
-			double length = std::sqrt(std::pow(convexHullPoints[j].x - convexHullPoints[i].x, 2) +
-				std::pow(convexHullPoints[j].y - convexHullPoints[i].y, 2));
+		struct Range
+		{
+			size_t path, begin, end;
+		};
 
-			for (int k = 1; k <= numAdditionalPoints; ++k) {
-				double t = static_cast<double>(k) / (numAdditionalPoints + 1);
-				Point2 newPoint(convexHullPoints[i].x + t * (convexHullPoints[j].x - convexHullPoints[i].x),
-					convexHullPoints[i].y + t * (convexHullPoints[j].y - convexHullPoints[i].y));
-				concaveHullPoints.push_back(newPoint);
-			}
+		template <typename Path>
+		Path HullOfRanges(const std::vector<Path>& paths, std::span<const Range> ranges, const Path* extra)
+		{
+			using Point = typename Path::value_type;
+			OctagonFilter<Point> filter;
+			for (const auto& r : ranges)
+				for (size_t i = r.begin; i < r.end; ++i) filter.Extend(paths[r.path][i]);
+			if (extra)
+				for (const auto& p : *extra) filter.Extend(p);
+			Path candidates;
+			filter.AppendExtremes(candidates);
+			for (const auto& r : ranges)
+				for (size_t i = r.begin; i < r.end; ++i)
+					if (!filter.Inside(paths[r.path][i])) candidates.push_back(paths[r.path][i]);
+			if (extra)
+				for (const auto& p : *extra)
+					if (!filter.Inside(p)) candidates.push_back(p);
+			return MonotoneChain(candidates);
 		}
 
-		return concaveHullPoints;
-	}
-	Polygon ConvexHull(const Polygon& polygon)
-	{
-		size_t size = polygon.size();
-		if (size <= 3)
+		template <typename Path>
+		Path ConvexHullImpl(const std::vector<Path>& paths, ThreadPool* pool, const Path* extra = nullptr)
 		{
-			return polygon;
-		}
-		Polygon points = polygon;
-		size_t minIndex = 0;
-		for (size_t i = 1; i != size; ++i) {
-			if (points[i].y < points[minIndex].y ||
-				(points[i].y == points[minIndex].y && points[i].x < points[minIndex].x)) {
-				minIndex = i;
+			// cut the nested paths into ranges of about HULL_CHUNK_POINTS points
+			std::vector<Range> ranges;
+			std::vector<size_t> chunkEnds;
+			size_t inChunk = 0;
+			for (size_t p = 0; p < paths.size(); ++p)
+			{
+				for (size_t begin = 0; begin < paths[p].size();)
+				{
+					size_t end = std::min(paths[p].size(), begin + (HULL_CHUNK_POINTS - inChunk));
+					ranges.push_back({ p, begin, end });
+					inChunk += end - begin;
+					begin = end;
+					if (inChunk == HULL_CHUNK_POINTS)
+					{
+						chunkEnds.push_back(ranges.size());
+						inChunk = 0;
+					}
+				}
 			}
-		}
-		std::swap(points[0], points[minIndex]);
-
+			if (inChunk > 0) chunkEnds.push_back(ranges.size());
+			const std::span<const Range> all{ ranges };
+			if (pool == nullptr || chunkEnds.size() < 2)
+				return HullOfRanges(paths, all, extra);
 
-		std::sort(points.begin() + 1, points.end(), CmpFromAngleDistance);
+			// reduce: hull of every chunk in parallel, then the hull of those hulls
+			std::vector<Path> partial(chunkEnds.size());
+			std::vector<std::future<void>> futures;
+			futures.reserve(chunkEnds.size());
+			for (size_t c = 0; c < chunkEnds.size(); ++c)
+			{
+				const size_t from = c == 0 ? 0 : chunkEnds[c - 1];
+				futures.emplace_back(pool->submit([&, c, from]() {
+					partial[c] = HullOfRanges(paths, all.subspan(from, chunkEnds[c] - from), static_cast<const Path*>(nullptr));
+					}));
+			}
+			std::exception_ptr error;
+			for (auto& f : futures)
+			{
+				try { f.get(); }
+				catch (...) { if (!error) error = std::current_exception(); }
+			}
+			if (error) std::rethrow_exception(error);
+			return ConvexHullImpl(partial, nullptr, extra);
+		}
 
+		template <typename Path>
+		Path ConvexHullOfPath(const Path& polygon)
+		{
+			if (polygon.size() <= 3) return polygon;
+			return ConvexHullImpl(std::vector<Path>{}, nullptr, &polygon);
+		}
 
-		Polygon hull;
-		hull.push_back(points[0]);
-		hull.push_back(points[1]);
-		for (int i = 2; i != size; ++i) {
-			while (hull.size() > 1 && CrossProduct(hull[hull.size() - 2], hull.back(), points[i]) <= 0) {
-				hull.pop_back();
+		// the convex hull with numAdditionalPoints evenly spaced points inserted on every edge
+		template <typename Path>
+		Path DensifyHull(const Path& hull, int numAdditionalPoints)
+		{
+			using Point = typename Path::value_type;
+			if (numAdditionalPoints <= 0 || hull.size() < 2) return hull;
+			Path res;
+			res.reserve(hull.size() * (static_cast<size_t>(numAdditionalPoints) + 1));
+			for (size_t i = 0; i != hull.size(); ++i)
+			{
+				const auto& a = hull[i];
+				const auto& b = hull[(i + 1) % hull.size()];
+				res.push_back(a);
+				for (int k = 1; k <= numAdditionalPoints; ++k)
+				{
+					double t = static_cast<double>(k) / (numAdditionalPoints + 1);
+					res.push_back(Point(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)));
+				}
 			}
-			hull.emplace_back(points[i]);
+			return res;
 		}
+	} // namespace
 
-		return hull;
+	Polygon ConcaveHullSimulation(const Polygon& polygon, int numAdditionalPoints)
+	{
+		return DensifyHull(ConvexHull(polygon), numAdditionalPoints);
+	}
+	Polygon ConvexHull(const Polygon& polygon)
+	{
+		return ConvexHullOfPath(polygon);
 	}
 
 	Polygon ConcaveHullSimulation(const Polygons& polygons, int numAdditionalPoints)
 	{
-		Polygon points_set;
-		for (const auto& poly : polygons)
-		{
-			points_set.insert(points_set.end(), poly.begin(), poly.end());
-		}
-		return ConcaveHullSimulation(points_set, numAdditionalPoints);
+		return DensifyHull(ConvexHull(polygons), numAdditionalPoints);
 	}
-	Polygon ConvexHull(const Polygons& polygons)
+	Polygon ConvexHull(const Polygons& polygons, ThreadPool* pool)
 	{
-		Polygon points_set;
-		for (const auto& poly : polygons)
-		{
-			points_set.insert(points_set.end(), poly.begin(), poly.end());
-		}
-		return ConvexHull(points_set);
+		return ConvexHullImpl(polygons, pool);
 	}
 
 	PolygonD ConcaveHullSimulation(const PolygonD& polygon, int numAdditionalPoints)
 	{
-		auto convexHullPoints = ConvexHull(polygon);
-
-		auto& concaveHullPoints = convexHullPoints;
-
-		for (size_t i = 0; i != convexHullPoints.size(); ++i) {
-			size_t j = (i + 1) % convexHullPoints.size();
-
-			double length = std::sqrt(std::pow(convexHullPoints[j].x - convexHullPoints[i].x, 2) +
-				std::pow(convexHullPoints[j].y - convexHullPoints[i].y, 2));
-
-			for (int k = 1; k <= numAdditionalPoints; ++k) {
-				double t = static_cast<double>(k) / (numAdditionalPoints + 1);
-				Point2D newPoint(convexHullPoints[i].x + t * (convexHullPoints[j].x - convexHullPoints[i].x),
-					convexHullPoints[i].y + t * (convexHullPoints[j].y - convexHullPoints[i].y));
-				concaveHullPoints.emplace_back(newPoint);
-			}
-		}
-
-		return concaveHullPoints;
+		return DensifyHull(ConvexHull(polygon), numAdditionalPoints);
 	}
 	PolygonD ConvexHull(const PolygonD& polygon)
 	{
-		size_t size = polygon.size();
-		if (size <= 3)
-		{
-			return polygon;
-		}
-		PolygonD points = polygon;
-		size_t minIndex = 0;
-		for (size_t i = 1; i != size; ++i) {
-			if (points[i].y < points[minIndex].y ||
-				(points[i].y == points[minIndex].y && points[i].x < points[minIndex].x)) {
-				minIndex = i;
-			}
-		}
-		std::swap(points[0], points[minIndex]);
-
-
-		std::sort(points.begin() + 1, points.end(), CmpFromAngleDistanceD);
-
+		return ConvexHullOfPath(polygon);
+	}
 
-		PolygonD hull;
-		hull.push_back(points[0]);
-		hull.push_back(points[1]);
-		for (int i = 2; i != size; ++i) {
-			while (hull.size() > 1 && CrossProductD(hull[hull.size() - 2], hull.back(), points[i]) <= 0) {
-				hull.pop_back();
-			}
-			hull.push_back(points[i]);
-		}
+	PolygonD ConcaveHullSimulation(const PolygonsD& polygons, int numAdditionalPoints)
+	{
+		return DensifyHull(ConvexHull(polygons), numAdditionalPoints);
+	}
+	PolygonD ConvexHull(const PolygonsD& polygons, ThreadPool* pool)
+	{
+		return ConvexHullImpl(polygons, pool);
+	}
 
-		return hull;
+	template <typename Path>
+	void BasicHullAccumulator<Path>::Add(const Path& path)
+	{
+		Path merged = hull_;
+		merged.insert(merged.end(), path.begin(), path.end());
+		hull_ = ConvexHullImpl(std::vector<Path>{}, nullptr, &merged);
 	}
 
-	PolygonD ConcaveHullSimulation(const PolygonsD& polygons, int numAdditionalPoints)
+	template <typename Path>
+	void BasicHullAccumulator<Path>::Add(const std::vector<Path>& paths)
 	{
-		PolygonD points_set;
-		for (const auto& poly : polygons)
-		{
-			points_set.insert(points_set.end(), poly.begin(), poly.end());
-		}
-		return ConcaveHullSimulation(points_set, numAdditionalPoints);
+		hull_ = ConvexHullImpl(paths, nullptr, &hull_);
 	}
-	PolygonD ConvexHull(const PolygonsD& polygons)
+
+	template <typename Path>
+	void BasicHullAccumulator<Path>::Merge(const BasicHullAccumulator& other)
 	{
-		PolygonD points_set;
-		for (const auto& poly : polygons)
-		{
-			points_set.insert(points_set.end(), poly.begin(), poly.end());
-		}
-		return ConvexHull(points_set);
+		Add(other.hull_);
 	}
-}// namespace HsBa::Slicer
\ No newline at end of file
+
+	template class BasicHullAccumulator<Polygon>;
+	template class BasicHullAccumulator<PolygonD>;
+}// namespace HsBa::Slicer
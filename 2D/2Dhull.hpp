@@ -2,19 +2,51 @@
 #ifndef HSBA_SLICER_2DHULL_HPP
 #define HSBA_SLICER_2DHULL_HPP
 
+#include <cstddef>
+
 #include "IntPolygon.hpp"
 #include "FloatPolygons.hpp"
 
 namespace HsBa::Slicer
 {
+	class ThreadPool;
+
+	// convex hulls are counter-clockwise without collinear points (Andrew's monotone chain).
+	// For Polygons the points are read in place: a single pass drops the points inside the
+	// octagon of extreme points before the sort. With a pool large inputs are split into
+	// chunks whose hulls are merged
 	Polygon ConcaveHullSimulation(const Polygon& polygon, int numAdditionalPoints);
 	Polygon ConvexHull(const Polygon& polygon);
 	Polygon ConcaveHullSimulation(const Polygons& polygons, int numAdditionalPoints);
-    Polygon ConvexHull(const Polygons& polygons);
+	Polygon ConvexHull(const Polygons& polygons, ThreadPool* pool = nullptr);
 
 	PolygonD ConcaveHullSimulation(const PolygonD& polygon, int numAdditionalPoints);
 	PolygonD ConvexHull(const PolygonD& polygon);
 	PolygonD ConcaveHullSimulation(const PolygonsD& polygons, int numAdditionalPoints);
-	PolygonD ConvexHull(const PolygonsD& polygons);
+	PolygonD ConvexHull(const PolygonsD& polygons, ThreadPool* pool = nullptr);
+
+	// running convex hull, e.g. the envelope of all layers of a part seen from above.
+	// only the current hull is kept between calls
+	template <typename Path>
+	class BasicHullAccumulator
+	{
+	public:
+		void Add(const Path& path);
+		void Add(const std::vector<Path>& paths);
+		void Merge(const BasicHullAccumulator& other);
+		const Path& Hull() const noexcept
+		{
+			return hull_;
+		}
+		void Clear() noexcept
+		{
+			hull_.clear();
+		}
+	private:
+		Path hull_;
+	};
+
+	using HullAccumulator = BasicHullAccumulator<Polygon>;
+	using HullAccumulatorD = BasicHullAccumulator<PolygonD>;
 }// namespace HsBa::Slicer
 #endif // !HSBA_SLICER_2DHULL_HPP
@@ -0,0 +1,183 @@
+﻿#include "BoundedPolygons.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace HsBa::Slicer
+{
+	void BoundedPolygons::EnsureCache() const
+	{
+		if (valid_) return;
+		pathBounds_.clear();
+		pathAreas_.clear();
+		pathBounds_.reserve(polys_->size());
+		pathAreas_.reserve(polys_->size());
+		constexpr auto maxv = std::numeric_limits<int64_t>::max();
+		constexpr auto minv = std::numeric_limits<int64_t>::lowest();
+		Rect2 total{ maxv, maxv, minv, minv };
+		area_ = 0;
+		for (const auto& path : *polys_)
+		{
+			Rect2 box{ maxv, maxv, minv, minv };
+			for (const auto& pt : path)
+			{
+				box.left = std::min(box.left, pt.x);
+				box.top = std::min(box.top, pt.y);
+				box.right = std::max(box.right, pt.x);
+				box.bottom = std::max(box.bottom, pt.y);
+			}
+			if (path.empty()) box = Rect2{ 0, 0, 0, 0 };
+			else
+			{
+				total.left = std::min(total.left, box.left);
+				total.top = std::min(total.top, box.top);
+				total.right = std::max(total.right, box.right);
+				total.bottom = std::max(total.bottom, box.bottom);
+			}
+			double a = Clipper2Lib::Area(path);
+			area_ += a;
+			pathBounds_.push_back(box);
+			pathAreas_.push_back(a);
+		}
+		bounds_ = total.left > total.right ? Rect2{ 0, 0, 0, 0 } : total;
+#ifndef NDEBUG
+		stampData_ = polys_->data();
+		pathStamps_.clear();
+		for (const auto& path : *polys_)
+			pathStamps_.emplace_back(path.data(), path.size());
+#endif
+		valid_ = true;
+	}
+
+	void BoundedPolygons::CheckStamp() const
+	{
+#ifndef NDEBUG
+		assert(stampData_ == polys_->data() && pathStamps_.size() == polys_->size()
+			&& "BoundedPolygons: paths changed without Refresh()");
+		for (size_t i = 0; i < pathStamps_.size(); ++i)
+			CheckStamp(i);
+#endif
+	}
+
+	void BoundedPolygons::CheckStamp([[maybe_unused]] size_t i) const
+	{
+#ifndef NDEBUG
+		assert(pathStamps_.size() == polys_->size() && (i >= pathStamps_.size()
+			|| pathStamps_[i] == std::pair{ (*polys_)[i].data(), (*polys_)[i].size() })
+			&& "BoundedPolygons: paths changed without Refresh()");
+#endif
+	}
+
+	const Rect2& BoundedPolygons::Bounds() const
+	{
+		EnsureCache();
+		CheckStamp();
+		return bounds_;
+	}
+	const Rect2& BoundedPolygons::PathBounds(size_t i) const
+	{
+		EnsureCache();
+		CheckStamp(i);
+		return pathBounds_.at(i);
+	}
+	double BoundedPolygons::Area() const
+	{
+		EnsureCache();
+		CheckStamp();
+		return area_;
+	}
+	double BoundedPolygons::PathArea(size_t i) const
+	{
+		EnsureCache();
+		CheckStamp(i);
+		return pathAreas_.at(i);
+	}
+
+	std::vector<size_t> PathsNear(const BoundedPolygons& polys, const Rect2& box)
+	{
+		std::vector<size_t> res;
+		for (size_t i = 0; i < polys.size(); ++i)
+		{
+			if (BoundsOverlap(polys.PathBounds(i), box))
+				res.push_back(i);
+		}
+		return res;
+	}
+
+	namespace
+	{
+		bool Disjoint(const BoundedPolygons& left, const BoundedPolygons& right)
+		{
+			return left.empty() || right.empty() || !BoundsOverlap(left.Bounds(), right.Bounds());
+		}
+
+		// the paths of polys near box. All of them are usually near, then they go to Clipper as they
+		// are; otherwise they are gathered into a per-thread buffer whose paths keep their capacity
+		const Polygons& Near(const BoundedPolygons& polys, const Rect2& box, Polygons& buffer)
+		{
+			size_t count = 0;
+			for (size_t i = 0; i < polys.size(); ++i)
+			{
+				if (BoundsOverlap(polys.PathBounds(i), box)) ++count;
+			}
+			if (count == polys.size()) return polys.Paths();
+			buffer.resize(count);
+			for (size_t i = 0, k = 0; i < polys.size(); ++i)
+			{
+				if (BoundsOverlap(polys.PathBounds(i), box))
+					buffer[k++].assign(polys[i].begin(), polys[i].end());
+			}
+			return buffer;
+		}
+
+		Polygons& NearBuffer(size_t which)
+		{
+			thread_local Polygons buffers[2];
+			return buffers[which];
+		}
+
+		Polygons Concat(const Polygons& left, const Polygons& right)
+		{
+			Polygons res;
+			res.reserve(left.size() + right.size());
+			res.insert(res.end(), left.begin(), left.end());
+			res.insert(res.end(), right.begin(), right.end());
+			return res;
+		}
+	}
+
+	Polygons Union(const BoundedPolygons& left, const BoundedPolygons& right, Clipper2Lib::FillRule fill_rule)
+	{
+		if (Disjoint(left, right))
+			return Concat(left.Paths(), right.Paths());
+		return Slicer::Union(left.Paths(), right.Paths(), fill_rule);
+	}
+	Polygons Intersection(const BoundedPolygons& left, const BoundedPolygons& right, Clipper2Lib::FillRule fill_rule)
+	{
+		if (Disjoint(left, right))
+			return {};
+		// only the common box matters for an intersection
+		return Slicer::Intersection(Near(left, right.Bounds(), NearBuffer(0)), Near(right, left.Bounds(), NearBuffer(1)), fill_rule);
+	}
+	Polygons Difference(const BoundedPolygons& left, const BoundedPolygons& right, Clipper2Lib::FillRule fill_rule)
+	{
+		if (Disjoint(left, right))
+			return left.Paths();
+		return Slicer::Difference(left.Paths(), Near(right, left.Bounds(), NearBuffer(1)), fill_rule);
+	}
+	Polygons Xor(const BoundedPolygons& left, const BoundedPolygons& right, Clipper2Lib::FillRule fill_rule)
+	{
+		if (Disjoint(left, right))
+			return Concat(left.Paths(), right.Paths());
+		return Slicer::Xor(left.Paths(), right.Paths(), fill_rule);
+	}
+
+	Clipper2Lib::PointInPolygonResult PointInPolygons(const Point2& point, const BoundedPolygons& polys, bool isEvenOdd)
+	{
+		const auto& box = polys.Bounds();
+		if (polys.empty() || point.x < box.left || point.x > box.right || point.y < box.top || point.y > box.bottom)
+			return Clipper2Lib::PointInPolygonResult::IsOutside;
+		return Slicer::PointInPolygons(point, polys.Paths(), isEvenOdd);
+	}
+}// namespace HsBa::Slicer
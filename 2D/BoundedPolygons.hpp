@@ -0,0 +1,86 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_BOUNDEDPOLYGONS_HPP
+#define HSBA_SLICER_BOUNDEDPOLYGONS_HPP
+
+#include <utility>
+#include <vector>
+
+#include "IntPolygon.hpp"
+
+namespace HsBa::Slicer
+{
+	using Rect2 = Clipper2Lib::Rect64;
+
+	// true if the boxes share at least one point, touching boxes count as overlapping
+	// since a union of touching polygons still has to merge them
+	inline bool BoundsOverlap(const Rect2& a, const Rect2& b) noexcept
+	{
+		return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+	}
+
+	// non-owning view of Polygons with lazily cached per-path and aggregate bounds, signed areas
+	// and orientation. The viewed paths must outlive the view; call Refresh() after changing them.
+	// Debug builds assert in the accessors that no path was added, removed or resized since the
+	// cache was built
+	class BoundedPolygons
+	{
+	public:
+		explicit BoundedPolygons(const Polygons& polys) noexcept : polys_(&polys) {}
+		BoundedPolygons(Polygons&&) = delete;
+
+		const Polygons& Paths() const noexcept { return *polys_; }
+		// drops the cache, e.g. after the viewed paths were edited
+		void Refresh() noexcept { valid_ = false; }
+		bool empty() const noexcept { return polys_->empty(); }
+		size_t size() const noexcept { return polys_->size(); }
+		const Polygon& operator[](size_t i) const { return (*polys_)[i]; }
+
+		// aggregate bounds, empty Rect2 when there are no points
+		const Rect2& Bounds() const;
+		const Rect2& PathBounds(size_t i) const;
+		double Area() const;
+		double PathArea(size_t i) const;
+		bool IsPositive(size_t i) const { return PathArea(i) > 0; }
+	private:
+		void EnsureCache() const;
+		// asserts that the cache still matches the viewed paths, all of them or path i
+		void CheckStamp() const;
+		void CheckStamp(size_t i) const;
+
+		const Polygons* polys_;
+		mutable bool valid_ = false;
+		mutable Rect2 bounds_{ 0, 0, 0, 0 };
+		mutable double area_ = 0;
+		mutable std::vector<Rect2> pathBounds_;
+		mutable std::vector<double> pathAreas_;
+#ifndef NDEBUG
+		// storage and size of each path when the cache was built
+		mutable const Polygon* stampData_ = nullptr;
+		mutable std::vector<std::pair<const Point2*, size_t>> pathStamps_;
+#endif
+	};
+
+	// indices of the paths of polys whose bounds overlap box; paths outside box can't change
+	// the region inside it under either fill rule
+	std::vector<size_t> PathsNear(const BoundedPolygons& polys, const Rect2& box);
+
+	// boolean operations that avoid Clipper when the operands' bounds don't overlap, and drop
+	// clip paths that can't touch the subject. Disjoint operands are returned as they are,
+	// without being re-normalized by Clipper
+	Polygons Union(const BoundedPolygons& left, const BoundedPolygons& right,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
+	);
+	Polygons Intersection(const BoundedPolygons& left, const BoundedPolygons& right,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
+	);
+	Polygons Difference(const BoundedPolygons& left, const BoundedPolygons& right,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
+	);
+	Polygons Xor(const BoundedPolygons& left, const BoundedPolygons& right,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
+	);
+
+	Clipper2Lib::PointInPolygonResult PointInPolygons(const Point2& point, const BoundedPolygons& polys, bool isEvenOdd = true);
+}// namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_BOUNDEDPOLYGONS_HPP
@@ -0,0 +1,137 @@
+﻿#include "FillCache.hpp"
+
+#include <boost/container_hash/hash.hpp>
+
+#include "base/error.hpp"
+
+namespace HsBa::Slicer
+{
+	FillCache::FillCache(size_t capacity) : capacity_(capacity)
+	{
+		if (capacity_ == 0)
+			throw InvalidArgumentError("FillCache capacity must be greater than 0");
+	}
+
+	size_t FillCache::HashKey(const Key& key)
+	{
+		size_t seed = std::hash<Polygons>{}(key.poly);
+		boost::hash_combine(seed, static_cast<int>(key.kind));
+		for (auto p : key.params)
+			boost::hash_combine(seed, p);
+		for (auto o : key.options)
+			boost::hash_combine(seed, o);
+		return seed;
+	}
+
+	Polygons FillCache::GetOrCompute(Key key, const std::function<Polygons()>& compute)
+	{
+		const size_t hash = HashKey(key);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto [first, last] = index_.equal_range(hash);
+			for (auto it = first; it != last; ++it)
+			{
+				if (it->second->key == key)
+				{
+					lru_.splice(lru_.begin(), lru_, it->second);
+					++stats_.hits;
+					return it->second->value;
+				}
+			}
+			++stats_.misses;
+		}
+
+		Polygons value = compute();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		// another thread may have filled the same contour meanwhile
+		auto [first, last] = index_.equal_range(hash);
+		for (auto it = first; it != last; ++it)
+		{
+			if (it->second->key == key)
+				return value;
+		}
+		lru_.push_front(Entry{ hash, std::move(key), value });
+		index_.emplace(hash, lru_.begin());
+		while (lru_.size() > capacity_)
+		{
+			auto& victim = lru_.back();
+			auto [vfirst, vlast] = index_.equal_range(victim.hash);
+			for (auto it = vfirst; it != vlast; ++it)
+			{
+				if (it->second == std::prev(lru_.end()))
+				{
+					index_.erase(it);
+					break;
+				}
+			}
+			lru_.pop_back();
+			++stats_.evictions;
+		}
+		return value;
+	}
+
+	Polygons FillCache::OffsetFill(const Polygons& poly, double spacing, Clipper2Lib::JoinType join_type)
+	{
+		return GetOrCompute(Key{ FillKind::Offset, { spacing }, { static_cast<int>(join_type) }, poly },
+			[&]() { return Slicer::OffsetFill(poly, spacing, join_type); });
+	}
+
+	Polygons FillCache::LineFill(const Polygons& poly, double spacing, double angle_deg, double lineThickness)
+	{
+		return GetOrCompute(Key{ FillKind::Line, { spacing, angle_deg, lineThickness }, {}, poly },
+			[&]() { return Slicer::LineFill(poly, spacing, angle_deg, lineThickness); });
+	}
+
+	Polygons FillCache::SimpleZigzagFill(const Polygons& poly, double spacing, double angle_deg, double lineThickness)
+	{
+		return GetOrCompute(Key{ FillKind::SimpleZigzag, { spacing, angle_deg, lineThickness }, {}, poly },
+			[&]() { return Slicer::SimpleZigzagFill(poly, spacing, angle_deg, lineThickness); });
+	}
+
+	Polygons FillCache::ZigzagFill(const Polygons& poly, double spacing, double angle_deg, double lineThickness)
+	{
+		return GetOrCompute(Key{ FillKind::Zigzag, { spacing, angle_deg, lineThickness }, {}, poly },
+			[&]() { return Slicer::ZigzagFill(poly, spacing, angle_deg, lineThickness); });
+	}
+
+	Polygons FillCache::CompositeOffsetFill(const Polygons& poly, double spacing,
+		double offsetStep, int outwardCount, int inwardCount, FillMode mode,
+		double angle_deg, double lineThickness, Clipper2Lib::JoinType join_type)
+	{
+		return GetOrCompute(Key{ FillKind::CompositeOffset, { spacing, offsetStep, angle_deg, lineThickness },
+			{ outwardCount, inwardCount, static_cast<int>(mode), static_cast<int>(join_type) }, poly },
+			[&]() {
+				return Slicer::CompositeOffsetFill(poly, spacing, offsetStep, outwardCount, inwardCount,
+					mode, angle_deg, lineThickness, join_type);
+			});
+	}
+
+	Polygons FillCache::HybridFill(const Polygons& poly, double spacing,
+		double offsetStep, int outwardCount, int inwardCount, FillMode mode,
+		double angle_deg, double lineThickness, Clipper2Lib::JoinType join_type)
+	{
+		return GetOrCompute(Key{ FillKind::Hybrid, { spacing, offsetStep, angle_deg, lineThickness },
+			{ outwardCount, inwardCount, static_cast<int>(mode), static_cast<int>(join_type) }, poly },
+			[&]() {
+				return Slicer::HybridFill(poly, spacing, offsetStep, outwardCount, inwardCount,
+					mode, angle_deg, lineThickness, join_type);
+			});
+	}
+
+	FillCacheStats FillCache::Stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		FillCacheStats stats = stats_;
+		stats.entries = lru_.size();
+		return stats;
+	}
+
+	void FillCache::Clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		lru_.clear();
+		index_.clear();
+		stats_ = FillCacheStats{};
+	}
+}// namespace HsBa::Slicer
@@ -0,0 +1,99 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_FILLCACHE_HPP
+#define HSBA_SLICER_FILLCACHE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "PolygonFill.hpp"
+
+namespace HsBa::Slicer
+{
+	struct FillCacheStats
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+		size_t entries = 0;
+
+		double HitRate() const
+		{
+			auto total = hits + misses;
+			return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+		}
+	};
+
+	// Bounded LRU cache in front of the fill functions. Entries are keyed by the hash of the
+	// contour and the fill parameters; a hit is only returned if the stored contour and
+	// parameters compare equal, so hash collisions can't leak a wrong fill.
+	// All member functions are thread-safe, fills are computed outside the lock.
+	class FillCache
+	{
+	public:
+		explicit FillCache(size_t capacity = 256);
+
+		FillCache(const FillCache&) = delete;
+		FillCache& operator=(const FillCache&) = delete;
+
+		Polygons OffsetFill(const Polygons& poly, double spacing,
+			Clipper2Lib::JoinType join_type = Clipper2Lib::JoinType::Square);
+
+		Polygons LineFill(const Polygons& poly, double spacing, double angle_deg,
+			double lineThickness = 0.5);
+
+		Polygons SimpleZigzagFill(const Polygons& poly, double spacing, double angle_deg,
+			double lineThickness = 0.5);
+
+		Polygons ZigzagFill(const Polygons& poly, double spacing, double angle_deg,
+			double lineThickness = 0.5);
+
+		Polygons CompositeOffsetFill(const Polygons& poly, double spacing,
+			double offsetStep, int outwardCount, int inwardCount, FillMode mode,
+			double angle_deg, double lineThickness = 0.5,
+			Clipper2Lib::JoinType join_type = Clipper2Lib::JoinType::Square);
+
+		Polygons HybridFill(const Polygons& poly, double spacing,
+			double offsetStep, int outwardCount, int inwardCount, FillMode mode,
+			double angle_deg, double lineThickness = 0.5,
+			Clipper2Lib::JoinType join_type = Clipper2Lib::JoinType::Square);
+
+		FillCacheStats Stats() const;
+		size_t Capacity() const noexcept { return capacity_; }
+		void Clear();
+	private:
+		enum class FillKind { Offset, Line, SimpleZigzag, Zigzag, CompositeOffset, Hybrid };
+
+		struct Key
+		{
+			FillKind kind;
+			std::vector<double> params;
+			std::vector<int> options;
+			Polygons poly;
+
+			bool operator==(const Key& other) const = default;
+		};
+
+		struct Entry
+		{
+			size_t hash;
+			Key key;
+			Polygons value;
+		};
+
+		static size_t HashKey(const Key& key);
+		Polygons GetOrCompute(Key key, const std::function<Polygons()>& compute);
+
+		size_t capacity_;
+		mutable std::mutex mutex_;
+		// most recently used at the front
+		std::list<Entry> lru_;
+		std::unordered_multimap<size_t, std::list<Entry>::iterator> index_;
+		FillCacheStats stats_;
+	};
+}// namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_FILLCACHE_HPP
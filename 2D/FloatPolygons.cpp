@@ -1,14 +1,97 @@
 ﻿#include "FloatPolygons.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <boost/container_hash/hash.hpp>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
 #include <string_view>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HSBA_CONVERT_SSE2
+#endif
+
 namespace HsBa::Slicer
 {
+	namespace
+	{
+		// points are read as flat coordinate arrays when they are exactly an x, y pair
+		constexpr bool FLAT_POINTS = sizeof(Point2) == 2 * sizeof(int64_t) && sizeof(Point2D) == 2 * sizeof(double) &&
+			offsetof(Point2, y) == sizeof(int64_t) && offsetof(Point2D, y) == sizeof(double);
+
+		inline int64_t ScaleRound(double v)
+		{
+			return static_cast<int64_t>(std::round(v * integerization));
+		}
+
+		// n coordinates, scaled by integerization and rounded like Point64's constructor
+		void ScaleRoundKernel(const double* src, int64_t* dst, size_t n)
+		{
+			size_t i = 0;
+#ifdef HSBA_CONVERT_SSE2
+			// 1.5 * 2^52: adding it rounds to an integer, its bits offset the integer for |v| < 2^51
+			const __m128d magic = _mm_set1_pd(6755399441055744.0);
+			const __m128i magicBits = _mm_castpd_si128(magic);
+			const __m128d limit = _mm_set1_pd(2251799813685248.0);
+			const __m128d scale = _mm_set1_pd(integerization);
+			const __m128d signMask = _mm_set1_pd(-0.0);
+			const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+			const __m128d half = _mm_set1_pd(0.5), minusHalf = _mm_set1_pd(-0.5);
+			for (; i + 2 <= n; i += 2)
+			{
+				const __m128d v = _mm_mul_pd(_mm_loadu_pd(src + i), scale);
+				// out of range or NaN: leave the pair to the scalar path
+				if (_mm_movemask_pd(_mm_cmpnlt_pd(_mm_andnot_pd(signMask, v), limit)) != 0)
+				{
+					dst[i] = ScaleRound(src[i]);
+					dst[i + 1] = ScaleRound(src[i + 1]);
+					continue;
+				}
+				// the FPU rounds ties to even, std::round rounds them away from zero
+				__m128d r = _mm_sub_pd(_mm_add_pd(v, magic), magic);
+				const __m128d diff = _mm_sub_pd(v, r);
+				const __m128d up = _mm_and_pd(_mm_cmpeq_pd(diff, half), _mm_cmpgt_pd(v, zero));
+				const __m128d down = _mm_and_pd(_mm_cmpeq_pd(diff, minusHalf), _mm_cmplt_pd(v, zero));
+				r = _mm_sub_pd(_mm_add_pd(r, _mm_and_pd(up, one)), _mm_and_pd(down, one));
+				const __m128i bits = _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(r, magic)), magicBits);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bits);
+			}
+#endif
+			for (; i < n; ++i) dst[i] = ScaleRound(src[i]);
+		}
+
+		// n coordinates divided by integerization
+		void ScaleDownKernel(const int64_t* src, double* dst, size_t n)
+		{
+			size_t i = 0;
+#ifdef HSBA_CONVERT_SSE2
+			const __m128d magic = _mm_set1_pd(6755399441055744.0);
+			const __m128i magicBits = _mm_castpd_si128(magic);
+			const __m128i bias = _mm_set1_epi64x(int64_t{ 1 } << 51);
+			const __m128d scale = _mm_set1_pd(integerization);
+			for (; i + 2 <= n; i += 2)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				// exact only for |v| < 2^51, wider values take the scalar path
+				const __m128i high = _mm_srli_epi64(_mm_add_epi64(v, bias), 52);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF)
+				{
+					dst[i] = src[i] / integerization;
+					dst[i + 1] = src[i + 1] / integerization;
+					continue;
+				}
+				const __m128d d = _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(v, magicBits)), magic);
+				_mm_storeu_pd(dst + i, _mm_div_pd(d, scale));
+			}
+#endif
+			for (; i < n; ++i) dst[i] = src[i] / integerization;
+		}
+	} // namespace
+
 	PolygonsD MakeSimple(const PolygonD& p, double epsilon)
 	{
 		return Clipper2Lib::SimplifyPaths(PolygonsD{ p }, epsilon);
@@ -38,19 +121,62 @@ namespace HsBa::Slicer
 
 	PolygonsD Union(const PolygonsD& left, const PolygonsD& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Union(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Union, { &left, 1 }, { &right, 1 }, fill_rule);
 	}
 	PolygonsD Intersection(const PolygonsD& left, const PolygonsD& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Intersect(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Intersection, { &left, 1 }, { &right, 1 }, fill_rule);
 	}
 	PolygonsD Difference(const PolygonsD& left, const PolygonsD& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Difference(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Difference, { &left, 1 }, { &right, 1 }, fill_rule);
 	}
 	PolygonsD Xor(const PolygonsD& left, const PolygonsD& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Xor(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Xor, { &left, 1 }, { &right, 1 }, fill_rule);
+	}
+
+	Clipper2Lib::ClipperD& ThreadLocalClipperD()
+	{
+		thread_local Clipper2Lib::ClipperD clipper{ 2 };
+		clipper.Clear();
+		return clipper;
+	}
+
+	PolygonsD BooleanBatch(Clipper2Lib::ClipType clip_type,
+		std::span<const PolygonsD> subjects, std::span<const PolygonsD> clips,
+		Clipper2Lib::FillRule fill_rule)
+	{
+		auto& clipper = ThreadLocalClipperD();
+		for (const auto& s : subjects)
+		{
+			clipper.AddSubject(s);
+		}
+		for (const auto& c : clips)
+		{
+			clipper.AddClip(c);
+		}
+		PolygonsD res;
+		clipper.Execute(clip_type, fill_rule, res);
+		clipper.Clear();
+		return res;
+	}
+	PolygonsD UnionAll(std::span<const PolygonsD> polys, Clipper2Lib::FillRule fill_rule)
+	{
+		return BooleanBatch(Clipper2Lib::ClipType::Union, polys, {}, fill_rule);
+	}
+	PolygonsD IntersectionAll(std::span<const PolygonsD> polys, Clipper2Lib::FillRule fill_rule)
+	{
+		if (polys.empty())
+			return {};
+		PolygonsD res = polys.front();
+		for (const auto& p : polys.subspan(1))
+		{
+			if (res.empty())
+				break;
+			res = BooleanBatch(Clipper2Lib::ClipType::Intersection, { &res, 1 }, { &p, 1 }, fill_rule);
+		}
+		return res;
 	}
 
 	double Area(const PolygonD& p)
@@ -158,42 +284,74 @@ namespace HsBa::Slicer
 
 #endif
 
-	Polygon Integerization(const PolygonD& poly)
+	void Integerization(const PolygonD& poly, Polygon& out)
 	{
-		Polygon res;
-		for (const auto& p : poly)
+		out.resize(poly.size());
+		if (poly.empty()) return;
+		if constexpr (FLAT_POINTS)
+		{
+			ScaleRoundKernel(&poly.front().x, &out.front().x, poly.size() * 2);
+		}
+		else
 		{
-			res.emplace_back(Point2{ p.x * integerization,p.y * integerization });
+			for (size_t i = 0; i < poly.size(); ++i)
+				out[i] = Point2{ poly[i].x * integerization, poly[i].y * integerization };
 		}
+	}
+
+	void Integerization(const PolygonsD& polys, Polygons& out)
+	{
+		out.resize(polys.size());
+		for (size_t i = 0; i < polys.size(); ++i)
+			Integerization(polys[i], out[i]);
+	}
+
+	void UnIntegerization(const Polygon& poly, PolygonD& out)
+	{
+		out.resize(poly.size());
+		if (poly.empty()) return;
+		if constexpr (FLAT_POINTS)
+		{
+			ScaleDownKernel(&poly.front().x, &out.front().x, poly.size() * 2);
+		}
+		else
+		{
+			for (size_t i = 0; i < poly.size(); ++i)
+				out[i] = Point2D{ poly[i].x / integerization, poly[i].y / integerization };
+		}
+	}
+
+	void UnIntegerization(const Polygons& polys, PolygonsD& out)
+	{
+		out.resize(polys.size());
+		for (size_t i = 0; i < polys.size(); ++i)
+			UnIntegerization(polys[i], out[i]);
+	}
+
+	Polygon Integerization(const PolygonD& poly)
+	{
+		Polygon res;
+		Integerization(poly, res);
 		return res;
 	}
 	Polygons Integerization(const PolygonsD& polys)
 	{
 		Polygons res;
-		for (const auto& poly : polys)
-		{
-			res.emplace_back(Integerization(poly));
-		}
+		Integerization(polys, res);
 		return res;
 	}
 
 	PolygonD UnIntegerization(const Polygon& poly)
 	{
 		PolygonD res;
-		for (const auto& p : poly)
-		{
-			res.emplace_back(Point2D{ p.x / integerization,p.y / integerization });
-		}
+		UnIntegerization(poly, res);
 		return res;
 	}
 
 	PolygonsD UnIntegerization(const Polygons& polys)
 	{
 		PolygonsD res;
-		for (const auto& poly : polys)
-		{
-			res.emplace_back(UnIntegerization(poly));
-		}
+		UnIntegerization(polys, res);
 		return res;
 	}
 
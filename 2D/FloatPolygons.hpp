@@ -6,6 +6,7 @@
 #include <clipper2/clipper.offset.h>
 
 #include "IntPolygon.hpp"
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -44,6 +45,20 @@ namespace HsBa::Slicer
 		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
 	);
 
+	// per-thread engine with the same precision as the Clipper2 free functions, returned cleared
+	Clipper2Lib::ClipperD& ThreadLocalClipperD();
+
+	PolygonsD BooleanBatch(Clipper2Lib::ClipType clip_type,
+		std::span<const PolygonsD> subjects, std::span<const PolygonsD> clips,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::NonZero
+	);
+	PolygonsD UnionAll(std::span<const PolygonsD> polys,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::NonZero
+	);
+	PolygonsD IntersectionAll(std::span<const PolygonsD> polys,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::NonZero
+	);
+
 	double Area(const PolygonD& p);
 	double Area(const PolygonsD& ps);
 
@@ -55,6 +70,13 @@ namespace HsBa::Slicer
 	PolygonD UnIntegerization(const Polygon& poly);
 	PolygonsD UnIntegerization(const Polygons& polys);
 
+	// bulk conversions into out, which keeps its capacity so buffers can be reused across calls.
+	// Results are identical to the point by point conversion (rounded half away from zero)
+	void Integerization(const PolygonD& poly, Polygon& out);
+	void Integerization(const PolygonsD& polys, Polygons& out);
+	void UnIntegerization(const Polygon& poly, PolygonD& out);
+	void UnIntegerization(const Polygons& polys, PolygonsD& out);
+
 #ifdef HSBA_POLYGON_DUMP
 	void DumpPolygon(const PolygonD& p, std::string_view filename, bool close_path = true);
 	void DumpPolygons(const PolygonsD& ps, std::string_view filename, bool close_path = true);
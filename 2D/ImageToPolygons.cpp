@@ -3,10 +3,13 @@
 #include <vector>
 #include <string>
 #include <fstream>
-#include <queue>
+#include <span>
 #include <cstdint>
 #include <algorithm>
 #include <cstring>
+#include <cmath>
+#include <future>
+#include <exception>
 #include <filesystem>
 // use OpenCV for image IO and simple raster operations
 #ifdef HAS_OPENCV
@@ -17,10 +20,16 @@
 #include <turbojpeg.h>
 
 #include "base/error.hpp"
+#include "base/thread_pool.hpp"
 #include "LuaAdapter.hpp"
 #include "utils/LuaNewObject.hpp"
 #include "base/string_helper.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HSBA_RASTER_SSE2
+#endif
+
 namespace HsBa::Slicer
 {
 	namespace
@@ -50,7 +59,21 @@ namespace HsBa::Slicer
 				return false;
 			}
 #else
-			return false;
+			// libpng simplified API converts any PNG to 8-bit gray
+			png_image image;
+			std::memset(&image, 0, sizeof(image));
+			image.version = PNG_IMAGE_VERSION;
+			if (!png_image_begin_read_from_file(&image, path.c_str())) return false;
+			image.format = PNG_FORMAT_GRAY;
+			w = static_cast<int>(image.width);
+			h = static_cast<int>(image.height);
+			out.assign(PNG_IMAGE_SIZE(image), 0);
+			if (!png_image_finish_read(&image, nullptr, out.data(), 0, nullptr))
+			{
+				png_image_free(&image);
+				return false;
+			}
+			return true;
 #endif
 		}
 
@@ -73,113 +96,206 @@ namespace HsBa::Slicer
 #endif
 		}
 
-		PolygonsD ExtractContoursFromBinary(const std::vector<uint8_t>& img, int w, int h, double pixelSize)
+		// Marching squares over the pixel centres with the image padded by background, so every
+		// contour closes. Walking clockwise around a cell, a crossing either enters or leaves the
+		// foreground; each segment runs from a leaving crossing to an entering one, which gives
+		// outer borders a positive area and holes a negative one. Every crossing starts exactly one
+		// segment and ends another, so the segments are chained by looking up the crossed edge among
+		// the segments sorted by their start edge (the scan already emits them nearly sorted).
+		// All thresholds are traced in the same sweep: a cell only crosses the levels between its
+		// darkest and brightest corner, found by binary search in the sorted thresholds.
+		std::vector<PolygonsD> TraceContours(const uint8_t* img, int w, int h, std::span<const int> thresholds,
+			double pixelSize, bool subPixel)
 		{
-			PolygonsD res;
-			std::vector<char> seen(w * h, 0);
+			std::vector<PolygonsD> res(thresholds.size());
+			if (img == nullptr || w <= 0 || h <= 0 || thresholds.empty()) return res;
 
-			auto inb = [&](int x, int y) { return x >= 0 && x < w && y >= 0 && y < h; };
+			std::vector<int> levels(thresholds.begin(), thresholds.end());
+			std::sort(levels.begin(), levels.end());
+			levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
 
-			for (int y = 0; y < h; ++y)
-				for (int x = 0; x < w; ++x)
+			const int outside = std::min(0, levels.front());
+			auto value = [&](int x, int y) -> int {
+				return (x < 0 || y < 0 || x >= w || y >= h) ? outside : img[static_cast<size_t>(y) * w + x];
+				};
+			// edge ids: horizontal edge (x,y)-(x+1,y) and vertical edge (x,y)-(x,y+1), shifted for the padding
+			const int64_t gw = static_cast<int64_t>(w) + 2;
+			auto hEdge = [&](int x, int y) { return ((y + 1) * gw + (x + 1)) * 2; };
+			auto vEdge = [&](int x, int y) { return ((y + 1) * gw + (x + 1)) * 2 + 1; };
+			auto toWorld = [&](double x, double y) { return Point2D{ (x + 0.5) * pixelSize, (y + 0.5) * pixelSize }; };
+
+			struct Crossing { int64_t id; Point2D pt; bool entering; };
+			struct LevelState
+			{
+				struct Segment { int64_t from; int64_t to; Point2D pt; };
+				std::vector<Segment> segments;
+			};
+			std::vector<LevelState> states(levels.size());
+
+			std::vector<int> prevRow(static_cast<size_t>(w) + 2), curRow(static_cast<size_t>(w) + 2);
+			for (int x = -1; x <= w; ++x) prevRow[x + 1] = value(x, -1);
+			for (int y = -1; y < h; ++y)
+			{
+				for (int x = -1; x <= w; ++x) curRow[x + 1] = value(x, y + 1);
+				for (int x = -1; x < w; ++x)
 				{
-					int idx = y * w + x;
-					if (img[idx] == 0 || seen[idx]) continue;
-					std::vector<int> comp;
-					std::queue<int> q;
-					q.push(idx); seen[idx] = 1;
-					while (!q.empty())
+					// corners clockwise: TL, TR, BR, BL
+					const int v[4] = { prevRow[x + 1], prevRow[x + 2], curRow[x + 2], curRow[x + 1] };
+					const int vmin = std::min({ v[0], v[1], v[2], v[3] });
+					const int vmax = std::max({ v[0], v[1], v[2], v[3] });
+					if (vmin == vmax) continue;
+					// levels with vmin <= t < vmax have corners on both sides
+					for (auto it = std::lower_bound(levels.begin(), levels.end(), vmin); it != levels.end() && *it < vmax; ++it)
 					{
-						int cur = q.front(); q.pop();
-						comp.push_back(cur);
-						int cx = cur % w, cy = cur / w;
-						for (int dy = -1; dy <= 1; ++dy)
-							for (int dx = -1; dx <= 1; ++dx)
-							{
-								if (std::abs(dx) + std::abs(dy) != 1) continue; // 4-neighbor
-								int nx = cx + dx, ny = cy + dy;
-								if (!inb(nx, ny)) continue;
-								int nidx = ny * w + nx;
-								if (!seen[nidx] && img[nidx]) { seen[nidx] = 1; q.push(nidx); }
-							}
-					}
+						const int threshold = *it;
+						auto& state = states[it - levels.begin()];
+						const double level = threshold + 0.5;
+						auto frac = [&](int va, int vb) {
+							return subPixel ? std::clamp((level - va) / static_cast<double>(vb - va), 0.0, 1.0) : 0.5;
+							};
+						const bool fg[4] = { v[0] > threshold, v[1] > threshold, v[2] > threshold, v[3] > threshold };
 
-					std::vector<std::pair<int, int>> border;
-					for (int v : comp)
-					{
-						int cx = v % w, cy = v / w;
-						bool isBorder = false;
-						for (int k = 0; k < 4 && !isBorder; ++k)
+						Crossing cs[4];
+						int n = 0;
+						if (fg[0] != fg[1]) cs[n++] = { hEdge(x, y), toWorld(x + frac(v[0], v[1]), y), fg[1] };
+						if (fg[1] != fg[2]) cs[n++] = { vEdge(x + 1, y), toWorld(x + 1, y + frac(v[1], v[2])), fg[2] };
+						if (fg[2] != fg[3]) cs[n++] = { hEdge(x, y + 1), toWorld(x + 1 - frac(v[2], v[3]), y + 1), fg[3] };
+						if (fg[3] != fg[0]) cs[n++] = { vEdge(x, y), toWorld(x, y + 1 - frac(v[3], v[0])), fg[0] };
+
+						auto addSegment = [&](const Crossing& from, const Crossing& to) {
+							state.segments.push_back({ from.id, to.id, from.pt });
+							};
+						if (n == 2)
+						{
+							if (cs[0].entering) addSegment(cs[1], cs[0]);
+							else addSegment(cs[0], cs[1]);
+							continue;
+						}
+						// saddle: binary images keep diagonal pixels apart (4-connectivity like the
+						// flood fill used to), interpolated ones decide by the cell centre value
+						bool connected = subPixel && (v[0] + v[1] + v[2] + v[3]) * 0.25 > level;
+						for (int i = 0; i != 4; ++i)
 						{
-							int nx = cx + (k == 0 ? -1 : k == 1 ? 1 : 0);
-							int ny = cy + (k == 2 ? -1 : k == 3 ? 1 : 0);
-							if (!inb(nx, ny) || img[ny * w + nx] == 0) isBorder = true;
+							if (!cs[i].entering) continue;
+							addSegment(cs[connected ? (i + 3) % 4 : (i + 1) % 4], cs[i]);
 						}
-						if (isBorder) border.emplace_back(cx, cy);
 					}
+				}
+				std::swap(prevRow, curRow);
+			}
 
-					if (border.empty()) continue;
-					double ccx = 0, ccy = 0;
-					for (auto& p : border) { ccx += p.first; ccy += p.second; }
-					ccx /= border.size(); ccy /= border.size();
-					std::sort(border.begin(), border.end(), [&](const auto& a, const auto& b) {
-						double aa = std::atan2(a.second - ccy, a.first - ccx);
-						double bb = std::atan2(b.second - ccy, b.first - ccx);
-						return aa < bb;
-						});
-
+			auto chain = [&](LevelState& state) {
+				PolygonsD polys;
+				auto& segs = state.segments;
+				std::vector<uint32_t> idx(segs.size());
+				for (uint32_t k = 0; k < idx.size(); ++k) idx[k] = k;
+				std::sort(idx.begin(), idx.end(), [&](uint32_t a, uint32_t b) { return segs[a].from < segs[b].from; });
+				auto find = [&](int64_t id) -> int64_t {
+					auto it = std::lower_bound(idx.begin(), idx.end(), id, [&](uint32_t k, int64_t v) { return segs[k].from < v; });
+					return (it != idx.end() && segs[*it].from == id) ? *it : -1;
+					};
+				std::vector<char> used(segs.size(), 0);
+				for (size_t start = 0; start < segs.size(); ++start)
+				{
+					if (used[start]) continue;
+					PolygonD loop;
+					for (int64_t k = static_cast<int64_t>(start); k >= 0 && !used[k]; k = find(segs[k].to))
+					{
+						used[k] = 1;
+						loop.push_back(segs[k].pt);
+					}
+					// drop the points in the middle of straight runs
 					PolygonD poly;
-					poly.reserve(border.size());
-					for (auto& p : border)
+					poly.reserve(loop.size());
+					const size_t cnt = loop.size();
+					for (size_t i = 0; i < cnt; ++i)
 					{
-						poly.emplace_back(Point2D{ p.first * pixelSize, p.second * pixelSize });
+						const auto& a = loop[(i + cnt - 1) % cnt];
+						const auto& b = loop[i];
+						const auto& c = loop[(i + 1) % cnt];
+						double cross = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+						if (std::abs(cross) > 1e-12 * pixelSize * pixelSize) poly.push_back(b);
 					}
-
-					PolygonsD simp = MakeSimple(poly);
-					for (auto& sp : simp) res.emplace_back(sp);
+					if (poly.size() >= 3) polys.emplace_back(std::move(poly));
 				}
+				return polys;
+				};
+			std::vector<PolygonsD> byLevel(levels.size());
+			for (size_t i = 0; i < levels.size(); ++i)
+			{
+				byLevel[i] = chain(states[i]);
+				states[i] = LevelState{};
+			}
+			for (size_t i = 0; i < thresholds.size(); ++i)
+			{
+				auto pos = std::lower_bound(levels.begin(), levels.end(), thresholds[i]) - levels.begin();
+				res[i] = byLevel[pos];
+			}
+			return res;
+		}
 
+		// one sweep per chunk of thresholds, chunks run on the pool and share the read-only image
+		std::vector<PolygonsD> TraceContoursOnPool(const uint8_t* img, int w, int h, const std::vector<int>& thresholds,
+			double pixelSize, bool subPixel, ThreadPool* pool)
+		{
+			if (pool == nullptr || thresholds.size() < 2)
+				return TraceContours(img, w, h, thresholds, pixelSize, subPixel);
+			const size_t chunks = std::min(thresholds.size(), std::max<size_t>(pool->ThreadCount(), 1));
+			const size_t per = (thresholds.size() + chunks - 1) / chunks;
+			std::vector<PolygonsD> res;
+			res.reserve(thresholds.size());
+			// every chunk in flight at once; a failing chunk or submit waits for the others, which
+			// read img, before the error is rethrown
+			RunOrdered(*pool, (thresholds.size() + per - 1) / per, chunks,
+				[&](size_t chunk) {
+					const size_t first = chunk * per;
+					std::span<const int> part{ thresholds.data() + first, std::min(per, thresholds.size() - first) };
+					return TraceContours(img, w, h, part, pixelSize, subPixel);
+				},
+				[&](size_t, std::vector<PolygonsD>&& layers) {
+					for (auto& layer : layers) res.emplace_back(std::move(layer));
+				});
 			return res;
 		}
 
-		bool pointInPolygon(const PolygonD& poly, double x, double y)
+		struct PNGWriteState
+		{
+			std::string* out;
+			bool failed = false;
+		};
+
+		void PNGWriteToString(png_structp png, png_bytep data, png_size_t length)
 		{
-			if (poly.empty()) return false;
-			size_t n = poly.size();
-			bool inside = false;
-			for (size_t i = 0, j = n - 1; i < n; j = i++) 
+			auto* state = static_cast<PNGWriteState*>(png_get_io_ptr(png));
+			try
 			{
-				const Point2D& a = poly[i];
-				const Point2D& b = poly[j];
-				if (((a.y > y) != (b.y > y)) &&
-					(x < a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y))) 
-				{
-					inside = !inside;
-				}
+				state->out->append(reinterpret_cast<const char*>(data), length);
+			}
+			catch (...)
+			{
+				state->failed = true;
 			}
-			return inside;
+			// longjmp only after the handler is left
+			if (state->failed) png_error(png, "out of memory");
 		}
 
+		void PNGFlushNoop(png_structp) {}
+
 		bool SavePNG(const std::string& path, const std::vector<uint8_t>& img, int w, int h)
 		{
-			FILE* fp = fopen(path.c_str(), "wb");
-			if (!fp) return false;
-			png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-			if (!png) { fclose(fp); return false; }
-			png_infop info = png_create_info_struct(png);
-			if (!info) { png_destroy_write_struct(&png, nullptr); fclose(fp); return false; }
-			if (setjmp(png_jmpbuf(png))) { png_destroy_write_struct(&png, &info); fclose(fp); return false; }
-			png_init_io(png, fp);
-			png_set_IHDR(png, info, w, h, 8, PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-			png_write_info(png, info);
-			for (int y = 0; y < h; ++y) 
+			std::string png;
+			try
 			{
-				png_write_row(png, &img[y * w]);
+				png = EncodePNG(img.data(), w, h, w);
 			}
-			png_write_end(png, nullptr);
-			png_destroy_write_struct(&png, &info);
-			fclose(fp);
-			return true;
+			catch (const RuntimeError&)
+			{
+				return false;
+			}
+			std::ofstream ofs(path, std::ios::binary);
+			if (!ofs) return false;
+			ofs.write(png.data(), static_cast<std::streamsize>(png.size()));
+			return static_cast<bool>(ofs);
 		}
 
 		bool SaveJPG(const std::string& path, const std::vector<uint8_t>& img, int w, int h, int quality = 90)
@@ -208,33 +324,256 @@ namespace HsBa::Slicer
 			return true;
 		}
 
-		void RasterizePolygons(const PolygonsD& polys, std::vector<uint8_t>& img, int width, int height, double pixelSize, uint8_t foreground)
+		struct RasterEdge
+		{
+			double y0, y1;   // y0 < y1, pixel units
+			double x0, dxdy; // x at y0 and slope
+		};
+
+		// coverage of one pixel per sub-scanline, chosen so that 16 samples still fit in uint16_t
+		constexpr int MAX_AA_SAMPLES = 16;
+
+		inline void AddSpan(uint16_t* row, int from, int to, uint16_t value)
+		{
+			int x = from;
+#ifdef HSBA_RASTER_SSE2
+			const __m128i v = _mm_set1_epi16(static_cast<short>(value));
+			for (; x + 8 <= to; x += 8)
+			{
+				__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_add_epi16(c, v));
+			}
+#endif
+			for (; x < to; ++x) row[x] = static_cast<uint16_t>(row[x] + value);
+		}
+
+		// renders rows [rowBegin, rowEnd) of the even-odd fill of edges into buffer
+		void RasterizeRows(const std::vector<RasterEdge>& edges, const std::vector<uint32_t>& active,
+			uint8_t* buffer, int width, size_t stride, int rowBegin, int rowEnd, const RasterOptions& options)
 		{
-			for (int y = 0; y < height; ++y) 
+			const int samples = std::clamp(options.antiAliasSamples, 1, MAX_AA_SAMPLES);
+			const uint16_t unit = static_cast<uint16_t>(65535 / samples);
+			const uint8_t fg = options.foreground, bg = options.background;
+			std::vector<double> xs;
+			std::vector<uint16_t> coverage(samples > 1 ? static_cast<size_t>(width) : 0);
+			for (int y = rowBegin; y < rowEnd; ++y)
 			{
-				for (int x = 0; x < width; ++x) 
+				uint8_t* out = buffer + static_cast<size_t>(y) * stride;
+				std::memset(out, bg, width);
+				if (samples > 1) std::fill(coverage.begin(), coverage.end(), uint16_t{ 0 });
+				bool any = false;
+				for (int k = 0; k < samples; ++k)
 				{
-					double px = (x + 0.5) * pixelSize;
-					double py = (y + 0.5) * pixelSize;
-					for (const auto& poly : polys) 
+					const double sy = y + (k + 0.5) / samples;
+					xs.clear();
+					for (auto e : active)
+					{
+						const auto& edge = edges[e];
+						if (edge.y0 <= sy && sy < edge.y1)
+							xs.push_back(edge.x0 + (sy - edge.y0) * edge.dxdy);
+					}
+					if (xs.size() < 2) continue;
+					std::sort(xs.begin(), xs.end());
+					for (size_t i = 0; i + 1 < xs.size(); i += 2)
 					{
-						if (pointInPolygon(poly, px, py)) {
-							img[y * width + x] = foreground;
-							break;
+						// clamped in double, so the casts below stay in [0, width]
+						const double xa = std::clamp(xs[i], 0.0, static_cast<double>(width));
+						const double xb = std::clamp(xs[i + 1], 0.0, static_cast<double>(width));
+						if (!(xa < xb)) continue;
+						if (samples == 1)
+						{
+							// pixel centres inside [xa, xb)
+							const int from = static_cast<int>(std::ceil(xa - 0.5));
+							const int to = std::min(width, static_cast<int>(std::ceil(xb - 0.5)));
+							if (from < to) std::memset(out + from, fg, to - from);
+							continue;
 						}
+						any = true;
+						// exact horizontal coverage: partial end pixels and a full run between them
+						const int ia = static_cast<int>(xa), ib = static_cast<int>(xb);
+						if (ia == ib)
+						{
+							coverage[ia] = static_cast<uint16_t>(coverage[ia] + (xb - xa) * unit);
+							continue;
+						}
+						coverage[ia] = static_cast<uint16_t>(coverage[ia] + (ia + 1 - xa) * unit);
+						AddSpan(coverage.data(), ia + 1, ib, unit);
+						if (ib < width)
+							coverage[ib] = static_cast<uint16_t>(coverage[ib] + (xb - ib) * unit);
 					}
 				}
+				if (!any) continue;
+				const double scale = (static_cast<double>(fg) - bg) / (static_cast<double>(unit) * samples);
+				for (int x = 0; x < width; ++x)
+				{
+					if (coverage[x] == 0) continue;
+					out[x] = static_cast<uint8_t>(std::lround(bg + coverage[x] * scale));
+				}
 			}
 		}
 	} // namespace
 
-	PolygonsD FromImage(const std::string& path, int threshold, double pixelSize)
+	PolygonsD FromImage(const std::string& path, int threshold, double pixelSize, bool subPixel)
 	{
-		std::vector<PolygonsD> layers = FromImageMulti(path, std::vector<int>{threshold}, pixelSize);
+		std::vector<PolygonsD> layers = FromImageMulti(path, std::vector<int>{ threshold }, pixelSize, subPixel);
 		if (layers.empty()) return {};
 		return layers.front();
 	}
 
+	PolygonsD FromGrayImage(const std::vector<uint8_t>& img, int width, int height, int threshold, double pixelSize, bool subPixel)
+	{
+		if (width <= 0 || height <= 0 || img.size() < static_cast<size_t>(width) * height)
+			throw InvalidArgumentError("Gray image buffer is smaller than width * height");
+		int level = threshold;
+		return TraceContours(img.data(), width, height, { &level, 1 }, pixelSize, subPixel).front();
+	}
+
+	std::vector<PolygonsD> FromGrayImageMulti(const std::vector<uint8_t>& img, int width, int height,
+		const std::vector<int>& thresholds, double pixelSize, bool subPixel, ThreadPool* pool)
+	{
+		if (width <= 0 || height <= 0 || img.size() < static_cast<size_t>(width) * height)
+			throw InvalidArgumentError("Gray image buffer is smaller than width * height");
+		return TraceContoursOnPool(img.data(), width, height, thresholds, pixelSize, subPixel, pool);
+	}
+
+	void RasterizePolygons(const Polygons& polys, uint8_t* buffer, int width, int height, size_t stride,
+		double pixelSize, const RasterOptions& options, ThreadPool* pool)
+	{
+		if (buffer == nullptr || width <= 0 || height <= 0)
+			throw InvalidArgumentError("Raster buffer must be non-null with a positive size");
+		if (stride < static_cast<size_t>(width))
+			throw InvalidArgumentError("Raster stride must be at least the width");
+		if (pixelSize <= 0)
+			throw InvalidArgumentError("Pixel size must be positive");
+
+		// edges in pixel units, horizontal ones never cross a scanline
+		const double toPixel = 1.0 / (pixelSize * integerization);
+		std::vector<RasterEdge> edges;
+		for (const auto& poly : polys)
+		{
+			const size_t n = poly.size();
+			if (n < 3) continue;
+			for (size_t i = 0; i < n; ++i)
+			{
+				const auto& a = poly[i];
+				const auto& b = poly[(i + 1) % n];
+				if (a.y == b.y) continue;
+				double ax = a.x * toPixel, ay = a.y * toPixel, bx = b.x * toPixel, by = b.y * toPixel;
+				if (ay > by) { std::swap(ax, bx); std::swap(ay, by); }
+				if (by <= 0 || ay >= height) continue;
+				edges.push_back(RasterEdge{ ay, by, ax, (bx - ax) / (by - ay) });
+			}
+		}
+
+		// bucket edges by the tiles of rows they touch
+		const int tileRows = std::max(1, options.tileRows);
+		const int tiles = (height + tileRows - 1) / tileRows;
+		std::vector<std::vector<uint32_t>> buckets(tiles);
+		for (uint32_t e = 0; e < edges.size(); ++e)
+		{
+			// edges may reach far outside the raster, clamp before casting
+			const double y0 = std::clamp(std::floor(edges[e].y0), 0.0, static_cast<double>(height));
+			const double y1 = std::clamp(std::ceil(edges[e].y1), 0.0, static_cast<double>(height));
+			int first = static_cast<int>(y0) / tileRows;
+			int last = std::min(tiles - 1, static_cast<int>(y1) / tileRows);
+			for (int t = first; t <= last; ++t) buckets[t].push_back(e);
+		}
+
+		auto renderTile = [&](int t) {
+			RasterizeRows(edges, buckets[t], buffer, width, stride, t * tileRows, std::min(height, (t + 1) * tileRows), options);
+			};
+		if (pool == nullptr || tiles < 2)
+		{
+			for (int t = 0; t < tiles; ++t) renderTile(t);
+			return;
+		}
+		// tiles write disjoint rows, so they need no synchronisation
+		std::vector<std::future<void>> futures;
+		futures.reserve(tiles);
+		for (int t = 0; t < tiles; ++t)
+			futures.emplace_back(pool->submit(renderTile, t));
+		std::exception_ptr error;
+		for (auto& f : futures)
+		{
+			try { f.get(); }
+			catch (...) { if (!error) error = std::current_exception(); }
+		}
+		if (error) std::rethrow_exception(error);
+	}
+
+	std::string EncodePNG(const uint8_t* img, int width, int height, size_t stride, int compressionLevel)
+	{
+		if (img == nullptr || width <= 0 || height <= 0 || stride < static_cast<size_t>(width))
+			throw InvalidArgumentError("PNG source must be non-null with a positive size and stride >= width");
+		std::string out;
+		// 8-bit gray deflates to a fraction of the raw size, reserve for the common case
+		out.reserve(static_cast<size_t>(width) * height / 8 + 1024);
+		PNGWriteState state{ &out };
+		png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+		if (!png) throw RuntimeError("Failed to create PNG writer");
+		png_infop info = png_create_info_struct(png);
+		if (!info)
+		{
+			png_destroy_write_struct(&png, nullptr);
+			throw RuntimeError("Failed to create PNG info");
+		}
+		if (setjmp(png_jmpbuf(png)))
+		{
+			png_destroy_write_struct(&png, &info);
+			throw RuntimeError("Failed to encode PNG");
+		}
+		png_set_write_fn(png, &state, PNGWriteToString, PNGFlushNoop);
+		if (compressionLevel >= 0) png_set_compression_level(png, std::min(compressionLevel, 9));
+		png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		png_write_info(png, info);
+		for (int y = 0; y < height; ++y)
+		{
+			png_write_row(png, img + static_cast<size_t>(y) * stride);
+		}
+		png_write_end(png, nullptr);
+		png_destroy_write_struct(&png, &info);
+		return out;
+	}
+
+	std::string ToPNG(const PolygonsD& polys, int width, int height, double pixelSize,
+		const RasterOptions& options, int compressionLevel)
+	{
+		if (width <= 0 || height <= 0)
+			throw InvalidArgumentError("Image size must be positive");
+		std::vector<uint8_t> img(static_cast<size_t>(width) * height);
+		RasterizePolygons(Integerization(polys), img.data(), width, height, width, pixelSize, options);
+		return EncodePNG(img.data(), width, height, width, compressionLevel);
+	}
+
+	std::vector<std::string> ToPNGs(const std::vector<PolygonsD>& layers, int width, int height, double pixelSize,
+		const RasterOptions& options, int compressionLevel, ThreadPool* pool)
+	{
+		std::vector<std::string> res(layers.size());
+		if (pool == nullptr || layers.size() < 2)
+		{
+			for (size_t i = 0; i < layers.size(); ++i)
+				res[i] = ToPNG(layers[i], width, height, pixelSize, options, compressionLevel);
+			return res;
+		}
+		// one layer per task, each encodes straight into its own slot
+		std::vector<std::future<void>> futures;
+		futures.reserve(layers.size());
+		for (size_t i = 0; i < layers.size(); ++i)
+		{
+			futures.emplace_back(pool->submit([&, i]() {
+				res[i] = ToPNG(layers[i], width, height, pixelSize, options, compressionLevel);
+				}));
+		}
+		std::exception_ptr error;
+		for (auto& f : futures)
+		{
+			try { f.get(); }
+			catch (...) { if (!error) error = std::current_exception(); }
+		}
+		if (error) std::rethrow_exception(error);
+		return res;
+	}
+
 	// rasterize polygons to grayscale image and save as PNG
 	bool ToImage(const PolygonsD& polys, int width, int height, double pixelSize, const std::string& outPath,
 		uint8_t foreground, uint8_t background)
@@ -267,60 +606,44 @@ namespace HsBa::Slicer
 			ofs << "</svg>\n";
 			return true;
 		}
-#ifdef HAS_OPENCV
-		else
-		{
-			// rasterize with OpenCV
-			cv::Mat img(height, width, CV_8UC1, cv::Scalar(background));
-			for (const auto& poly : polys)
-			{
-				if (poly.empty()) continue;
-				// build vector of points in pixel coordinates
-				std::vector<std::vector<cv::Point>> contours;
-				contours.emplace_back();
-				for (const auto& pt : poly)
-				{
-					int px = (int)std::round(pt.x / pixelSize);
-					int py = (int)std::round(pt.y / pixelSize);
-					contours.back().push_back(cv::Point(px, py));
-				}
-				// fill polygon
-				cv::fillPoly(img, contours, cv::Scalar(foreground));
-			}
-			return cv::imwrite(outPath, img);
-		}
-#else
-		// rasterize manually
-		std::vector<uint8_t> img(width * height, background);
-		RasterizePolygons(polys, img, width, height, pixelSize, foreground);
+		// rasterize natively, OpenCV is only used to write formats libpng/turbojpeg don't cover
+		std::vector<uint8_t> img(static_cast<size_t>(width) * height);
+		RasterOptions options;
+		options.foreground = foreground;
+		options.background = background;
+		RasterizePolygons(Integerization(polys), img.data(), width, height, width, pixelSize, options);
 		if (low.size() >= 4 && (low.substr(low.size() - 4) == ".jpg" || (low.size() >= 5 && low.substr(low.size() - 5) == ".jpeg")))
 		{
 			return SaveJPG(outPath, img, width, height);
 		}
-		else
+		if (low.size() >= 4 && low.substr(low.size() - 4) == ".png")
 		{
 			return SavePNG(outPath, img, width, height);
 		}
+#ifdef HAS_OPENCV
+		try
+		{
+			cv::Mat m(height, width, CV_8UC1, img.data());
+			return cv::imwrite(outPath, m);
+		}
+		catch (const cv::Exception&)
+		{
+			return false;
+		}
+#else
+		return SavePNG(outPath, img, width, height);
 #endif
 	}
 
-	std::vector<PolygonsD> FromImageMulti(const std::string& path, const std::vector<int>& thresholds, double pixelSize)
+	std::vector<PolygonsD> FromImageMulti(const std::string& path, const std::vector<int>& thresholds, double pixelSize,
+		bool subPixel, ThreadPool* pool)
 	{
 		std::vector<PolygonsD> res;
 		std::vector<uint8_t> img;
 		int w = 0, h = 0;
 		if (!LoadImageGray(path, img, w, h)) return res;
 		if (w <= 0 || h <= 0) return res;
-
-		// For each threshold create a binary image and extract contours
-		for (int thr : thresholds)
-		{
-			std::vector<uint8_t> bin(w * h);
-			for (int i = 0; i < w * h; ++i) bin[i] = (img[i] > thr) ? MAX_GRAY_VALUE : 0;
-			PolygonsD layer = ExtractContoursFromBinary(bin, w, h, pixelSize);
-			res.emplace_back(std::move(layer));
-		}
-		return res;
+		return TraceContoursOnPool(img.data(), w, h, thresholds, pixelSize, subPixel, pool);
 	}
 
 	bool LuaToImage(const PolygonsD& poly, const std::string& scriptPath, const std::string& outPath, const std::string& functionName,
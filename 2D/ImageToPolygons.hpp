@@ -15,9 +15,53 @@ inline constexpr uint8_t MIN_GRAY_VALUE = 0;
 
 namespace HsBa::Slicer
 {
-    PolygonsD FromImage(const std::string& path, int threshold = 128, double pixelSize = 1.0);
+    class ThreadPool;
 
-    std::vector<PolygonsD> FromImageMulti(const std::string& path, const std::vector<int>& thresholds, double pixelSize = 1.0);
+    // pixels brighter than threshold are foreground. Contours are traced with marching squares,
+    // holes come out with the opposite orientation of their outer border. With subPixel the
+    // border is interpolated between pixel centres from the gray values, otherwise it runs
+    // halfway between them
+    PolygonsD FromImage(const std::string& path, int threshold = 128, double pixelSize = 1.0, bool subPixel = false);
+
+    // all thresholds are traced in a single sweep over the image; with a pool the thresholds are
+    // split into chunks that are swept concurrently. Results follow the order of thresholds
+    std::vector<PolygonsD> FromImageMulti(const std::string& path, const std::vector<int>& thresholds, double pixelSize = 1.0,
+        bool subPixel = false, ThreadPool* pool = nullptr);
+
+    // same as FromImage for a row-major 8-bit gray buffer already in memory
+    PolygonsD FromGrayImage(const std::vector<uint8_t>& img, int width, int height, int threshold = 128,
+        double pixelSize = 1.0, bool subPixel = false);
+
+    std::vector<PolygonsD> FromGrayImageMulti(const std::vector<uint8_t>& img, int width, int height,
+        const std::vector<int>& thresholds, double pixelSize = 1.0, bool subPixel = false, ThreadPool* pool = nullptr);
+
+    struct RasterOptions
+    {
+        // sub-scanlines per pixel row with exact horizontal coverage, 1 samples pixel centres only
+        int antiAliasSamples = 1;
+        // rows per task when rendering on a pool
+        int tileRows = 64;
+        uint8_t foreground = MAX_GRAY_VALUE;
+        uint8_t background = MIN_GRAY_VALUE;
+    };
+
+    // even-odd scanline rasterizer for integerized polygons, pixel (x, y) covers
+    // [x, x + 1) * pixelSize in polygon units. Writes width bytes per row into buffer, rows are
+    // stride bytes apart; with a pool, tiles of rows are rendered concurrently
+    void RasterizePolygons(const Polygons& polys, uint8_t* buffer, int width, int height, size_t stride,
+        double pixelSize, const RasterOptions& options = {}, ThreadPool* pool = nullptr);
+
+    // 8-bit gray PNG encoded into memory, rows are stride bytes apart. compressionLevel is the
+    // zlib level 0-9, negative keeps the libpng default. Throws RuntimeError if encoding fails
+    std::string EncodePNG(const uint8_t* img, int width, int height, size_t stride, int compressionLevel = -1);
+
+    // rasterize and encode without touching the disk, the result can be moved into an archive
+    std::string ToPNG(const PolygonsD& polys, int width, int height, double pixelSize,
+        const RasterOptions& options = {}, int compressionLevel = -1);
+
+    // one PNG per layer, layers are rendered and encoded concurrently when a pool is given
+    std::vector<std::string> ToPNGs(const std::vector<PolygonsD>& layers, int width, int height, double pixelSize,
+        const RasterOptions& options = {}, int compressionLevel = -1, ThreadPool* pool = nullptr);
 
     bool ToImage(const PolygonsD& polys, int width, int height, double pixelSize, const std::string& outPath,
         uint8_t foreground = MAX_GRAY_VALUE, uint8_t background = MIN_GRAY_VALUE);
@@ -4,6 +4,7 @@
 #include <boost/container_hash/hash.hpp>
 #include <fstream>
 #include <iomanip>
+#include <memory>
 #include <sstream>
 #include <string_view>
 
@@ -40,19 +41,71 @@ namespace HsBa::Slicer
 
 	Polygons Union(const Polygons& left, const Polygons& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Union(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Union, { &left, 1 }, { &right, 1 }, fill_rule);
 	}
 	Polygons Intersection(const Polygons& left, const Polygons& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Intersect(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Intersection, { &left, 1 }, { &right, 1 }, fill_rule);
 	}
 	Polygons Difference(const Polygons& left, const Polygons& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Difference(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Difference, { &left, 1 }, { &right, 1 }, fill_rule);
 	}
 	Polygons Xor(const Polygons& left, const Polygons& right, Clipper2Lib::FillRule fill_rule)
 	{
-		return Clipper2Lib::Xor(left, right, fill_rule);
+		return BooleanBatch(Clipper2Lib::ClipType::Xor, { &left, 1 }, { &right, 1 }, fill_rule);
+	}
+
+	Clipper2Lib::Clipper64& ThreadLocalClipper()
+	{
+		thread_local Clipper2Lib::Clipper64 clipper;
+		clipper.Clear();
+		return clipper;
+	}
+
+	std::pmr::monotonic_buffer_resource& ThreadLocalArena()
+	{
+		// the first block belongs to the thread, release() rewinds to it instead of freeing it,
+		// so only islands that outgrow it reach malloc
+		thread_local const std::unique_ptr<std::byte[]> buffer{ new std::byte[THREAD_ARENA_BYTES] };
+		thread_local std::pmr::monotonic_buffer_resource arena{ buffer.get(), THREAD_ARENA_BYTES };
+		return arena;
+	}
+
+	Polygons BooleanBatch(Clipper2Lib::ClipType clip_type,
+		std::span<const Polygons> subjects, std::span<const Polygons> clips,
+		Clipper2Lib::FillRule fill_rule)
+	{
+		auto& clipper = ThreadLocalClipper();
+		for (const auto& s : subjects)
+		{
+			clipper.AddSubject(s);
+		}
+		for (const auto& c : clips)
+		{
+			clipper.AddClip(c);
+		}
+		Polygons res;
+		clipper.Execute(clip_type, fill_rule, res);
+		clipper.Clear();
+		return res;
+	}
+	Polygons UnionAll(std::span<const Polygons> polys, Clipper2Lib::FillRule fill_rule)
+	{
+		return BooleanBatch(Clipper2Lib::ClipType::Union, polys, {}, fill_rule);
+	}
+	Polygons IntersectionAll(std::span<const Polygons> polys, Clipper2Lib::FillRule fill_rule)
+	{
+		if (polys.empty())
+			return {};
+		Polygons res = polys.front();
+		for (const auto& p : polys.subspan(1))
+		{
+			if (res.empty())
+				break;
+			res = BooleanBatch(Clipper2Lib::ClipType::Intersection, { &res, 1 }, { &p, 1 }, fill_rule);
+		}
+		return res;
 	}
 
 	Polygons Offset(const Polygon& p, double delta, Clipper2Lib::JoinType join_type, Clipper2Lib::EndType end_type)
@@ -101,10 +154,7 @@ namespace HsBa::Slicer
 		if (!isEvenOdd)
 		{
 			// polygon isn't even-odd, make it is even-odd
-			Polygons odd_polys;
-			Clipper2Lib::Clipper64 clipper;
-			clipper.AddSubject(polys);
-			clipper.Execute(Clipper2Lib::ClipType::Union, Clipper2Lib::FillRule::EvenOdd, odd_polys);
+			Polygons odd_polys = UnionAll({ &polys, 1 }, Clipper2Lib::FillRule::EvenOdd);
 			return even_odd_inside(point, odd_polys);
 		}
 		else
@@ -265,6 +315,16 @@ namespace HsBa::Slicer
 		}
 		return res;
 	}
+
+	std::vector<Polygons> SplitIslands(const Polygons& ps, Clipper2Lib::FillRule fill_rule)
+	{
+		Clipper2Lib::PolyTree64 polyTree;
+		auto& clipper = ThreadLocalClipper();
+		clipper.AddSubject(ps);
+		clipper.Execute(Clipper2Lib::ClipType::Union, fill_rule, polyTree);
+		clipper.Clear();
+		return PolyTreeSplit(polyTree);
+	}
 }// namespace HsBa::Slicer
 
 std::size_t std::hash<HsBa::Slicer::Polygon>::operator()(const HsBa::Slicer::Polygon& p) const
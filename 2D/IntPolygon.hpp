@@ -4,6 +4,8 @@
 
 #include <clipper2/clipper.h>
 #include <clipper2/clipper.offset.h>
+#include <memory_resource>
+#include <span>
 #include <string_view>
 
 namespace HsBa::Slicer
@@ -18,6 +20,10 @@ namespace HsBa::Slicer
 	Polygons MakeSimple(const Polygons& ps, double epsilon = 1e-3);
 
 	std::vector<Polygons> MakeSimpleAndSplit(const Polygon& p, double epsilon = 1e-3);
+	// split a layer into islands, each is one outer polygon followed by its holes
+	std::vector<Polygons> SplitIslands(const Polygons& ps,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
+	);
 
 	Polygons Union(const Polygon& left, const Polygon& right,
 		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
@@ -45,6 +51,34 @@ namespace HsBa::Slicer
 		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::EvenOdd
 	);
 
+	// per-thread engine reused by the boolean operations below, returned cleared.
+	// it is shared with those functions, so don't hold it across a call to them
+	Clipper2Lib::Clipper64& ThreadLocalClipper();
+
+	// fixed first block of the per-thread arena, it grows geometrically from the heap past that
+	constexpr size_t THREAD_ARENA_BYTES = size_t{ 1 } << 18;
+
+	// per-thread monotonic arena for the temporaries of one fill or slice call. Nothing is freed
+	// until release(), which the owner of a layer or island calls once it is done; that keeps the
+	// fixed first block for the next call. MultiIslandFill releases it after every island, so
+	// don't keep data in it across such a call
+	std::pmr::monotonic_buffer_resource& ThreadLocalArena();
+
+	// n-ary boolean operations, BooleanBatch and UnionAll put all inputs through one sweep.
+	// the inputs overlap each other, so NonZero is the default fill rule here
+	Polygons BooleanBatch(Clipper2Lib::ClipType clip_type,
+		std::span<const Polygons> subjects, std::span<const Polygons> clips,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::NonZero
+	);
+	Polygons UnionAll(std::span<const Polygons> polys,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::NonZero
+	);
+	// intersection of every element, one pairwise Intersection per element on the engine above.
+	// a single sweep can't tell which input covers a region, so it stops as soon as the result is empty
+	Polygons IntersectionAll(std::span<const Polygons> polys,
+		Clipper2Lib::FillRule fill_rule = Clipper2Lib::FillRule::NonZero
+	);
+
 	Polygons Offset(const Polygon& p, double delta,
 		Clipper2Lib::JoinType join_type=Clipper2Lib::JoinType::Square,
 		Clipper2Lib::EndType end_type=Clipper2Lib::EndType::Polygon
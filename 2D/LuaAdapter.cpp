@@ -4,6 +4,7 @@
 
 #include "base/error.hpp"
 #include "2Dhull.hpp"
+#include "Simplify.hpp"
 
 namespace HsBa::Slicer
 {
@@ -81,6 +82,61 @@ namespace HsBa::Slicer
 			return 1; // return the result table
 		}
 
+		// table of polygons tables -> vector of PolygonsD
+		std::vector<PolygonsD> LuaTableToPolygonsDList(lua_State* L, int index)
+		{
+			std::vector<PolygonsD> list;
+			size_t len = lua_rawlen(L, index);
+			list.reserve(len);
+			for (size_t i = 1; i <= len; ++i)
+			{
+				lua_rawgeti(L, index, static_cast<int>(i));
+				list.emplace_back(LuaTableToPolygonsD(L, -1));
+				lua_pop(L, 1);
+			}
+			return list;
+		}
+
+		int l_unionAll(lua_State* L)
+		{
+			if (lua_gettop(L) != 1 || !lua_istable(L, 1))
+				l_booleanError(L, "unionAll", "Expected a table of polygons tables");
+			auto list = LuaTableToPolygonsDList(L, 1);
+			PushPolygonsDToLua(L, UnionAll(list));
+			return 1; // return the result table
+		}
+
+		int l_intersectionAll(lua_State* L)
+		{
+			if (lua_gettop(L) != 1 || !lua_istable(L, 1))
+				l_booleanError(L, "intersectionAll", "Expected a table of polygons tables");
+			auto list = LuaTableToPolygonsDList(L, 1);
+			PushPolygonsDToLua(L, IntersectionAll(list));
+			return 1; // return the result table
+		}
+
+		int l_booleanBatch(lua_State* L)
+		{
+			if (lua_gettop(L) != 3 || !lua_istable(L, 1) || !lua_istable(L, 2) || !lua_isstring(L, 3))
+				l_booleanError(L, "booleanBatch", "Expected two tables of polygons tables and a string operation name");
+			auto subjects = LuaTableToPolygonsDList(L, 1);
+			auto clips = LuaTableToPolygonsDList(L, 2);
+			std::string operation = lua_tostring(L, 3);
+			Clipper2Lib::ClipType clip_type = Clipper2Lib::ClipType::Union;
+			if (operation == "union")
+				clip_type = Clipper2Lib::ClipType::Union;
+			else if (operation == "intersection")
+				clip_type = Clipper2Lib::ClipType::Intersection;
+			else if (operation == "difference")
+				clip_type = Clipper2Lib::ClipType::Difference;
+			else if (operation == "xor")
+				clip_type = Clipper2Lib::ClipType::Xor;
+			else
+				l_booleanError(L, "booleanBatch", std::format("Unknown operation '{}'", operation).c_str());
+			PushPolygonsDToLua(L, BooleanBatch(clip_type, subjects, clips));
+			return 1; // return the result table
+		}
+
 		int l_offsetOperation(lua_State* L)
 		{
 			if (lua_gettop(L) != 3 || !lua_istable(L, 1) || !lua_isnumber(L, 2))
@@ -121,6 +177,28 @@ namespace HsBa::Slicer
 			return 1; // return the result table
 		}
 
+		// simplify(polys, tolerance[, "rdp"|"visvalingam"]) -> polys, vertex reduction ratio
+		int l_simplify(lua_State* L)
+		{
+			int top = lua_gettop(L);
+			if (top < 2 || top > 3 || !lua_istable(L, 1) || !lua_isnumber(L, 2) || (top == 3 && !lua_isstring(L, 3)))
+				l_booleanError(L, "simplify", "Expected a polygons table, a number tolerance and an optional method string");
+			SimplifyOptions options;
+			options.tolerance = lua_tonumber(L, 2);
+			if (top == 3)
+			{
+				std::string_view method = lua_tostring(L, 3);
+				if (method == "visvalingam") options.method = SimplifyMethod::Visvalingam;
+				else if (method != "rdp") l_booleanError(L, "simplify", "Method must be \"rdp\" or \"visvalingam\"");
+			}
+			if (options.tolerance < 0)
+				l_booleanError(L, "simplify", "Tolerance must not be negative");
+			SimplifyStats stats;
+			PushPolygonsDToLua(L, SimplifyPolygons(LuaTableToPolygonsD(L, 1), options, &stats));
+			lua_pushnumber(L, stats.Reduction());
+			return 2;
+		}
+
 		int l_area(lua_State* L)
 		{
 			if (lua_gettop(L) != 1 || !lua_istable(L, 1))
@@ -165,9 +243,13 @@ namespace HsBa::Slicer
 			{"intersection", l_intersection},
 			{"difference", l_difference},
 			{"xor", l_xor},
+			{"unionAll", l_unionAll},
+			{"intersectionAll", l_intersectionAll},
+			{"booleanBatch", l_booleanBatch},
 			{"offsetOperation", l_offsetOperation},
 			{"convexHullOperation", l_convexHullOperation},
 			{"concaveHullOperation", l_concaveHullOperation},
+			{"simplify", l_simplify},
 			{"area", l_area},
 	#ifdef HSBA_POLYGON_DUMP
 			{"dumpPolygon", l_dumpPolygon},
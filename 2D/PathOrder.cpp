@@ -0,0 +1,293 @@
+﻿#include "PathOrder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace HsBa::Slicer
+{
+	namespace
+	{
+		// average path ends per grid cell
+		constexpr double GRID_ENDS_PER_CELL = 2.0;
+		// the grid is rebuilt over the remaining ends once this fraction of them is left
+		constexpr double GRID_REBUILD_FRACTION = 0.25;
+		constexpr size_t TWO_OPT_CLOCK_INTERVAL = 256;
+
+		struct XY
+		{
+			double x, y;
+		};
+
+		inline double Distance(const XY& a, const XY& b)
+		{
+			return std::hypot(a.x - b.x, a.y - b.y);
+		}
+
+		// uniform grid over path ends, an entry is (path << 1) | atEnd. Cells are ranges of one
+		// array; taken paths are swapped out of them lazily while they are scanned
+		class EndGrid
+		{
+		public:
+			EndGrid(const std::vector<XY>& starts, const std::vector<XY>& ends, bool withEnds)
+				: starts_{ starts }, ends_{ ends }, withEnds_{ withEnds }, taken_(starts.size(), 0), remaining_{ starts.size() }
+			{
+				Build();
+			}
+
+			void Take(uint32_t path)
+			{
+				taken_[path] = 1;
+				--remaining_;
+				if (remaining_ > 0 && remaining_ < built_ * GRID_REBUILD_FRACTION) Build();
+			}
+
+			// nearest end of a path not taken yet, -1 if none is left
+			int64_t Nearest(const XY& from)
+			{
+				if (remaining_ == 0) return -1;
+				const int64_t cx = CellX(from.x), cy = CellY(from.y);
+				double best = std::numeric_limits<double>::max();
+				int64_t bestEntry = -1;
+				const int64_t maxRing = std::max(width_, height_);
+				for (int64_t ring = 0; ring <= maxRing; ++ring)
+				{
+					for (int64_t y = cy - ring; y <= cy + ring; ++y)
+					{
+						if (y < 0 || y >= height_) continue;
+						const bool edgeRow = y == cy - ring || y == cy + ring;
+						for (int64_t x = cx - ring; x <= cx + ring; x += edgeRow ? 1 : 2 * ring)
+						{
+							if (x >= 0 && x < width_) ScanCell(static_cast<size_t>(y * width_ + x), from, best, bestEntry);
+							if (ring == 0) break;
+						}
+					}
+					// anything outside this ring is at least ring cells away
+					if (bestEntry >= 0 && best <= ring * cell_) break;
+				}
+				return bestEntry;
+			}
+
+		private:
+			void Build()
+			{
+				double minX = std::numeric_limits<double>::max(), minY = minX;
+				double maxX = std::numeric_limits<double>::lowest(), maxY = maxX;
+				auto extend = [&](const XY& p) {
+					minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+					minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
+					};
+				for (size_t i = 0; i < starts_.size(); ++i)
+				{
+					if (taken_[i]) continue;
+					extend(starts_[i]);
+					if (withEnds_) extend(ends_[i]);
+				}
+				const double count = static_cast<double>(remaining_) * (withEnds_ ? 2 : 1);
+				const double spanX = std::max(maxX - minX, 1e-9), spanY = std::max(maxY - minY, 1e-9);
+				cell_ = std::max(std::sqrt(spanX * spanY * GRID_ENDS_PER_CELL / count), std::max(spanX, spanY) / 4096.0);
+				originX_ = minX;
+				originY_ = minY;
+				width_ = static_cast<int64_t>(spanX / cell_) + 1;
+				height_ = static_cast<int64_t>(spanY / cell_) + 1;
+				const size_t cells = static_cast<size_t>(width_ * height_);
+				// counting sort of the live ends into their cells
+				cellStart_.assign(cells + 1, 0);
+				auto cellOf = [&](const XY& p) { return static_cast<size_t>(CellY(p.y) * width_ + CellX(p.x)); };
+				for (uint32_t i = 0; i < starts_.size(); ++i)
+				{
+					if (taken_[i]) continue;
+					++cellStart_[cellOf(starts_[i]) + 1];
+					if (withEnds_) ++cellStart_[cellOf(ends_[i]) + 1];
+				}
+				for (size_t c = 0; c < cells; ++c) cellStart_[c + 1] += cellStart_[c];
+				cellCount_.assign(cells, 0);
+				entries_.resize(cellStart_[cells]);
+				for (uint32_t i = 0; i < starts_.size(); ++i)
+				{
+					if (taken_[i]) continue;
+					size_t c = cellOf(starts_[i]);
+					entries_[cellStart_[c] + cellCount_[c]++] = i << 1;
+					if (withEnds_)
+					{
+						c = cellOf(ends_[i]);
+						entries_[cellStart_[c] + cellCount_[c]++] = (i << 1) | 1u;
+					}
+				}
+				built_ = remaining_;
+			}
+
+			int64_t CellX(double x) const
+			{
+				return std::clamp<int64_t>(static_cast<int64_t>((x - originX_) / cell_), 0, width_ - 1);
+			}
+
+			int64_t CellY(double y) const
+			{
+				return std::clamp<int64_t>(static_cast<int64_t>((y - originY_) / cell_), 0, height_ - 1);
+			}
+
+			void ScanCell(size_t c, const XY& from, double& best, int64_t& bestEntry)
+			{
+				uint32_t* cell = entries_.data() + cellStart_[c];
+				uint32_t& count = cellCount_[c];
+				for (uint32_t k = 0; k < count;)
+				{
+					const uint32_t entry = cell[k];
+					if (taken_[entry >> 1])
+					{
+						cell[k] = cell[--count];
+						continue;
+					}
+					const double d = Distance(from, (entry & 1u) ? ends_[entry >> 1] : starts_[entry >> 1]);
+					if (d < best) { best = d; bestEntry = entry; }
+					++k;
+				}
+			}
+
+			const std::vector<XY>& starts_;
+			const std::vector<XY>& ends_;
+			bool withEnds_;
+			std::vector<char> taken_;
+			size_t remaining_;
+			size_t built_ = 0;
+			double cell_ = 1.0, originX_ = 0.0, originY_ = 0.0;
+			int64_t width_ = 1, height_ = 1;
+			std::vector<size_t> cellStart_;
+			std::vector<uint32_t> cellCount_;
+			std::vector<uint32_t> entries_;
+		};
+
+		struct Visit
+		{
+			uint32_t path;
+			bool reversed;
+		};
+
+		template <typename Paths>
+		Paths OrderPathsImpl(const Paths& paths, const PathOrderOptions& options, PathOrderStats* stats)
+		{
+			std::vector<uint32_t> source;
+			std::vector<XY> starts, ends;
+			for (uint32_t i = 0; i < paths.size(); ++i)
+			{
+				if (paths[i].empty()) continue;
+				const auto& first = paths[i].front();
+				const auto& last = options.closedPaths ? first : paths[i].back();
+				source.push_back(i);
+				starts.push_back({ static_cast<double>(first.x), static_cast<double>(first.y) });
+				ends.push_back({ static_cast<double>(last.x), static_cast<double>(last.y) });
+			}
+			const size_t n = source.size();
+			const XY origin{ options.startX, options.startY };
+			const bool reversible = options.allowReverse && !options.closedPaths;
+			auto entry = [&](const Visit& v) { return v.reversed ? ends[v.path] : starts[v.path]; };
+			auto exit = [&](const Visit& v) { return v.reversed ? starts[v.path] : ends[v.path]; };
+			auto travel = [&](const std::vector<Visit>& order) {
+				double sum = 0.0;
+				XY at = origin;
+				for (const auto& v : order)
+				{
+					sum += Distance(at, entry(v));
+					at = exit(v);
+				}
+				return sum;
+				};
+
+			std::vector<Visit> order;
+			order.reserve(n);
+			if (n > 0)
+			{
+				EndGrid grid(starts, ends, reversible);
+				XY at = origin;
+				for (size_t k = 0; k < n; ++k)
+				{
+					const auto e = static_cast<uint32_t>(grid.Nearest(at));
+					Visit v{ e >> 1, (e & 1u) != 0 };
+					grid.Take(v.path);
+					order.push_back(v);
+					at = exit(v);
+				}
+			}
+
+			// 2-opt: reversing order[i..j] also flips each path in it, so only the two
+			// connections at its borders change length
+			size_t moves = 0;
+			if ((reversible || options.closedPaths) && options.twoOptBudgetMs > 0 && n > 2)
+			{
+				const auto deadline = std::chrono::steady_clock::now() +
+					std::chrono::duration<double, std::milli>(options.twoOptBudgetMs);
+				const size_t window = std::max<size_t>(2, options.twoOptWindow);
+				size_t checks = 0;
+				bool improved = true, outOfTime = false;
+				while (improved && !outOfTime)
+				{
+					improved = false;
+					for (size_t i = 0; i + 1 < n && !outOfTime; ++i)
+					{
+						const XY before = i == 0 ? origin : exit(order[i - 1]);
+						for (size_t j = i + 1; j < std::min(n, i + window); ++j)
+						{
+							if (++checks % TWO_OPT_CLOCK_INTERVAL == 0 && std::chrono::steady_clock::now() > deadline)
+							{
+								outOfTime = true;
+								break;
+							}
+							double current = Distance(before, entry(order[i]));
+							double swapped = Distance(before, exit(order[j]));
+							if (j + 1 < n)
+							{
+								const XY after = entry(order[j + 1]);
+								current += Distance(exit(order[j]), after);
+								swapped += Distance(entry(order[i]), after);
+							}
+							if (swapped + 1e-9 < current)
+							{
+								std::reverse(order.begin() + i, order.begin() + j + 1);
+								for (size_t k = i; k <= j; ++k) order[k].reversed = reversible && !order[k].reversed;
+								++moves;
+								improved = true;
+							}
+						}
+					}
+				}
+			}
+
+			Paths res;
+			res.reserve(n);
+			size_t reversed = 0;
+			for (const auto& v : order)
+			{
+				res.push_back(paths[source[v.path]]);
+				if (v.reversed)
+				{
+					std::reverse(res.back().begin(), res.back().end());
+					++reversed;
+				}
+			}
+			if (stats)
+			{
+				std::vector<Visit> generation(n);
+				for (uint32_t i = 0; i < n; ++i) generation[i] = { i, false };
+				stats->travelBefore = travel(generation);
+				stats->travelAfter = travel(order);
+				stats->reversed = reversed;
+				stats->twoOptMoves = moves;
+			}
+			return res;
+		}
+	} // namespace
+
+	Polygons OrderPaths(const Polygons& paths, const PathOrderOptions& options, PathOrderStats* stats)
+	{
+		return OrderPathsImpl(paths, options, stats);
+	}
+
+	PolygonsD OrderPaths(const PolygonsD& paths, const PathOrderOptions& options, PathOrderStats* stats)
+	{
+		return OrderPathsImpl(paths, options, stats);
+	}
+} // namespace HsBa::Slicer
@@ -0,0 +1,41 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_PATHORDER_HPP
+#define HSBA_SLICER_PATHORDER_HPP
+
+#include <cstddef>
+
+#include "FloatPolygons.hpp"
+
+namespace HsBa::Slicer
+{
+	struct PathOrderOptions
+	{
+		// position of the tool before the first path, in the units of the paths
+		double startX = 0.0;
+		double startY = 0.0;
+		// open paths may be printed end to start
+		bool allowReverse = true;
+		// closed paths are left where they started, so entry and exit are the first vertex
+		bool closedPaths = false;
+		// time for 2-opt improvement of the greedy order, 0 skips it
+		double twoOptBudgetMs = 0.0;
+		// neighbours after a path that 2-opt tries to swap it with
+		size_t twoOptWindow = 32;
+	};
+
+	struct PathOrderStats
+	{
+		double travelBefore = 0.0;
+		double travelAfter = 0.0;
+		size_t reversed = 0;
+		size_t twoOptMoves = 0;
+	};
+
+	// Orders paths to shorten the non-printing travel between them: greedy nearest neighbour over
+	// a grid index of path ends, then windowed 2-opt within the time budget. Paths are returned
+	// reordered and, if allowed, reversed; empty paths are dropped
+	Polygons OrderPaths(const Polygons& paths, const PathOrderOptions& options = {}, PathOrderStats* stats = nullptr);
+	PolygonsD OrderPaths(const PolygonsD& paths, const PathOrderOptions& options = {}, PathOrderStats* stats = nullptr);
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_PATHORDER_HPP
@@ -5,9 +5,16 @@
 #include <sstream>
 #include <numbers>
 #include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "base/error.hpp"
 #include "base/template_helper.hpp"
+#include "base/thread_pool.hpp"
+#include "BoundedPolygons.hpp"
+#include "PathOrder.hpp"
 #include "LuaAdapter.hpp"
 #include "utils/LuaNewObject.hpp"
 
@@ -22,6 +29,7 @@ namespace HsBa::Slicer
 		constexpr int LARGE_ROW_OFFSET = 1000000;
 		constexpr double ANGLE_EPSILON = 12.0;
 		constexpr double INTEGERIZATION_PRECISION = 100.0;
+		constexpr int GYROID_SAMPLES_PER_PERIOD = 32;
 
 		Polygon ClosePath(const Polygon& p)
 		{
@@ -31,23 +39,26 @@ namespace HsBa::Slicer
 			return res;
 		}
 
-		std::vector<std::vector<std::pair<Point2D, Point2D>>> LineFilling(const Polygons& poly, double spacing, double angle_deg, double lineThickness, double& ux, double& uy, PolygonsD& polyD)
+		// fill temporaries, allocated from the scratch resource of the call
+		using Segment = std::pair<Point2D, Point2D>;
+		using SegmentRows = std::pmr::vector<std::pmr::vector<Segment>>;
+		using ScratchPolyline = std::pmr::vector<Point2D>;
+
+		std::pmr::memory_resource* ScratchOrDefault(std::pmr::memory_resource* scratch)
 		{
-			std::vector<std::vector<std::pair<Point2D, Point2D>>> rows;
-			polyD = UnIntegerization(poly);
+			return scratch != nullptr ? scratch : std::pmr::get_default_resource();
+		}
 
-			double minx = 1e300, miny = 1e300, maxx = -1e300, maxy = -1e300;
-			for (auto& ps : polyD)
-			{
-				for (const auto& pt : ps)
-				{
-					minx = std::min(minx, pt.x);
-					miny = std::min(miny, pt.y);
-					maxx = std::max(maxx, pt.x);
-					maxy = std::max(maxy, pt.y);
-				}
-			}
-			if (minx > maxx) return rows;
+		// bounded views the layer of the fill, its bounds are computed once per fill and skip
+		// the paths far from each scanline
+		SegmentRows LineFilling(const BoundedPolygons& bounded, double spacing, double angle_deg, double lineThickness, double& ux, double& uy,
+			std::pmr::memory_resource* scratch)
+		{
+			SegmentRows rows{ scratch };
+			if (bounded.empty()) return rows;
+			const auto& box = bounded.Bounds();
+			double minx = box.left / integerization, miny = box.top / integerization;
+			double maxx = box.right / integerization, maxy = box.bottom / integerization;
 
 			double ang = angle_deg * std::numbers::pi_v<double> / DEG_TO_RAD_FACTOR;
 			ux = std::cos(ang), uy = std::sin(ang);
@@ -64,6 +75,12 @@ namespace HsBa::Slicer
 			}
 
 			double length = std::hypot(maxx - minx, maxy - miny) * 2.0;
+			// projections are taken straight from the integer coordinates, scaled once per piece
+			const double us = ux / integerization, uys = uy / integerization;
+			const double vs = vx / integerization, vys = vy / integerization;
+			PolygonD rect(4);
+			Polygons rectPaths(1);
+			BoundedPolygons rectI{ rectPaths };
 			for (double t = minProj - spacing; t <= maxProj + spacing; t += spacing)
 			{
 				double cx = vx * t;
@@ -76,26 +93,26 @@ namespace HsBa::Slicer
 				double pvx = -uy, pvy = ux;
 				double rx = pvx * half, ry = pvy * half;
 
-				PolygonD rect;
-				rect.emplace_back(Point2D{ p1x + rx, p1y + ry });
-				rect.emplace_back(Point2D{ p2x + rx, p2y + ry });
-				rect.emplace_back(Point2D{ p2x - rx, p2y - ry });
-				rect.emplace_back(Point2D{ p1x - rx, p1y - ry });
+				rect[0] = Point2D{ p1x + rx, p1y + ry };
+				rect[1] = Point2D{ p2x + rx, p2y + ry };
+				rect[2] = Point2D{ p2x - rx, p2y - ry };
+				rect[3] = Point2D{ p1x - rx, p1y - ry };
 
-				Polygon rectI = Integerization(rect);
-				Polygons clipped = Intersection(poly, Polygons{ rectI });
+				rectPaths.front() = Integerization(rect);
+				rectI.Refresh();
+				Polygons clipped = Intersection(bounded, rectI);
 
-				std::vector<std::pair<Point2D, Point2D>> segs;
-				for (auto& c : clipped)
+				std::pmr::vector<Segment> segs{ scratch };
+				for (const auto& c : clipped)
 				{
-					PolygonD pc = UnIntegerization(c);
-					if (pc.empty()) continue;
+					if (c.empty()) continue;
 					double s_min = 1e300, s_max = -1e300;
 					double p_sum = 0; int cnt = 0;
-					for (auto& v : pc)
+					for (const auto& v : c)
 					{
-						double s = v.x * ux + v.y * uy;
-						double p = v.x * vx + v.y * vy;
+						const auto x = static_cast<double>(v.x), y = static_cast<double>(v.y);
+						double s = x * us + y * uys;
+						double p = x * vs + y * vys;
 						s_min = std::min(s_min, s);
 						s_max = std::max(s_max, s);
 						p_sum += p; ++cnt;
@@ -121,6 +138,108 @@ namespace HsBa::Slicer
 			return rows;
 		}
 
+		// bounds of the layer in a frame rotated by -angle, patterns are built there and rotated back.
+		// Integer layers are scaled on the fly instead of converting the whole layer first
+		template <typename Paths>
+		Clipper2Lib::RectD LocalBounds(const Paths& polys, double ang)
+		{
+			double c = std::cos(ang), s = std::sin(ang);
+			if constexpr (std::is_same_v<Paths, Polygons>)
+			{
+				c /= integerization;
+				s /= integerization;
+			}
+			Clipper2Lib::RectD box{ 1e300, 1e300, -1e300, -1e300 };
+			for (const auto& ps : polys)
+			{
+				for (const auto& pt : ps)
+				{
+					const auto px = static_cast<double>(pt.x), py = static_cast<double>(pt.y);
+					double x = px * c + py * s;
+					double y = -px * s + py * c;
+					box.left = std::min(box.left, x);
+					box.top = std::min(box.top, y);
+					box.right = std::max(box.right, x);
+					box.bottom = std::max(box.bottom, y);
+				}
+			}
+			return box;
+		}
+
+		// rotate a local-frame pattern back by angle and clip it against the layer in one boolean
+		Polygons ClipPattern(const Polygons& poly, PolygonsD& pattern, double ang)
+		{
+			double c = std::cos(ang), s = std::sin(ang);
+			Polygons open;
+			open.reserve(pattern.size());
+			for (auto& path : pattern)
+			{
+				Polygon pi;
+				pi.reserve(path.size());
+				for (const auto& pt : path)
+				{
+					pi.emplace_back(Point2{ (pt.x * c - pt.y * s) * integerization, (pt.x * s + pt.y * c) * integerization });
+				}
+				open.emplace_back(std::move(pi));
+			}
+			auto& clipper = ThreadLocalClipper();
+			clipper.AddOpenSubject(open);
+			clipper.AddClip(poly);
+			Polygons closed, res;
+			clipper.Execute(Clipper2Lib::ClipType::Intersection, Clipper2Lib::FillRule::EvenOdd, closed, res);
+			clipper.Clear();
+			return res;
+		}
+
+		// parallel lines y = n * spacing + shift of the local frame, anchored at the origin
+		// so that consecutive layers line up
+		void AppendLineFamily(PolygonsD& out, const Clipper2Lib::RectD& box, double spacing, double shift)
+		{
+			auto first = static_cast<int64_t>(std::floor((box.top - shift) / spacing));
+			auto last = static_cast<int64_t>(std::ceil((box.bottom - shift) / spacing));
+			for (auto n = first; n <= last; ++n)
+			{
+				double y = n * spacing + shift;
+				out.push_back(PolygonD{ Point2D{ box.left, y }, Point2D{ box.right, y } });
+			}
+		}
+
+		Clipper2Lib::RectD RotateBounds(const Clipper2Lib::RectD& box, double ang)
+		{
+			PolygonsD corners{ PolygonD{ Point2D{ box.left, box.top }, Point2D{ box.right, box.top },
+				Point2D{ box.right, box.bottom }, Point2D{ box.left, box.bottom } } };
+			return LocalBounds(corners, ang);
+		}
+
+		// lines of three families rotated by 0, 60 and 120 degrees; they share
+		// their crossings, so the pattern is a grid of equilateral triangles
+		Polygons ThreeFamilyFill(const Polygons& poly, double spacing, double angle_deg, double shift)
+		{
+			if (spacing <= 0 || poly.empty()) return {};
+			double ang = angle_deg * std::numbers::pi_v<double> / DEG_TO_RAD_FACTOR;
+			Polygons res;
+			auto box = LocalBounds(poly, ang);
+			if (box.left > box.right) return res;
+			// all three families are generated in the base frame and rotated, then clipped together
+			PolygonsD pattern;
+			for (int i = 0; i != 3; ++i)
+			{
+				double rot = i * std::numbers::pi_v<double> / 3.0;
+				PolygonsD family;
+				AppendLineFamily(family, RotateBounds(box, rot), spacing, shift);
+				double c = std::cos(rot), s = std::sin(rot);
+				for (auto& line : family)
+				{
+					for (auto& pt : line)
+					{
+						pt = Point2D{ pt.x * c - pt.y * s, pt.x * s + pt.y * c };
+					}
+					pattern.emplace_back(std::move(line));
+				}
+			}
+			return ClipPattern(poly, pattern, ang);
+		}
+
 		Polygons OffsetOnly(const Polygons poly, double delta, size_t inner,
 			size_t outer, Clipper2Lib::JoinType join_type, std::pair<Polygons, Polygons>& out_inner_outer)
 		{
@@ -383,6 +502,90 @@ namespace HsBa::Slicer
 			return 3;
 		}
 		
+		int l_multiIslandFill(lua_State* L)
+		{
+			PolygonsD polyD = LuaTableToPolygonsD(L, 1);
+			Polygons poly = Integerization(polyD);
+			double spacing = lua_tonumber(L, 2);
+			double angle_deg = lua_tonumber(L, 3);
+			FillMode mode = FillMode::Line;
+			const char* mode_str = lua_tostring(L, 4);
+			if (mode_str == nullptr)
+				return l_report(L, "multiIslandFill", "Expected a fill mode string");
+			if (strcmp(mode_str, "Line") == 0)
+				mode = FillMode::Line;
+			else if (strcmp(mode_str, "SimpleZigzag") == 0)
+				mode = FillMode::SimpleZigzag;
+			else if (strcmp(mode_str, "Zigzag") == 0)
+				mode = FillMode::Zigzag;
+			double lineThickness = lua_tonumber(L, 5);
+			Polygons res = MultiIslandFill(poly, mode, spacing, angle_deg, lineThickness);
+			PushPolygonsDToLua(L, UnIntegerization(res));
+			return 1;
+		}
+
+		int l_gyroidFill(lua_State* L)
+		{
+			PolygonsD polyD = LuaTableToPolygonsD(L, 1);
+			Polygons poly = Integerization(polyD);
+			double spacing = lua_tonumber(L, 2);
+			double z = lua_tonumber(L, 3);
+			double angle_deg = lua_tonumber(L, 4);
+			Polygons res = GyroidFill(poly, spacing, z, angle_deg);
+			PushPolygonsDToLua(L, UnIntegerization(res));
+			return 1;
+		}
+
+		int l_honeycombFill(lua_State* L)
+		{
+			PolygonsD polyD = LuaTableToPolygonsD(L, 1);
+			Polygons poly = Integerization(polyD);
+			double spacing = lua_tonumber(L, 2);
+			double angle_deg = lua_tonumber(L, 3);
+			Polygons res = HoneycombFill(poly, spacing, angle_deg);
+			PushPolygonsDToLua(L, UnIntegerization(res));
+			return 1;
+		}
+
+		int l_triangularFill(lua_State* L)
+		{
+			PolygonsD polyD = LuaTableToPolygonsD(L, 1);
+			Polygons poly = Integerization(polyD);
+			double spacing = lua_tonumber(L, 2);
+			double angle_deg = lua_tonumber(L, 3);
+			Polygons res = TriangularFill(poly, spacing, angle_deg);
+			PushPolygonsDToLua(L, UnIntegerization(res));
+			return 1;
+		}
+
+		int l_cubicFill(lua_State* L)
+		{
+			PolygonsD polyD = LuaTableToPolygonsD(L, 1);
+			Polygons poly = Integerization(polyD);
+			double spacing = lua_tonumber(L, 2);
+			double z = lua_tonumber(L, 3);
+			double angle_deg = lua_tonumber(L, 4);
+			Polygons res = CubicFill(poly, spacing, z, angle_deg);
+			PushPolygonsDToLua(L, UnIntegerization(res));
+			return 1;
+		}
+
+		// orderPaths(paths[, allowReverse[, twoOptBudgetMs[, startX, startY]]]) -> ordered paths
+		int l_orderPaths(lua_State* L)
+		{
+			PolygonsD paths = LuaTableToPolygonsD(L, 1);
+			PathOrderOptions options;
+			if (lua_gettop(L) >= 2) options.allowReverse = lua_toboolean(L, 2);
+			if (lua_gettop(L) >= 3) options.twoOptBudgetMs = lua_tonumber(L, 3);
+			if (lua_gettop(L) >= 5)
+			{
+				options.startX = lua_tonumber(L, 4);
+				options.startY = lua_tonumber(L, 5);
+			}
+			PushPolygonsDToLua(L, OrderPaths(paths, options));
+			return 1;
+		}
+
 		const luaL_Reg polygonFillLib[] = {
 			{"offsetFill", l_offsetFill},
 			{"lineFill", l_lineFill},
@@ -391,6 +594,12 @@ namespace HsBa::Slicer
 			{"compositeOffsetFill", l_compositeOffsetFill},
 			{"hybridFill", l_hybridFill},
 			{"offsetOnly", l_offsetOnly},
+			{"multiIslandFill", l_multiIslandFill},
+			{"gyroidFill", l_gyroidFill},
+			{"honeycombFill", l_honeycombFill},
+			{"triangularFill", l_triangularFill},
+			{"cubicFill", l_cubicFill},
+			{"orderPaths", l_orderPaths},
 			{NULL, nullptr}
 		};
 
@@ -427,11 +636,12 @@ namespace HsBa::Slicer
 	}
 
 	// Generate independent straight line segments (each Path has exactly 2 points)
-	Polygons LineFill(const Polygons& poly, double spacing, double angle_deg, double /*lineThickness*/)
+	Polygons LineFill(const Polygons& poly, double spacing, double angle_deg, double /*lineThickness*/,
+		std::pmr::memory_resource* scratch)
 	{
 		double ux, uy;
-		PolygonsD polyD;
-		auto rows = LineFilling(poly, spacing, angle_deg, 1.0, ux, uy, polyD);
+		const BoundedPolygons bounded{ poly };
+		auto rows = LineFilling(bounded, spacing, angle_deg, 1.0, ux, uy, ScratchOrDefault(scratch));
 		(void)ux; (void)uy;
 		Polygons res;
 		for (const auto& r : rows)
@@ -447,21 +657,139 @@ namespace HsBa::Slicer
 		return res;
 	}
 
+	// Gyroid: the level set sin(x)cos(y) + sin(y)cos(z) + sin(z)cos(x) = 0 at the layer height.
+	// Solved in closed form along x (or along y when |sin z| > |cos z|, where the x solution would
+	// break up), adjacent waves are spacing apart.
+	Polygons GyroidFill(const Polygons& poly, double spacing, double z, double angle_deg)
+	{
+		Polygons res;
+		if (spacing <= 0 || poly.empty()) return res;
+		double ang = angle_deg * std::numbers::pi_v<double> / DEG_TO_RAD_FACTOR;
+		auto box = LocalBounds(poly, ang);
+		if (box.left > box.right) return res;
+
+		constexpr double twoPi = 2.0 * std::numbers::pi_v<double>;
+		const double scale = spacing / std::numbers::pi_v<double>;
+		const double zs = std::sin(z / scale), zc = std::cos(z / scale);
+		const bool vertical = std::abs(zs) > std::abs(zc);
+
+		// (u, w): u runs along the waves, w across them
+		double umin = (vertical ? box.top : box.left) / scale;
+		double umax = (vertical ? box.bottom : box.right) / scale;
+		double wmin = (vertical ? box.left : box.top) / scale;
+		double wmax = (vertical ? box.right : box.bottom) / scale;
+		const double du = twoPi / GYROID_SAMPLES_PER_PERIOD;
+		auto ufirst = static_cast<int64_t>(std::floor(umin / du)) - 1;
+		auto ulast = static_cast<int64_t>(std::ceil(umax / du)) + 1;
+
+		// phase and half-width of the solution at u: w = phase +- spread + 2 pi k
+		auto solve = [&](double u, double& phase, double& spread) {
+			double a = vertical ? std::cos(u) : std::sin(u);
+			double b = vertical ? zs : zc;
+			double c = vertical ? -std::sin(u) * zc : -zs * std::cos(u);
+			double r = std::hypot(a, b);
+			phase = vertical ? std::atan2(a, b) : std::atan2(b, a);
+			spread = std::acos(std::clamp(c / r, -1.0, 1.0));
+			};
+
+		PolygonsD pattern;
+		auto kfirst = static_cast<int64_t>(std::floor(wmin / twoPi)) - 1;
+		auto klast = static_cast<int64_t>(std::ceil(wmax / twoPi)) + 1;
+		for (auto k = kfirst; k <= klast; ++k)
+		{
+			for (double sign : { 1.0, -1.0 })
+			{
+				PolygonD wave;
+				wave.reserve(static_cast<size_t>(ulast - ufirst + 1));
+				for (auto i = ufirst; i <= ulast; ++i)
+				{
+					double u = i * du, phase, spread;
+					solve(u, phase, spread);
+					double w = phase + sign * spread + twoPi * k;
+					if (vertical)
+						wave.emplace_back(Point2D{ w * scale, u * scale });
+					else
+						wave.emplace_back(Point2D{ u * scale, w * scale });
+				}
+				pattern.emplace_back(std::move(wave));
+			}
+		}
+		return ClipPattern(poly, pattern, ang);
+	}
+
+	// Honeycomb of hexagons with opposite walls spacing apart. Columns of vertical walls sit at
+	// x = k * spacing / 2; each pair of columns (2j, 2j + 1) is one zigzag path, the short
+	// diagonals joining neighbouring pairs are separate segments so no wall is laid twice.
+	Polygons HoneycombFill(const Polygons& poly, double spacing, double angle_deg)
+	{
+		Polygons res;
+		if (spacing <= 0 || poly.empty()) return res;
+		double ang = angle_deg * std::numbers::pi_v<double> / DEG_TO_RAD_FACTOR;
+		auto box = LocalBounds(poly, ang);
+		if (box.left > box.right) return res;
+
+		const double side = spacing / std::numbers::sqrt3_v<double>;
+		const double h = spacing * 0.5;
+		const double period = 3.0 * side;
+		auto kfirst = static_cast<int64_t>(std::floor(box.left / h)) - 2;
+		if (kfirst % 2 != 0) --kfirst;
+		auto klast = static_cast<int64_t>(std::ceil(box.right / h)) + 2;
+		auto mfirst = static_cast<int64_t>(std::floor(box.top / period)) - 1;
+		auto mlast = static_cast<int64_t>(std::ceil(box.bottom / period)) + 1;
+
+		PolygonsD pattern;
+		for (auto k = kfirst; k <= klast; k += 2)
+		{
+			double x0 = k * h, x1 = (k + 1) * h, x2 = (k + 2) * h;
+			PolygonD zig;
+			zig.reserve(static_cast<size_t>(mlast - mfirst + 1) * 4);
+			for (auto m = mfirst; m <= mlast; ++m)
+			{
+				double y = m * period;
+				zig.emplace_back(Point2D{ x0, y });
+				zig.emplace_back(Point2D{ x0, y + side });
+				zig.emplace_back(Point2D{ x1, y + 1.5 * side });
+				zig.emplace_back(Point2D{ x1, y + 2.5 * side });
+				// diagonals to the next pair
+				pattern.push_back(PolygonD{ Point2D{ x2, y + side }, Point2D{ x1, y + 1.5 * side } });
+				pattern.push_back(PolygonD{ Point2D{ x1, y + 2.5 * side }, Point2D{ x2, y + period } });
+			}
+			pattern.emplace_back(std::move(zig));
+		}
+		return ClipPattern(poly, pattern, ang);
+	}
+
+	Polygons TriangularFill(const Polygons& poly, double spacing, double angle_deg)
+	{
+		return ThreeFamilyFill(poly, spacing, angle_deg, 0.0);
+	}
+
+	// Cubic: the triangular families slide along their normals with z, which stacks into
+	// cubes standing on a corner
+	Polygons CubicFill(const Polygons& poly, double spacing, double z, double angle_deg)
+	{
+		if (spacing <= 0) return {};
+		double shift = std::fmod(z / std::numbers::sqrt2_v<double>, spacing);
+		return ThreeFamilyFill(poly, spacing, angle_deg, shift);
+	}
+
 	// Generate a connected zigzag path by connecting centers of line segments across scanlines,
 	// then return that path as a single integer polyline (no extrusion performed here).
-	Polygons SimpleZigzagFill(const Polygons& poly, double spacing, double angle_deg, double lineThickness)
+	Polygons SimpleZigzagFill(const Polygons& poly, double spacing, double angle_deg, double lineThickness,
+		std::pmr::memory_resource* scratch)
 	{
 		Polygons res;
 		if (spacing <= 0) return res;
 
+		scratch = ScratchOrDefault(scratch);
 		double ux, uy;
-		PolygonsD polyD;
-		auto rows = LineFilling(poly, spacing, angle_deg, lineThickness, ux, uy, polyD);
+		const BoundedPolygons bounded{ poly };
+		auto rows = LineFilling(bounded, spacing, angle_deg, lineThickness, ux, uy, scratch);
 
 		// helpers
 		auto point_inside = [&](const Point2D& pt)->bool {
 			Clipper2Lib::Point64 p64{ (int64_t)std::llround(pt.x * integerization), (int64_t)std::llround(pt.y * integerization) };
-			auto r = PointInPolygons(p64, poly);
+			auto r = PointInPolygons(p64, bounded);
 			return r != Clipper2Lib::PointInPolygonResult::IsOutside;
 		};
 
@@ -501,7 +829,7 @@ namespace HsBa::Slicer
 		};
 
 		// Build polylines, only allowing connectors between the same row or adjacent rows.
-		std::vector<std::vector<Point2D>> polylines;
+		std::pmr::vector<ScratchPolyline> polylines{ scratch };
 		int current_row = -LARGE_ROW_OFFSET;
 		for (size_t r = 0; r < rows.size(); ++r)
 		{
@@ -618,14 +946,15 @@ namespace HsBa::Slicer
 	}
 
 	Polygons ZigzagFill(const Polygons& poly, double spacing, double angle_deg,
-		double lineThickness)
+		double lineThickness, std::pmr::memory_resource* scratch)
 	{
 		Polygons res;
 		if (spacing <= 0) return res;
 
+		scratch = ScratchOrDefault(scratch);
 		double ux = 0, uy = 0;
-		PolygonsD polyD;
-		auto rows = LineFilling(poly, spacing, angle_deg, lineThickness, ux, uy, polyD);
+		const BoundedPolygons bounded{ poly };
+		auto rows = LineFilling(bounded, spacing, angle_deg, lineThickness, ux, uy, scratch);
 
 		// sort each row by s_min
 		for (auto& segs : rows)
@@ -639,7 +968,7 @@ namespace HsBa::Slicer
 
 		// flatten segments and compute connectivity (islands)
 		struct SegInfo { size_t row; size_t idx; Point2D a, b; double s_min, s_max; };
-		std::vector<SegInfo> segList;
+		std::pmr::vector<SegInfo> segList{ scratch };
 		for (size_t r = 0; r < rows.size(); ++r)
 		{
 			for (size_t i = 0; i < rows[r].size(); ++i)
@@ -653,7 +982,7 @@ namespace HsBa::Slicer
 		size_t N = segList.size();
 		if (N == 0) return res;
 
-		std::vector<size_t> parent(N);
+		std::pmr::vector<size_t> parent(N, scratch);
 		for (size_t i = 0; i < N; ++i) parent[i] = i;
 #ifndef __cpp_explicit_this_parameter
 		auto findp = Utils::YCombinator([&](auto&& self, size_t x) -> size_t {
@@ -669,7 +998,7 @@ namespace HsBa::Slicer
 		auto unite = [&](size_t a, size_t b) { size_t pa = findp(a), pb = findp(b); if (pa != pb) parent[pa] = pb; };
 
 		// index mapping
-		std::vector<std::vector<size_t>> segIndex(rows.size());
+		std::pmr::vector<std::pmr::vector<size_t>> segIndex(rows.size(), scratch);
 		size_t idx = 0;
 		for (size_t r = 0; r < rows.size(); ++r)
 		{
@@ -694,8 +1023,8 @@ namespace HsBa::Slicer
 		}
 
 		// components
-		std::unordered_map<size_t, int> compMap;
-		std::vector<int> compId(N, -1);
+		std::pmr::unordered_map<size_t, int> compMap{ scratch };
+		std::pmr::vector<int> compId(N, -1, scratch);
 		int compCnt = 0;
 		for (size_t i = 0; i < N; ++i)
 		{
@@ -708,7 +1037,7 @@ namespace HsBa::Slicer
 		// point inside helper and clamping helpers
 		auto point_inside = [&](const Point2D& pt)->bool {
 			Clipper2Lib::Point64 p64{ (int64_t)std::llround(pt.x * integerization), (int64_t)std::llround(pt.y * integerization) };
-			auto r = PointInPolygons(p64, poly);
+			auto r = PointInPolygons(p64, bounded);
 			return r != Clipper2Lib::PointInPolygonResult::IsOutside;
 		};
 
@@ -739,11 +1068,11 @@ namespace HsBa::Slicer
 		};
 
 		// re-use build_bridge logic from previous implementation (adapted)
-		auto build_bridge = [&](Point2D ca, Point2D cb)->std::vector<Point2D>
+		auto build_bridge = [&](Point2D ca, Point2D cb)->ScratchPolyline
 		{
-			std::vector<Point2D> path;
+			ScratchPolyline path{ scratch };
 			if (point_inside(ca) && point_inside(cb)) {
-				path = { ca,cb };
+				path.assign({ ca, cb });
 				return path;
 			}
 			const int steps = MAX_BINARY_SEARCH_ITERATIONS;
@@ -758,9 +1087,9 @@ namespace HsBa::Slicer
 				Point2D p{ ca.x * (1 - t) + cb.x * t, ca.y * (1 - t) + cb.y * t };
 				if (!ok2 && point_inside(p)) { p2 = p; ok2 = true; }
 			}
-			if (!ok1 || !ok2) return {};
-			PolygonD outer = polyD[0];
-			if (Clipper2Lib::Area(Integerization(outer)) < 0) std::reverse(outer.begin(), outer.end());
+			if (!ok1 || !ok2) return path;
+			PolygonD outer = UnIntegerization(poly[0]);
+			if (Clipper2Lib::Area(poly[0]) < 0) std::reverse(outer.begin(), outer.end());
 			auto distOnRing = [&](size_t i, size_t j)->double {
 				double d = 0;
 				for (size_t k = i; k != j; k = (k + 1) % outer.size()) {
@@ -778,14 +1107,14 @@ namespace HsBa::Slicer
 			}
 			double dCW = distOnRing(i1, i2);
 			double dCCW = distOnRing(i2, i1);
-			std::vector<Point2D> arc;
+			ScratchPolyline arc{ scratch };
 			if (dCW < dCCW) {
 				for (size_t k = i1;; k = (k + 1) % outer.size()) { arc.push_back(outer[k]); if (k == i2)break; }
 			}
 			else {
 				for (size_t k = i1;; k = (k + outer.size() - 1) % outer.size()) { arc.push_back(outer[k]); if (k == i2)break; }
 			}
-			std::vector<Point2D> samp;
+			ScratchPolyline samp{ scratch };
 			samp.push_back(p1);
 			double acc = 0, step = std::min(0.5 * integerization, lineThickness * 2.0);
 			for (size_t i = 1; i < arc.size(); i++) {
@@ -809,15 +1138,15 @@ namespace HsBa::Slicer
 		};
 
 		// Build polylines only connecting same row or adjacent rows to avoid loops
-		std::vector<std::vector<Point2D>> polylines;
+		std::pmr::vector<ScratchPolyline> polylines{ scratch };
 		// collect extra straight segments when connector/bridge fails
-		std::vector<Polygon> extraLines;
+		std::pmr::vector<Polygon> extraLines{ scratch };
 		int prev_row = -LARGE_ROW_OFFSET;
 		bool have_prev = false;
 		int prev_comp_local = -1;
 		double eps = (integerization / INTEGERIZATION_PRECISION) / integerization;
 
-		auto push_seg_to_current = [&](std::vector<Point2D>& pl, const Point2D& aa, const Point2D& bb) {
+		auto push_seg_to_current = [&](ScratchPolyline& pl, const Point2D& aa, const Point2D& bb) {
 			if (pl.empty()) { pl.push_back(aa); pl.push_back(bb); return; }
 			if (std::hypot(pl.back().x - aa.x, pl.back().y - aa.y) > 1e-9) pl.push_back(aa);
 			pl.push_back(bb);
@@ -980,11 +1309,11 @@ namespace HsBa::Slicer
 			if (pl.empty()) continue;
 			Polygon out; out.reserve(pl.size());
 			for (auto &p : pl) out.emplace_back(Point2{ (int64_t)std::llround(p.x * integerization), (int64_t)std::llround(p.y * integerization) });
-			res.emplace_back(out);
+			res.emplace_back(std::move(out));
 		}
 
 		// append any extra straight segments that failed to connect
-		for (auto &ln : extraLines) res.push_back(ln);
+		for (auto &ln : extraLines) res.push_back(std::move(ln));
 		return res;
 	}
 
@@ -1098,6 +1427,76 @@ namespace HsBa::Slicer
 		return res;
 	}
 
+	Polygons MultiIslandFill(const Polygons& layer, const IslandFillFunc& fill, ThreadPool* pool)
+	{
+		Polygons res;
+		if (!fill) return res;
+		auto islands = SplitIslands(layer);
+		std::vector<Polygons> filled(islands.size());
+		if (pool != nullptr && islands.size() > 1)
+		{
+			std::vector<std::future<Polygons>> futures;
+			futures.reserve(islands.size());
+			for (const auto& island : islands)
+			{
+				futures.emplace_back(pool->submit([&fill, &island]() { return fill(island); }));
+			}
+			// every task references locals, so collect all of them before rethrowing
+			std::exception_ptr error;
+			for (size_t i = 0; i < futures.size(); ++i)
+			{
+				try
+				{
+					filled[i] = futures[i].get();
+				}
+				catch (...)
+				{
+					if (!error) error = std::current_exception();
+				}
+			}
+			if (error) std::rethrow_exception(error);
+		}
+		else
+		{
+			for (size_t i = 0; i < islands.size(); ++i)
+			{
+				filled[i] = fill(islands[i]);
+			}
+		}
+		size_t total = 0;
+		for (const auto& f : filled) total += f.size();
+		res.reserve(total);
+		for (auto& f : filled)
+		{
+			std::move(f.begin(), f.end(), std::back_inserter(res));
+		}
+		return res;
+	}
+
+	Polygons MultiIslandFill(const Polygons& layer, FillMode mode, double spacing,
+		double angle_deg, double lineThickness, ThreadPool* pool)
+	{
+		return MultiIslandFill(layer, [=](const Polygons& island) -> Polygons {
+			// temporaries of an island live in the arena of the thread filling it and are
+			// dropped together once the island is done, the result is allocated normally
+			auto& arena = ThreadLocalArena();
+			struct ArenaRelease
+			{
+				std::pmr::monotonic_buffer_resource& arena;
+				~ArenaRelease() { arena.release(); }
+			} release{ arena };
+			switch (mode)
+			{
+			case FillMode::Line:
+				return LineFill(island, spacing, angle_deg, lineThickness, &arena);
+			case FillMode::SimpleZigzag:
+				return SimpleZigzagFill(island, spacing, angle_deg, lineThickness, &arena);
+			default:
+				return ZigzagFill(island, spacing, angle_deg, lineThickness, &arena);
+			}
+			}, pool);
+	}
+
 	// LuaCustomFill: call Lua script function to generate table of polylines/polygons
 	Polygons LuaCustomFill(const Polygons& poly, const std::string& scriptPath, const std::string& functionName,
 		double lineThickness, const std::function<void(lua_State*)>& lua_reg)
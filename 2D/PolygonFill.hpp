@@ -5,26 +5,41 @@
 #include "IntPolygon.hpp"
 #include "FloatPolygons.hpp"
 #include <functional>
+#include <memory_resource>
 
 // forward-declare lua state to avoid including lua.hpp in this header
 struct lua_State;
 
 namespace HsBa::Slicer
 {
-    // only one outer polygon and multiple holes supported
+    class ThreadPool;
+
+    // only one outer polygon and multiple holes supported, use MultiIslandFill for whole layers
 
     Polygons OffsetFill(const Polygons& poly, double spacing,
         Clipper2Lib::JoinType join_type = Clipper2Lib::JoinType::Square);
 
 
+    // scan line fills. Their temporaries are taken from scratch when given, typically a
+    // monotonic arena released once per layer; returned paths always use the default allocator
     Polygons LineFill(const Polygons& poly, double spacing, double angle_deg,
-        double lineThickness = 0.5);
+        double lineThickness = 0.5, std::pmr::memory_resource* scratch = nullptr);
 
     Polygons SimpleZigzagFill(const Polygons& poly, double spacing, double angle_deg,
-        double lineThickness = 0.5);
+        double lineThickness = 0.5, std::pmr::memory_resource* scratch = nullptr);
 
     Polygons ZigzagFill(const Polygons& poly, double spacing, double angle_deg,
-        double lineThickness = 0.5);
+        double lineThickness = 0.5, std::pmr::memory_resource* scratch = nullptr);
+
+    // pattern infills, the whole pattern of a layer is built once and clipped in one boolean.
+    // output paths are open polylines, spacing and z use the same units as LineFill
+    Polygons GyroidFill(const Polygons& poly, double spacing, double z, double angle_deg = 0.0);
+
+    Polygons HoneycombFill(const Polygons& poly, double spacing, double angle_deg = 0.0);
+
+    Polygons TriangularFill(const Polygons& poly, double spacing, double angle_deg = 0.0);
+
+    Polygons CubicFill(const Polygons& poly, double spacing, double z, double angle_deg = 0.0);
 
     enum class FillMode { Line, SimpleZigzag, Zigzag };
 
@@ -39,6 +54,18 @@ namespace HsBa::Slicer
         double angle_deg, double lineThickness = 0.5,
         Clipper2Lib::JoinType join_type = Clipper2Lib::JoinType::Square);
 
+    // fill function for a single island (one outer polygon and its holes)
+    using IslandFillFunc = std::function<Polygons(const Polygons&)>;
+
+    // split the layer into islands and fill each of them, islands are filled on the pool
+    // if one is given, otherwise serially; results are concatenated in island order
+    Polygons MultiIslandFill(const Polygons& layer, const IslandFillFunc& fill,
+        ThreadPool* pool = nullptr);
+
+    // temporaries of every island come from ThreadLocalArena of the thread filling it
+    Polygons MultiIslandFill(const Polygons& layer, FillMode mode, double spacing,
+        double angle_deg, double lineThickness = 0.5, ThreadPool* pool = nullptr);
+
     // others defined in lua script
 
     Polygons LuaCustomFill(const Polygons& poly, const std::string& scriptPath, const std::string& functionName = "generate_fill",
@@ -0,0 +1,303 @@
+﻿#include "Simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <queue>
+#include <vector>
+
+#include "base/error.hpp"
+#include "base/thread_pool.hpp"
+
+namespace HsBa::Slicer
+{
+	namespace
+	{
+		// at most this many halvings of the tolerance before a contour is kept unchanged
+		constexpr int MAX_SIMPLIFY_RETRIES = 3;
+
+		template <typename Point>
+		double SegmentDistance(const Point& p, const Point& a, const Point& b)
+		{
+			const double dx = static_cast<double>(b.x) - a.x, dy = static_cast<double>(b.y) - a.y;
+			const double px = static_cast<double>(p.x) - a.x, py = static_cast<double>(p.y) - a.y;
+			const double len2 = dx * dx + dy * dy;
+			if (len2 == 0) return std::hypot(px, py);
+			const double t = std::clamp((px * dx + py * dy) / len2, 0.0, 1.0);
+			return std::hypot(px - t * dx, py - t * dy);
+		}
+
+		template <typename Point>
+		double Cross(const Point& o, const Point& a, const Point& b)
+		{
+			return (static_cast<double>(a.x) - o.x) * (static_cast<double>(b.y) - o.y) -
+				(static_cast<double>(a.y) - o.y) * (static_cast<double>(b.x) - o.x);
+		}
+
+		// closed segments, touching and collinear overlap count as intersecting
+		template <typename Point>
+		bool SegmentsIntersect(const Point& a, const Point& b, const Point& c, const Point& d)
+		{
+			auto sign = [](double v) { return (v > 0) - (v < 0); };
+			const int d1 = sign(Cross(c, d, a)), d2 = sign(Cross(c, d, b));
+			const int d3 = sign(Cross(a, b, c)), d4 = sign(Cross(a, b, d));
+			if (d1 * d2 < 0 && d3 * d4 < 0) return true;
+			auto onSegment = [](const Point& p, const Point& q, const Point& r) {
+				return std::min(p.x, q.x) <= r.x && r.x <= std::max(p.x, q.x) &&
+					std::min(p.y, q.y) <= r.y && r.y <= std::max(p.y, q.y);
+				};
+			return (d1 == 0 && onSegment(c, d, a)) || (d2 == 0 && onSegment(c, d, b)) ||
+				(d3 == 0 && onSegment(a, b, c)) || (d4 == 0 && onSegment(a, b, d));
+		}
+
+		// indices of the kept vertices of the open run path[first..last]
+		template <typename Path>
+		void DouglasPeucker(const Path& path, size_t first, size_t last, double tolerance, std::vector<char>& keep)
+		{
+			const size_t n = path.size();
+			std::vector<std::pair<size_t, size_t>> stack{ { first, last } };
+			while (!stack.empty())
+			{
+				auto [a, b] = stack.back();
+				stack.pop_back();
+				double worst = -1;
+				size_t index = a;
+				for (size_t i = (a + 1) % n; i != b; i = (i + 1) % n)
+				{
+					double d = SegmentDistance(path[i], path[a], path[b]);
+					if (d > worst) { worst = d; index = i; }
+				}
+				if (worst <= tolerance) continue;
+				keep[index] = 1;
+				stack.emplace_back(a, index);
+				stack.emplace_back(index, b);
+			}
+		}
+
+		template <typename Path>
+		Path SimplifyRDP(const Path& path, double tolerance)
+		{
+			const size_t n = path.size();
+			// anchor the ring at its first vertex and the vertex farthest from it
+			size_t far = 0;
+			double farDist = -1;
+			for (size_t i = 1; i < n; ++i)
+			{
+				double d = std::hypot(static_cast<double>(path[i].x) - path[0].x, static_cast<double>(path[i].y) - path[0].y);
+				if (d > farDist) { farDist = d; far = i; }
+			}
+			std::vector<char> keep(n, 0);
+			keep[0] = keep[far] = 1;
+			DouglasPeucker(path, 0, far, tolerance, keep);
+			DouglasPeucker(path, far, 0, tolerance, keep);
+			Path res;
+			for (size_t i = 0; i < n; ++i)
+				if (keep[i]) res.push_back(path[i]);
+			return res;
+		}
+
+		template <typename Path>
+		Path SimplifyVisvalingam(const Path& path, double tolerance)
+		{
+			const size_t n = path.size();
+			std::vector<size_t> prev(n), next(n);
+			std::vector<unsigned> version(n, 0);
+			std::vector<char> removed(n, 0);
+			for (size_t i = 0; i < n; ++i)
+			{
+				prev[i] = (i + n - 1) % n;
+				next[i] = (i + 1) % n;
+			}
+			struct Candidate { double area; size_t index; unsigned version; };
+			auto larger = [](const Candidate& l, const Candidate& r) { return l.area > r.area; };
+			std::priority_queue<Candidate, std::vector<Candidate>, decltype(larger)> heap(larger);
+			auto push = [&](size_t i) {
+				heap.push({ std::abs(Cross(path[prev[i]], path[i], path[next[i]])) * 0.5, i, ++version[i] });
+				};
+			for (size_t i = 0; i < n; ++i) push(i);
+			size_t count = n;
+			while (!heap.empty() && count > 2)
+			{
+				auto top = heap.top();
+				heap.pop();
+				const size_t i = top.index;
+				if (removed[i] || top.version != version[i]) continue;
+				// out of tolerance, it comes back when a neighbour goes
+				if (SegmentDistance(path[i], path[prev[i]], path[next[i]]) > tolerance) continue;
+				removed[i] = 1;
+				--count;
+				next[prev[i]] = next[i];
+				prev[next[i]] = prev[i];
+				push(prev[i]);
+				push(next[i]);
+			}
+			Path res;
+			res.reserve(count);
+			for (size_t i = 0; i < n; ++i)
+				if (!removed[i]) res.push_back(path[i]);
+			return res;
+		}
+
+		template <typename Path>
+		Path SimplifyPath(const Path& path, double tolerance, SimplifyMethod method)
+		{
+			if (path.size() < 4 || tolerance <= 0) return path;
+			return method == SimplifyMethod::Visvalingam ? SimplifyVisvalingam(path, tolerance) : SimplifyRDP(path, tolerance);
+		}
+
+		struct SegmentRef
+		{
+			double minX, maxX;
+			uint32_t path, index;
+		};
+
+		// marks every path that has a pair of non-adjacent edges crossing, among its own edges or
+		// with another path. Sweep over the edges sorted by their left end
+		template <typename Paths>
+		std::vector<char> FindCrossingPaths(const Paths& paths)
+		{
+			std::vector<SegmentRef> segments;
+			for (uint32_t p = 0; p < paths.size(); ++p)
+			{
+				const auto& path = paths[p];
+				for (uint32_t i = 0; i < path.size(); ++i)
+				{
+					const auto& a = path[i];
+					const auto& b = path[(i + 1) % path.size()];
+					segments.push_back({ static_cast<double>(std::min(a.x, b.x)), static_cast<double>(std::max(a.x, b.x)), p, i });
+				}
+			}
+			std::sort(segments.begin(), segments.end(), [](const SegmentRef& l, const SegmentRef& r) { return l.minX < r.minX; });
+			std::vector<char> crossing(paths.size(), 0);
+			std::vector<const SegmentRef*> active;
+			for (const auto& s : segments)
+			{
+				std::erase_if(active, [&](const SegmentRef* a) { return a->maxX < s.minX; });
+				const auto& sp = paths[s.path];
+				const auto& s0 = sp[s.index];
+				const auto& s1 = sp[(s.index + 1) % sp.size()];
+				for (const auto* a : active)
+				{
+					if (a->path == s.path)
+					{
+						const size_t n = sp.size();
+						if (n < 4) continue;
+						// neighbouring edges share a vertex
+						if ((a->index + 1) % n == s.index || (s.index + 1) % n == a->index) continue;
+					}
+					if (crossing[a->path] && crossing[s.path]) continue;
+					const auto& ap = paths[a->path];
+					const auto& a0 = ap[a->index];
+					const auto& a1 = ap[(a->index + 1) % ap.size()];
+					if (std::max(a0.y, a1.y) < std::min(s0.y, s1.y) || std::max(s0.y, s1.y) < std::min(a0.y, a1.y)) continue;
+					if (SegmentsIntersect(s0, s1, a0, a1))
+					{
+						crossing[a->path] = 1;
+						crossing[s.path] = 1;
+					}
+				}
+				active.push_back(&s);
+			}
+			return crossing;
+		}
+
+		template <typename Paths>
+		Paths SimplifyImpl(const Paths& polys, const SimplifyOptions& options, SimplifyStats* stats, ThreadPool* pool)
+		{
+			if (options.tolerance < 0)
+				throw InvalidArgumentError("Simplify tolerance must not be negative");
+			const size_t n = polys.size();
+			Paths simplified(n);
+			auto simplifyRange = [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; ++i)
+				{
+					double tolerance = options.tolerance;
+					for (int attempt = 0; ; ++attempt)
+					{
+						simplified[i] = SimplifyPath(polys[i], tolerance, options.method);
+						// a contour can't cross itself with fewer than 4 vertices
+						if (simplified[i].size() < 4 || simplified[i].size() == polys[i].size() ||
+							!FindCrossingPaths(Paths{ simplified[i] })[0])
+							break;
+						if (attempt == MAX_SIMPLIFY_RETRIES)
+						{
+							simplified[i] = polys[i];
+							break;
+						}
+						tolerance *= 0.5;
+					}
+				}
+				};
+			const size_t chunk = std::max<size_t>(1, options.chunkSize);
+			if (pool == nullptr || n <= chunk)
+			{
+				simplifyRange(0, n);
+			}
+			else
+			{
+				std::vector<std::future<void>> futures;
+				for (size_t from = 0; from < n; from += chunk)
+					futures.emplace_back(pool->submit(simplifyRange, from, std::min(n, from + chunk)));
+				std::exception_ptr error;
+				for (auto& f : futures)
+				{
+					try { f.get(); }
+					catch (...) { if (!error) error = std::current_exception(); }
+				}
+				if (error) std::rethrow_exception(error);
+			}
+
+			// contours narrower than the tolerance collapse to a line and are dropped. A simplified
+			// contour may still cross a neighbour: restore the originals of the offending contours
+			// until only crossings already present in the input are left
+			std::vector<char> restored(n, 0);
+			for (;;)
+			{
+				Paths current;
+				std::vector<size_t> source;
+				for (size_t i = 0; i < n; ++i)
+				{
+					if (!restored[i] && simplified[i].size() < 3) continue;
+					current.push_back(restored[i] ? polys[i] : simplified[i]);
+					source.push_back(i);
+				}
+				auto crossing = FindCrossingPaths(current);
+				bool changed = false;
+				for (size_t k = 0; k < crossing.size(); ++k)
+				{
+					const size_t i = source[k];
+					if (!crossing[k] || restored[i] || simplified[i].size() == polys[i].size()) continue;
+					restored[i] = 1;
+					changed = true;
+				}
+				if (changed) continue;
+
+				if (stats)
+				{
+					SimplifyStats local;
+					local.pathsIn = n;
+					local.pathsOut = current.size();
+					for (size_t i = 0; i < n; ++i)
+					{
+						local.pointsIn += polys[i].size();
+						local.reverted += restored[i];
+					}
+					for (const auto& path : current) local.pointsOut += path.size();
+					*stats += local;
+				}
+				return current;
+			}
+		}
+	} // namespace
+
+	Polygons SimplifyPolygons(const Polygons& polys, const SimplifyOptions& options, SimplifyStats* stats, ThreadPool* pool)
+	{
+		return SimplifyImpl(polys, options, stats, pool);
+	}
+
+	PolygonsD SimplifyPolygons(const PolygonsD& polys, const SimplifyOptions& options, SimplifyStats* stats, ThreadPool* pool)
+	{
+		return SimplifyImpl(polys, options, stats, pool);
+	}
+} // namespace HsBa::Slicer
@@ -0,0 +1,65 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_SIMPLIFY_HPP
+#define HSBA_SLICER_SIMPLIFY_HPP
+
+#include <cstddef>
+
+#include "FloatPolygons.hpp"
+
+namespace HsBa::Slicer
+{
+	class ThreadPool;
+
+	enum class SimplifyMethod
+	{
+		// keeps the vertices farthest from the chord, every removed vertex stays within tolerance
+		RamerDouglasPeucker,
+		// drops the vertex with the smallest triangle first while it lies within tolerance of the new edge
+		Visvalingam
+	};
+
+	struct SimplifyOptions
+	{
+		// maximal deviation, in the units of the polygons (integerized for Polygons)
+		double tolerance = 0.0;
+		SimplifyMethod method = SimplifyMethod::RamerDouglasPeucker;
+		// contours per task when running on a pool
+		size_t chunkSize = 64;
+	};
+
+	struct SimplifyStats
+	{
+		size_t pathsIn = 0;
+		size_t pathsOut = 0;
+		size_t pointsIn = 0;
+		size_t pointsOut = 0;
+		// contours restored to a finer result because the simplified one crossed itself or a neighbour
+		size_t reverted = 0;
+
+		double Reduction() const
+		{
+			return pointsIn == 0 ? 0.0 : 1.0 - static_cast<double>(pointsOut) / static_cast<double>(pointsIn);
+		}
+
+		SimplifyStats& operator+=(const SimplifyStats& other)
+		{
+			pathsIn += other.pathsIn;
+			pathsOut += other.pathsOut;
+			pointsIn += other.pointsIn;
+			pointsOut += other.pointsOut;
+			reverted += other.reverted;
+			return *this;
+		}
+	};
+
+	// Simplifies closed contours. Contours narrower than the tolerance are dropped. A contour whose
+	// simplification would cross itself or another contour is retried with half the tolerance and
+	// finally kept unchanged, so no intersections are introduced. With a pool the contours are
+	// simplified in chunks concurrently; stats, if given, receive the vertex counts
+	Polygons SimplifyPolygons(const Polygons& polys, const SimplifyOptions& options,
+		SimplifyStats* stats = nullptr, ThreadPool* pool = nullptr);
+	PolygonsD SimplifyPolygons(const PolygonsD& polys, const SimplifyOptions& options,
+		SimplifyStats* stats = nullptr, ThreadPool* pool = nullptr);
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_SIMPLIFY_HPP
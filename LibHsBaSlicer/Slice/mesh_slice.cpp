@@ -7,6 +7,11 @@ namespace HsBa::Slicer
 		auto topo_mesh = std::make_unique<FullTopoModel>(FullTopoModel(model));
 		return topo_mesh->Slice(height);
 	}
+	HSBA_SLICER_LIB_API Polygons Slice(const IModel& model, const float height,
+		const SimplifyOptions& simplify, SimplifyStats* stats)
+	{
+		return SimplifyPolygons(Slice(model, height), simplify, stats);
+	}
 	HSBA_SLICER_LIB_API UnSafePolygons UnSafeSlice(const IModel& model, const float height)
 	{
 		auto topo_mesh = std::make_unique<FullTopoModel>(FullTopoModel(model));
@@ -10,6 +10,9 @@ namespace HsBa::Slicer
 
 	//安全切片，忽略不封闭轮廓
 	HSBA_SLICER_LIB_API Polygons Slice(const IModel& model, const float height);
+	//切片后按容差简化轮廓（容差为整数化后的单位），不引入自交，顶点统计累加到stats
+	HSBA_SLICER_LIB_API Polygons Slice(const IModel& model, const float height,
+		const SimplifyOptions& simplify, SimplifyStats* stats = nullptr);
 	//不安全的切片，包含不封闭轮廓。如果需要封闭的轮廓，请使用Slice。
 	//在送丝的工艺下可以考虑使用不安全切片，使用SLA等面成型工艺时不考虑使用
 	HSBA_SLICER_LIB_API UnSafePolygons UnSafeSlice(const IModel& model, const float height);
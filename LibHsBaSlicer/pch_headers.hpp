@@ -37,4 +37,5 @@
 #endif // USE_OCCT
 #include "meshmodel/FullTopoModel.hpp"
 
-#include "2D/IntPolygon.hpp"
\ No newline at end of file
+#include "2D/IntPolygon.hpp"
+#include "2D/Simplify.hpp"
\ No newline at end of file
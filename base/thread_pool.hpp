@@ -5,6 +5,8 @@
 #include <thread>
 #include <vector>
 #include <queue>
+#include <deque>
+#include <algorithm>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
@@ -84,6 +86,11 @@ namespace HsBa::Slicer
             return active_tasks_.load();
         }
 
+        size_t ThreadCount() const noexcept
+        {
+            return workers_.size();
+        }
+
         void WaitAll() 
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
@@ -146,6 +153,36 @@ namespace HsBa::Slicer
         std::atomic<size_t> active_tasks_{0};
     };
 
+    // runs produce(0) ... produce(count - 1) on pool, at most window of them ahead of the oldest
+    // unfinished one, and hands every result to consume(index, result) in index order on the
+    // calling thread. If a task or consume throws, the submitted tasks are waited for before
+    // the error is rethrown, so they may reference the caller's locals
+    template<typename Produce, typename Consume>
+    void RunOrdered(ThreadPool& pool, size_t count, size_t window, Produce&& produce, Consume&& consume)
+    {
+        using Result = std::invoke_result_t<Produce&, size_t>;
+        window = std::max<size_t>(window, 1);
+        std::deque<std::future<Result>> inFlight;
+        size_t next = 0;
+        try
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                while (next < count && inFlight.size() < window)
+                    inFlight.emplace_back(pool.submit(std::ref(produce), next++));
+                // popped before get(), which leaves the future invalid even when it throws
+                auto oldest = std::move(inFlight.front());
+                inFlight.pop_front();
+                consume(i, oldest.get());
+            }
+        }
+        catch (...)
+        {
+            for (auto& f : inFlight) f.wait();
+            throw;
+        }
+    }
+
 #if __cpp_lib_coroutine && __cpp_impl_coroutine
 #ifdef HSBA_ENABLE_THREAD_POOL_COROUTINE
 namespace Utils
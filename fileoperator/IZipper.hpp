@@ -12,6 +12,11 @@ namespace HsBa::Slicer
 	public:
 		virtual ~IZipper() {}
 		virtual void AddByteFile(std::string_view name, const std::string& data) = 0;
+		// takes over the buffer, archivers that can't keep it fall back to copying
+		virtual void AddByteFile(std::string_view name, std::string&& data)
+		{
+			AddByteFile(name, static_cast<const std::string&>(data));
+		}
 		virtual void AddFile(std::string_view name, std::string_view path) = 0;
 		virtual void AddByteFileIgnoreDuplicate(std::string_view name, const std::string& data) = 0;
 		virtual void AddFileIgnoreDuplicate(std::string_view name, std::string_view path) = 0;
@@ -566,6 +566,144 @@ namespace HsBa::Slicer::SQL
 		RaiseEvent("Table removed", sql);
 	}
 
+	SQLiteStatement SQLiteAdapter::Prepare(const std::string& query)
+	{
+		if (!impl_->db) throw SQLAdapterNotConnectedError("SQLite db is null");
+		sqlite3_stmt* stmt = nullptr;
+		if (sqlite3_prepare_v2(impl_->db, query.c_str(), static_cast<int>(query.size()), &stmt, nullptr) != SQLITE_OK) {
+			impl_->lastError = sqlite3_errmsg(impl_->db);
+			throw SQLAdapterQueryError("prepare failed: " + impl_->lastError);
+		}
+		RaiseEvent("Statement prepared", query);
+		return SQLiteStatement(impl_->db, stmt);
+	}
+
+	SQLiteStatement::SQLiteStatement(SQLiteStatement&& other) noexcept
+		: db_{ std::exchange(other.db_, nullptr) }, stmt_{ std::exchange(other.stmt_, nullptr) }
+	{
+	}
+
+	SQLiteStatement& SQLiteStatement::operator=(SQLiteStatement&& other) noexcept
+	{
+		if (this != &other)
+		{
+			sqlite3_finalize(stmt_);
+			db_ = std::exchange(other.db_, nullptr);
+			stmt_ = std::exchange(other.stmt_, nullptr);
+		}
+		return *this;
+	}
+
+	SQLiteStatement::~SQLiteStatement()
+	{
+		sqlite3_finalize(stmt_);
+	}
+
+	void SQLiteStatement::Check(int result, const char* what) const
+	{
+		if (!stmt_) throw SQLAdapterNotConnectedError("SQLite statement is empty");
+		if (result != SQLITE_OK) {
+			throw SQLAdapterQueryError(std::string(what) + " failed: " + sqlite3_errmsg(db_));
+		}
+	}
+
+	void SQLiteStatement::BindInt64(int index, int64_t value)
+	{
+		Check(sqlite3_bind_int64(stmt_, index, value), "bind");
+	}
+
+	void SQLiteStatement::BindDouble(int index, double value)
+	{
+		Check(sqlite3_bind_double(stmt_, index, value), "bind");
+	}
+
+	void SQLiteStatement::BindText(int index, std::string_view text)
+	{
+		Check(sqlite3_bind_text(stmt_, index, text.data(), static_cast<int>(text.size()), SQLITE_STATIC), "bind");
+	}
+
+	void SQLiteStatement::BindBlob(int index, std::span<const unsigned char> blob)
+	{
+		// an empty span may have no data pointer, which sqlite would store as NULL
+		static constexpr unsigned char empty = 0;
+		Check(sqlite3_bind_blob(stmt_, index, blob.empty() ? &empty : blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC), "bind");
+	}
+
+	void SQLiteStatement::BindNull(int index)
+	{
+		Check(sqlite3_bind_null(stmt_, index), "bind");
+	}
+
+	bool SQLiteStatement::Step()
+	{
+		if (!stmt_) throw SQLAdapterNotConnectedError("SQLite statement is empty");
+		switch (sqlite3_step(stmt_))
+		{
+		case SQLITE_ROW:
+			return true;
+		case SQLITE_DONE:
+			return false;
+		default:
+			throw SQLAdapterQueryError("execute failed: " + std::string(sqlite3_errmsg(db_)));
+		}
+	}
+
+	void SQLiteStatement::Reset()
+	{
+		// the error of a failed step is reported again by reset, Step has thrown for it already
+		if (!stmt_) throw SQLAdapterNotConnectedError("SQLite statement is empty");
+		sqlite3_reset(stmt_);
+	}
+
+	int64_t SQLiteStatement::ColumnInt64(int column) const
+	{
+		return sqlite3_column_int64(stmt_, column);
+	}
+
+	double SQLiteStatement::ColumnDouble(int column) const
+	{
+		return sqlite3_column_double(stmt_, column);
+	}
+
+	std::string_view SQLiteStatement::ColumnText(int column) const
+	{
+		const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, column));
+		if (!text) return {};
+		return { text, static_cast<size_t>(sqlite3_column_bytes(stmt_, column)) };
+	}
+
+	std::span<const unsigned char> SQLiteStatement::ColumnBlob(int column) const
+	{
+		const auto* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt_, column));
+		if (!blob) return {};
+		return { blob, static_cast<size_t>(sqlite3_column_bytes(stmt_, column)) };
+	}
+
+	SQLiteTransaction::SQLiteTransaction(SQLiteAdapter& db) : db_{ db }
+	{
+		db_.Execute("BEGIN");
+	}
+
+	SQLiteTransaction::~SQLiteTransaction()
+	{
+		if (!active_) return;
+		try
+		{
+			db_.Execute("ROLLBACK");
+		}
+		catch (...)
+		{
+			// nothing to do about a failed rollback while unwinding, sqlite drops the transaction with the connection
+		}
+	}
+
+	void SQLiteTransaction::Commit()
+	{
+		if (!active_) throw SQLAdapterQueryError("Transaction already finished");
+		db_.Execute("COMMIT");
+		active_ = false;
+	}
+
 #ifdef HSBA_USE_MYSQL
 	class MySQLAdapter::Impl
 	{
@@ -11,10 +11,14 @@
 #include <optional>
 #include <vector>
 #include <memory>
+#include <span>
 
 #include "base/delegate.hpp"
 #include "base/error.hpp"
 
+struct sqlite3;
+struct sqlite3_stmt;
+
 namespace HsBa::Slicer::SQL
 {
     // Database port constants
@@ -107,6 +111,42 @@ namespace HsBa::Slicer::SQL
 		~SQLAdapterInvalidArgumentError() override = default;
 	};
 
+	// A statement compiled once by SQLiteAdapter::Prepare and run many times with new bindings.
+	// Text and blobs are bound without copying and must stay alive until the next Step.
+	// Values read from a row are valid until the next Step or Reset
+	class SQLiteStatement
+	{
+	public:
+		SQLiteStatement() = default;
+		SQLiteStatement(const SQLiteStatement&) = delete;
+		SQLiteStatement& operator=(const SQLiteStatement&) = delete;
+		SQLiteStatement(SQLiteStatement&& other) noexcept;
+		SQLiteStatement& operator=(SQLiteStatement&& other) noexcept;
+		~SQLiteStatement();
+		// parameter indices start at 1
+		void BindInt64(int index, int64_t value);
+		void BindDouble(int index, double value);
+		void BindText(int index, std::string_view text);
+		void BindBlob(int index, std::span<const unsigned char> blob);
+		void BindNull(int index);
+		// true while there is a row to read, false once the statement is done
+		bool Step();
+		// makes the statement ready to run again, bindings are kept
+		void Reset();
+		// column indices start at 0
+		int64_t ColumnInt64(int column) const;
+		double ColumnDouble(int column) const;
+		std::string_view ColumnText(int column) const;
+		std::span<const unsigned char> ColumnBlob(int column) const;
+	private:
+		friend class SQLiteAdapter;
+		SQLiteStatement(sqlite3* db, sqlite3_stmt* stmt) noexcept : db_{ db }, stmt_{ stmt } {}
+		void Check(int result, const char* what) const;
+
+		sqlite3* db_ = nullptr;
+		sqlite3_stmt* stmt_ = nullptr;
+	};
+
 	class SQLiteAdapter : public ISQLAdapter, public Utils::EventSource<SQLiteAdapter, void, std::string_view, std::string_view>
 	{
 	public:
@@ -131,6 +171,8 @@ namespace HsBa::Slicer::SQL
 			const std::string& table,
 			const std::unordered_map<std::string, std::string>& columns) override;
 		void RemoveTable(const std::string& table) override;
+		// the statement must not outlive the adapter
+		SQLiteStatement Prepare(const std::string& query);
 		~SQLiteAdapter() override;
 	private:
 		std::shared_mutex mutex_;
@@ -202,6 +244,21 @@ namespace HsBa::Slicer::SQL
 	};
 #endif // HSBA_USE_PGSQL
 
+	// BEGIN on construction, ROLLBACK on destruction unless Commit was called. Without one
+	// every statement is its own transaction and waits for the journal to be synced
+	class SQLiteTransaction
+	{
+	public:
+		explicit SQLiteTransaction(SQLiteAdapter& db);
+		SQLiteTransaction(const SQLiteTransaction&) = delete;
+		SQLiteTransaction& operator=(const SQLiteTransaction&) = delete;
+		~SQLiteTransaction();
+		void Commit();
+	private:
+		SQLiteAdapter& db_;
+		bool active_ = true;
+	};
+
 	inline ISQLAdapter::Rows operator|(ISQLAdapter& db, const std::string& sql)
 	{
 		return db.Query(sql);
@@ -2,13 +2,25 @@
 
 #include <type_traits>
 #include <filesystem>
+#include <algorithm>
+#include <deque>
+#include <future>
 
 #include "base/error.hpp"
 #include "base/encoding_convert.hpp"
 #include "base/template_helper.hpp"
+#include "base/thread_pool.hpp"
 
 namespace HsBa::Slicer
 {
+	namespace
+	{
+		//deflated blocks kept per thread before the oldest must be written
+		constexpr size_t ZIP_BLOCKS_PER_THREAD = 2;
+		//miniz stores smaller files as they are
+		constexpr size_t MIN_DEFLATE_BYTES = 4;
+	}
+
 	Zipper::Zipper(MinizCompression compression)
 	{
 		if (compression == MinizCompression::Undefine || compression == MinizCompression::Unknown)
@@ -31,15 +43,35 @@ namespace HsBa::Slicer
 		}
 	}
 
-	void Zipper::AddByteFile(std::string_view name, const std::string& data)
+	void Zipper::EmplaceUnique(std::string&& ansi_name, BytesFileName&& file)
 	{
-		std::string ansi_name = utf8_to_local(std::string{ name });
-		auto [add, add_res] = byteFilesWaitCompress_.emplace(ansi_name, Bytes{ data });
+		auto [add, add_res] = byteFilesWaitCompress_.emplace(std::move(ansi_name), std::move(file));
 		if (!add_res)
 		{
 			throw InvalidArgumentError("Duplicate name files");
 		}
 	}
+
+	void Zipper::AddByteFile(std::string_view name, const std::string& data)
+	{
+		EmplaceUnique(utf8_to_local(std::string{ name }), Bytes{ data });
+	}
+	void Zipper::AddByteFile(std::string_view name, std::string&& data)
+	{
+		EmplaceUnique(utf8_to_local(std::string{ name }), Bytes{ std::move(data) });
+	}
+	void Zipper::AddByteFileView(std::string_view name, std::string_view data)
+	{
+		EmplaceUnique(utf8_to_local(std::string{ name }), BytesView{ data });
+	}
+	void Zipper::AddByteFile(std::string_view name, std::shared_ptr<const std::string> data)
+	{
+		if (!data)
+		{
+			throw InvalidArgumentError("Null byte file buffer");
+		}
+		EmplaceUnique(utf8_to_local(std::string{ name }), SharedBytes{ std::move(data) });
+	}
 	void Zipper::AddFile(std::string_view name, std::string_view path)
 	{
 		std::string ansi_name = utf8_to_local(std::string{ name });
@@ -91,6 +123,122 @@ namespace HsBa::Slicer
 		mz_zip_writer_end(&archiver);
 	}
 
+	void Zipper::Save(std::string_view filePath, ThreadPool& pool)
+	{
+		std::string path = std::filesystem::path(filePath).make_preferred().string();
+		path = utf8_to_local(path);
+		mz_zip_archive archiver{};
+		mz_zip_zero_struct(&archiver);
+		if (!mz_zip_writer_init_file(&archiver, path.c_str(), 0))
+		{
+			throw IOError("Failed to save zip file");
+		}
+		//ends the writer and closes the file on every way out, a throwing task included
+		struct WriterEnd
+		{
+			mz_zip_archive& archiver;
+			~WriterEnd() { mz_zip_writer_end(&archiver); }
+		} writerEnd{ archiver };
+
+		std::vector<const ByteFiles::value_type*> entries;
+		entries.reserve(byteFilesWaitCompress_.size());
+		for (const auto& entry : byteFilesWaitCompress_)
+		{
+			entries.push_back(&entry);
+		}
+		const mz_uint level = Level();
+		auto deflateAhead = [level](const BytesFileName& file) {
+			return level != MZ_NO_COMPRESSION && !std::holds_alternative<std::string>(file) &&
+				BytesOf(file).size() >= MIN_DEFLATE_BYTES;
+			};
+
+		const size_t window = std::max<size_t>(2, ZIP_BLOCKS_PER_THREAD * pool.ThreadCount());
+		std::deque<std::future<Deflated>> inFlight;
+		size_t next = 0;
+		mz_bool status = MZ_TRUE;
+		try
+		{
+			for (size_t i = 0; i < entries.size() && status; ++i)
+			{
+				for (; next < entries.size() && inFlight.size() < window; ++next)
+				{
+					if (deflateAhead(entries[next]->second))
+					{
+						inFlight.emplace_back(pool.submit(&Zipper::Deflate, BytesOf(entries[next]->second), level));
+					}
+				}
+				const auto& [name, file] = *entries[i];
+				if (deflateAhead(file))
+				{
+					//popped before get(), which leaves the future invalid even when it throws
+					auto oldest = std::move(inFlight.front());
+					inFlight.pop_front();
+					status = ZipAddDeflated(archiver, name, oldest.get());
+				}
+				else if (const auto* filePathArg = std::get_if<std::string>(&file))
+				{
+					status = ZipAddFile(archiver, name, *filePathArg);
+				}
+				else
+				{
+					status = ZipAddMember(archiver, name, BytesOf(file));
+				}
+				if (status)
+				{
+					RaiseEvent(static_cast<double>(i + 1) / entries.size(), name);
+				}
+			}
+		}
+		catch (...)
+		{
+			//the tasks read the entries, let them finish first
+			for (auto& f : inFlight) f.wait();
+			throw;
+		}
+		for (auto& f : inFlight) f.wait();
+		if (!status || !mz_zip_writer_finalize_archive(&archiver))
+		{
+			throw IOError("Failed to save zip file");
+		}
+	}
+
+	mz_uint Zipper::Level() const
+	{
+		return static_cast<int>(compression_) < 0 ? static_cast<mz_uint>(MZ_DEFAULT_LEVEL) : compression_;
+	}
+
+	Zipper::Deflated Zipper::Deflate(std::string_view bytes, mz_uint level)
+	{
+		Deflated deflated;
+		deflated.rawSize = bytes.size();
+		deflated.crc32 = static_cast<mz_uint32>(mz_crc32(MZ_CRC32_INIT,
+			reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size()));
+		const int flags = static_cast<int>(tdefl_create_comp_flags_from_zip_params(static_cast<int>(level),
+			-MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+		void* out = tdefl_compress_mem_to_heap(bytes.data(), bytes.size(), &deflated.size, flags);
+		//already compressed data such as PNG grows a little, stored blocks keep it at its size
+		if (out != nullptr && deflated.size >= bytes.size())
+		{
+			mz_free(out);
+			out = tdefl_compress_mem_to_heap(bytes.data(), bytes.size(), &deflated.size, flags | TDEFL_FORCE_ALL_RAW_BLOCKS);
+		}
+		if (out == nullptr)
+		{
+			throw RuntimeError("Failed to compress zip entry");
+		}
+		deflated.data = { out, mz_free };
+		return deflated;
+	}
+
+	std::string_view Zipper::BytesOf(const BytesFileName& file)
+	{
+		return std::visit(Utils::Overloaded{
+			[](const std::string&) -> std::string_view { return {}; },
+			[](const Bytes& arg) -> std::string_view { return arg.data; },
+			[](const BytesView& arg) -> std::string_view { return arg.data; },
+			[](const SharedBytes& arg) -> std::string_view { return *arg.data; }
+		}, file);
+	}
 
 	mz_bool Zipper::AddAllToZip(mz_zip_archive& archiver)
 	{
@@ -104,7 +252,13 @@ namespace HsBa::Slicer
 					return ZipAddFile(archiver, name, arg);
 				},
 				[&archiver, &name, this](const Bytes& arg) -> mz_bool {
-					return ZipAddMember(archiver, name, arg);
+					return ZipAddMember(archiver, name, arg.data);
+				},
+				[&archiver, &name, this](const BytesView& arg) -> mz_bool {
+					return ZipAddMember(archiver, name, arg.data);
+				},
+				[&archiver, &name, this](const SharedBytes& arg) -> mz_bool {
+					return ZipAddMember(archiver, name, *arg.data);
 				}
 			}, bytes);
 			if (status <= MZ_OK)
@@ -123,9 +277,15 @@ namespace HsBa::Slicer
 		return mz_zip_writer_add_file(&archiver, name.c_str(), path.c_str(), NULL, 0, compression_);
 	}
 
-	mz_bool Zipper::ZipAddMember(mz_zip_archive& archiver, const std::string& name, const Bytes& bytes) const
+	mz_bool Zipper::ZipAddMember(mz_zip_archive& archiver, const std::string& name, std::string_view bytes) const
+	{
+		return mz_zip_writer_add_mem(&archiver, name.c_str(), bytes.data(), bytes.size(), compression_);
+	}
+
+	mz_bool Zipper::ZipAddDeflated(mz_zip_archive& archiver, const std::string& name, const Deflated& deflated) const
 	{
-		return mz_zip_writer_add_mem(&archiver, name.c_str(), bytes.data.data(), bytes.data.size(), compression_);
+		return mz_zip_writer_add_mem_ex(&archiver, name.c_str(), deflated.data.get(), deflated.size, NULL, 0,
+			Level() | MZ_ZIP_FLAG_COMPRESSED_DATA, deflated.rawSize, deflated.crc32);
 	}
 
 	void MiniZExtractFile(std::string_view archive_path, std::string_view output_path)
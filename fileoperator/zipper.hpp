@@ -2,6 +2,7 @@
 #ifndef HSBA_SLICER_ZIPPER_HPP
 #define HSBA_SLICER_ZIPPER_HPP
 
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -15,6 +16,8 @@
 
 namespace HsBa::Slicer
 {
+	class ThreadPool;
+
 	enum class MinizCompression
 	{
 		Undefine,
@@ -36,24 +39,54 @@ namespace HsBa::Slicer
 		Zipper(Zipper&&) noexcept = delete;
 		Zipper& operator=(Zipper&&) noexcept = delete;
 		void AddByteFile(std::string_view name, const std::string& data) override;
+		void AddByteFile(std::string_view name, std::string&& data) override;
+		//data is not copied, it must stay alive and unchanged until Save returns
+		void AddByteFileView(std::string_view name, std::string_view data);
+		//shares the buffer with the caller, it must not change until Save returns
+		void AddByteFile(std::string_view name, std::shared_ptr<const std::string> data);
 		void AddFile(std::string_view name, std::string_view path) override;
 		//To add duplicate file, filename add "_duplicate"
 		void AddByteFileIgnoreDuplicate(std::string_view name, const std::string& data) override;
 		void AddFileIgnoreDuplicate(std::string_view name, std::string_view path) override;
 		void Save(std::string_view filePath) override;
+		//byte files are deflated concurrently into memory blocks and written in order, miniz
+		//still lays out the headers and the central directory. A few blocks per thread are held
+		//at a time. Files added by path are compressed by miniz when their turn comes
+		void Save(std::string_view filePath, ThreadPool& pool);
 	private:
 		struct Bytes
 		{
 			std::string data;
 		};
-		using BytesFileName = std::variant<Bytes, std::string>;
+		struct BytesView
+		{
+			std::string_view data;
+		};
+		struct SharedBytes
+		{
+			std::shared_ptr<const std::string> data;
+		};
+		//raw deflate stream of a byte file, made off the writing thread
+		struct Deflated
+		{
+			std::unique_ptr<void, void (*)(void*)> data{ nullptr, nullptr };
+			size_t size = 0;
+			size_t rawSize = 0;
+			mz_uint32 crc32 = 0;
+		};
+		using BytesFileName = std::variant<Bytes, std::string, BytesView, SharedBytes>;
 		using ByteFiles = std::unordered_map<std::string, BytesFileName>;
 		ByteFiles byteFilesWaitCompress_;
 		mz_uint compression_ = MZ_DEFAULT_COMPRESSION;
 		const std::string duplicate_addition = "_duplicate";
 		mz_bool AddAllToZip(/*in*/mz_zip_archive& archiver);
 		mz_bool ZipAddFile(/*ref*/mz_zip_archive& archiver, const std::string& name, const std::string& path) const;
-		mz_bool ZipAddMember(/*ref*/mz_zip_archive& archiver, const std::string& name, const Bytes& bytes) const;
+		mz_bool ZipAddMember(/*ref*/mz_zip_archive& archiver, const std::string& name, std::string_view bytes) const;
+		mz_bool ZipAddDeflated(/*ref*/mz_zip_archive& archiver, const std::string& name, const Deflated& deflated) const;
+		mz_uint Level() const;
+		static Deflated Deflate(std::string_view bytes, mz_uint level);
+		static std::string_view BytesOf(const BytesFileName& file);
+		void EmplaceUnique(std::string&& ansi_name, BytesFileName&& file);
 	};
 
 	void MiniZExtractFile(std::string_view archive_path, std::string_view output_path);
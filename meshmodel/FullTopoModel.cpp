@@ -1,6 +1,8 @@
 ﻿#include "FullTopoModel.hpp"
 
+#include <array>
 #include <set>
+#include <memory_resource>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -301,6 +303,12 @@ void PushFullTopoModelToLua(lua_State* L, const FullTopoModel& model, float heig
 
 	Polygons FullTopoModel::Slice(const float height) const
 	{
+		return Slice(height, nullptr);
+	}
+
+	Polygons FullTopoModel::Slice(const float height, std::pmr::memory_resource* scratch) const
+	{
+		if (scratch == nullptr) scratch = std::pmr::get_default_resource();
 		// Collect intersection segments (as integerized 2D points)
 		using Key = std::pair<long long, long long>;
 		auto make_key = [&](const Eigen::Vector3f& p) -> Key {
@@ -309,7 +317,7 @@ void PushFullTopoModelToLua(lua_State* L, const FullTopoModel& model, float heig
 			return { xi, yi };
 			};
 
-		std::unordered_map<Key, std::vector<Key>, boost::hash<Key>> adj;
+		std::pmr::unordered_map<Key, std::pmr::vector<Key>, boost::hash<Key>> adj{ scratch };
 		adj.reserve(faces_.size() * 2);
 
 		for (const auto& f : faces_)
@@ -318,23 +326,26 @@ void PushFullTopoModelToLua(lua_State* L, const FullTopoModel& model, float heig
 			const Eigen::Vector3f& v1 = vertices_[f.triangle[1]].vertex;
 			const Eigen::Vector3f& v2 = vertices_[f.triangle[2]].vertex;
 
-			std::vector<Eigen::Vector3f> inters;
+			// a triangle cuts the plane in at most three points, no heap needed per face
+			std::array<Eigen::Vector3f, 3> inters;
+			size_t interCount = 0;
 			Eigen::Vector3f p;
-			if (Intersetion(v0, v1, height, p)) inters.push_back(p);
-			if (Intersetion(v1, v2, height, p)) inters.push_back(p);
-			if (Intersetion(v2, v0, height, p)) inters.push_back(p);
+			if (Intersetion(v0, v1, height, p)) inters[interCount++] = p;
+			if (Intersetion(v1, v2, height, p)) inters[interCount++] = p;
+			if (Intersetion(v2, v0, height, p)) inters[interCount++] = p;
 
 			// keep unique points (by integerized key)
-			std::vector<Key> keys;
-			for (const auto& ip : inters)
+			std::array<Key, 3> keys;
+			size_t keyCount = 0;
+			for (size_t i = 0; i != interCount; ++i)
 			{
-				Key k = make_key(ip);
-				if (keys.end() == std::find(keys.begin(), keys.end(), k))
+				Key k = make_key(inters[i]);
+				if (keys.begin() + keyCount == std::find(keys.begin(), keys.begin() + keyCount, k))
 				{
-					keys.push_back(k);
+					keys[keyCount++] = k;
 				}
 			}
-			if (keys.size() == 2)
+			if (keyCount == 2)
 			{
 				adj[keys[0]].push_back(keys[1]);
 				adj[keys[1]].push_back(keys[0]);
@@ -343,7 +354,7 @@ void PushFullTopoModelToLua(lua_State* L, const FullTopoModel& model, float heig
 
 		// traverse adjacency to build closed loops only
 		Polygons result;
-		std::unordered_set<Key, boost::hash<Key>> visited;
+		std::pmr::unordered_set<Key, boost::hash<Key>> visited{ scratch };
 
 		for (const auto& kv : adj)
 		{
@@ -351,7 +362,7 @@ void PushFullTopoModelToLua(lua_State* L, const FullTopoModel& model, float heig
 			if (visited.find(start) != visited.end()) continue;
 
 			// follow path
-			std::vector<Key> path;
+			std::pmr::vector<Key> path{ scratch };
 			Key cur = start;
 			Key prev = { LLONG_MIN, LLONG_MIN };
 			while (true)
@@ -6,6 +6,7 @@
 #include <array>
 #include <algorithm>
 #include <filesystem>
+#include <memory_resource>
 
 #include <Eigen/Core>
 
@@ -92,6 +93,8 @@ namespace HsBa::Slicer
 		
 		//安全切片，只包含封闭轮廓，不封闭轮廓会被丢弃
 		Polygons Slice(const float height) const;
+		//临时数据（邻接表等）从scratch分配，可传入每层重置的单调内存池；返回值使用默认分配器
+		Polygons Slice(const float height, std::pmr::memory_resource* scratch) const;
 		//不安全切片，包含不封闭轮廓
 		UnSafePolygons UnSafeSlice(const float height) const;
 
@@ -13,10 +13,15 @@ struct lua_State;
 
 namespace HsBa::Slicer 
 {
+	class IOutputSink;
+
 	class IPath
 	{
 	public:
 		virtual ~IPath() = default;
+		// writes the default output into sink piece by piece, so the whole program never has to
+		// be held in memory. ToString and the plain text Save are built on it
+		virtual void Stream(IOutputSink& sink) const = 0;
 		virtual void Save(const std::filesystem::path&) const = 0;
 		virtual void Save(const std::filesystem::path&, std::string_view script,
 			const std::function<void(lua_State*)>& lua_reg = {}) const = 0;
@@ -0,0 +1,504 @@
+﻿#include "binarygcode.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include <miniz.h>
+
+#include "gcodewriter.hpp"
+#include "outputsink.hpp"
+#include "base/error.hpp"
+
+namespace HsBa::Slicer
+{
+	namespace
+	{
+		constexpr char BINARY_GCODE_MAGIC[4] = { 'H', 'B', 'G', 'C' };
+		constexpr uint16_t BINARY_GCODE_VERSION = 1;
+		constexpr size_t HEADER_BYTES = 20;
+		constexpr size_t BLOCK_ENTRY_BYTES = 24;
+		constexpr size_t LAYER_ENTRY_BYTES = 60;
+		constexpr size_t TRAILER_BYTES = 32;
+		// a layer without any height change is cut into blocks of this many times blockMoves
+		constexpr size_t MAX_BLOCK_FACTOR = 4;
+
+		// move tag: bits 0-1 are the G code, the rest tell which optional fields follow
+		constexpr uint8_t TAG_TYPE_MASK = 0x03;
+		constexpr uint8_t TAG_HAS_FEED = 0x04;
+		constexpr uint8_t TAG_FEED_CHANGED = 0x08;
+		constexpr uint8_t TAG_Z_CHANGED = 0x10;
+		constexpr uint8_t TAG_NEGATIVE_ZERO = 0x20;
+
+		constexpr double COORD_UNIT = 1e4;
+		constexpr double EXTRUSION_UNIT = 1e6;
+
+		[[noreturn]] void Corrupt(const char* what)
+		{
+			throw RuntimeError(std::string("Corrupt binary G-code: ") + what);
+		}
+
+		template <typename T>
+		void PutLE(std::string& out, T value)
+		{
+			using U = std::make_unsigned_t<T>;
+			auto bits = static_cast<U>(value);
+			for (size_t i = 0; i < sizeof(T); ++i)
+			{
+				out.push_back(static_cast<char>(bits & 0xFF));
+				bits = static_cast<U>(bits >> 8);
+			}
+		}
+
+		void PutFloat(std::string& out, float value)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			PutLE(out, bits);
+		}
+
+		template <typename T>
+		T GetLE(const char* data)
+		{
+			using U = std::make_unsigned_t<T>;
+			U bits = 0;
+			for (size_t i = sizeof(T); i-- > 0;)
+				bits = static_cast<U>((bits << 8) | static_cast<unsigned char>(data[i]));
+			return static_cast<T>(bits);
+		}
+
+		float GetFloat(const char* data)
+		{
+			const auto bits = GetLE<uint32_t>(data);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		void PutVarint(std::string& out, uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+
+		void PutSigned(std::string& out, int64_t value)
+		{
+			PutVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+		}
+
+		// decoder state shared by the encoder, reset at the start of every block
+		struct MoveState
+		{
+			int64_t x = 0, y = 0, z = 0, feed = 0, extrusion = 0;
+		};
+
+		class MoveDecoder
+		{
+		public:
+			MoveDecoder(const std::string& block, size_t offset) : data_{ block.data() }, pos_{ offset }, size_{ block.size() }
+			{
+				if (offset > size_) Corrupt("layer offset outside its block");
+			}
+			bool AtEnd() const noexcept
+			{
+				return pos_ == size_;
+			}
+			FixedMove Next(MoveState& state)
+			{
+				FixedMove move;
+				const uint8_t tag = Byte();
+				move.type = static_cast<GcodeType>(tag & TAG_TYPE_MASK);
+				state.x += Signed();
+				state.y += Signed();
+				if (tag & TAG_Z_CHANGED) state.z += Signed();
+				move.x = state.x;
+				move.y = state.y;
+				move.z = state.z;
+				if (move.type == GcodeType::G2 || move.type == GcodeType::G3)
+				{
+					move.i = Signed();
+					move.j = Signed();
+					move.k = Signed();
+				}
+				move.hasFeed = (tag & TAG_HAS_FEED) != 0;
+				if (tag & TAG_FEED_CHANGED) state.feed += Signed();
+				move.feed = state.feed;
+				state.extrusion += Signed();
+				move.extrusion = state.extrusion;
+				if (tag & TAG_NEGATIVE_ZERO) move.negativeZero = Byte();
+				return move;
+			}
+		private:
+			uint8_t Byte()
+			{
+				if (pos_ >= size_) Corrupt("truncated move");
+				return static_cast<uint8_t>(data_[pos_++]);
+			}
+			int64_t Signed()
+			{
+				uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7)
+				{
+					const uint8_t byte = Byte();
+					value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+					if ((byte & 0x80) == 0)
+						return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+				}
+				Corrupt("varint too long");
+			}
+
+			const char* data_;
+			size_t pos_;
+			size_t size_;
+		};
+
+		GPoint ToPoint(const FixedMove& move)
+		{
+			auto coord = [&](int64_t value, uint8_t field) {
+				if (value == 0 && (move.negativeZero & field)) return -0.0f;
+				return static_cast<float>(value / COORD_UNIT);
+				};
+			GPoint point;
+			point.type = move.type;
+			point.p1 = { coord(move.x, FixedMove::X), coord(move.y, FixedMove::Y), coord(move.z, FixedMove::Z) };
+			point.center = { coord(move.i, FixedMove::I), coord(move.j, FixedMove::J), coord(move.k, FixedMove::K) };
+			point.velocity = move.hasFeed ? coord(move.feed, FixedMove::F) : 0.0f;
+			point.extrusion = move.extrusion == 0 && (move.negativeZero & FixedMove::E) ? -0.0 : move.extrusion / EXTRUSION_UNIT;
+			return point;
+		}
+
+		// not part of the text output either
+		bool IsMotion(GcodeType type)
+		{
+			return type == GcodeType::G0 || type == GcodeType::G1 || type == GcodeType::G2 || type == GcodeType::G3;
+		}
+
+		// forEachMove(visit) calls visit(move, height) for every G0-G3 move in order
+		template <typename ForEachMove>
+		void WriteMoves(IOutputSink& sink, GCodeUnits units, const OutPoints3& start,
+			ForEachMove&& forEachMove, const BinaryGCodeOptions& options)
+		{
+			struct LayerRecord
+			{
+				uint64_t moveCount;
+				uint32_t block;
+				uint32_t rawOffset;
+				float height;
+				MoveState state;
+			};
+			struct BlockRecord
+			{
+				uint64_t offset;
+				uint32_t storedSize;
+				uint32_t rawSize;
+				uint64_t moveCount;
+			};
+
+			std::string header(BINARY_GCODE_MAGIC, sizeof(BINARY_GCODE_MAGIC));
+			PutLE(header, BINARY_GCODE_VERSION);
+			header.push_back(static_cast<char>(units));
+			header.push_back(0);
+			PutFloat(header, start.x);
+			PutFloat(header, start.y);
+			PutFloat(header, start.z);
+			sink.Write(header);
+
+			const size_t blockMoves = std::max<size_t>(options.blockMoves, 1);
+			uint64_t fileOffset = header.size();
+			std::vector<BlockRecord> blocks;
+			std::vector<LayerRecord> layers;
+			std::string raw, stored;
+			uint64_t blockMoveCount = 0, moveCount = 0;
+			MoveState state;
+
+			auto flushBlock = [&]() {
+				if (blockMoveCount == 0) return;
+				if (raw.size() > UINT32_MAX) throw InvalidArgumentError("Binary G-code block too large, reduce blockMoves");
+				mz_ulong storedSize = mz_compressBound(static_cast<mz_ulong>(raw.size()));
+				stored.resize(storedSize);
+				if (mz_compress2(reinterpret_cast<unsigned char*>(stored.data()), &storedSize,
+					reinterpret_cast<const unsigned char*>(raw.data()), static_cast<mz_ulong>(raw.size()), options.compressionLevel) != MZ_OK)
+				{
+					throw RuntimeError("Failed to compress binary G-code block");
+				}
+				// blocks that don't shrink are stored as they are, a stored size equal to the raw size says so
+				const std::string& out = storedSize < raw.size() ? stored : raw;
+				const size_t outSize = storedSize < raw.size() ? storedSize : raw.size();
+				sink.Write({ out.data(), outSize });
+				blocks.push_back(BlockRecord{ fileOffset, static_cast<uint32_t>(outSize), static_cast<uint32_t>(raw.size()), blockMoveCount });
+				fileOffset += outSize;
+				raw.clear();
+				blockMoveCount = 0;
+				state = MoveState{};
+				};
+
+			bool first = true;
+			int64_t lastZ = 0;
+			forEachMove([&](const FixedMove& move, float height) {
+				const bool newLayer = first || move.z != lastZ;
+				if ((newLayer && blockMoveCount >= blockMoves) || blockMoveCount >= MAX_BLOCK_FACTOR * blockMoves)
+					flushBlock();
+				if (newLayer)
+					layers.push_back(LayerRecord{ 0, static_cast<uint32_t>(blocks.size()), static_cast<uint32_t>(raw.size()), height, state });
+				first = false;
+				lastZ = move.z;
+
+				uint8_t tag = static_cast<uint8_t>(move.type);
+				if (move.hasFeed) tag |= TAG_HAS_FEED;
+				if (move.hasFeed && move.feed != state.feed) tag |= TAG_FEED_CHANGED;
+				if (move.z != state.z) tag |= TAG_Z_CHANGED;
+				if (move.negativeZero != 0) tag |= TAG_NEGATIVE_ZERO;
+				raw.push_back(static_cast<char>(tag));
+				PutSigned(raw, move.x - state.x);
+				PutSigned(raw, move.y - state.y);
+				if (tag & TAG_Z_CHANGED) PutSigned(raw, move.z - state.z);
+				if (move.type == GcodeType::G2 || move.type == GcodeType::G3)
+				{
+					PutSigned(raw, move.i);
+					PutSigned(raw, move.j);
+					PutSigned(raw, move.k);
+				}
+				if (tag & TAG_FEED_CHANGED) PutSigned(raw, move.feed - state.feed);
+				PutSigned(raw, move.extrusion - state.extrusion);
+				if (tag & TAG_NEGATIVE_ZERO) raw.push_back(static_cast<char>(move.negativeZero));
+
+				state.x = move.x;
+				state.y = move.y;
+				state.z = move.z;
+				if (move.hasFeed) state.feed = move.feed;
+				state.extrusion = move.extrusion;
+				++blockMoveCount;
+				++moveCount;
+				++layers.back().moveCount;
+				});
+			flushBlock();
+
+			std::string tables;
+			tables.reserve(blocks.size() * BLOCK_ENTRY_BYTES + layers.size() * LAYER_ENTRY_BYTES + TRAILER_BYTES);
+			for (const auto& block : blocks)
+			{
+				PutLE(tables, block.offset);
+				PutLE(tables, block.storedSize);
+				PutLE(tables, block.rawSize);
+				PutLE(tables, block.moveCount);
+			}
+			for (const auto& layer : layers)
+			{
+				PutLE(tables, layer.moveCount);
+				PutLE(tables, layer.block);
+				PutLE(tables, layer.rawOffset);
+				PutFloat(tables, layer.height);
+				PutLE(tables, layer.state.x);
+				PutLE(tables, layer.state.y);
+				PutLE(tables, layer.state.z);
+				PutLE(tables, layer.state.feed);
+				PutLE(tables, layer.state.extrusion);
+			}
+			PutLE(tables, fileOffset);
+			PutLE(tables, moveCount);
+			PutLE(tables, static_cast<uint32_t>(blocks.size()));
+			PutLE(tables, static_cast<uint32_t>(layers.size()));
+			PutLE(tables, static_cast<uint32_t>(BINARY_GCODE_VERSION));
+			tables.append(BINARY_GCODE_MAGIC, sizeof(BINARY_GCODE_MAGIC));
+			sink.Write(tables);
+		}
+	}
+
+	void WriteBinaryGCode(IOutputSink& sink, GCodeUnits units, const OutPoints3& start,
+		std::span<const GPoint> moves, const BinaryGCodeOptions& options)
+	{
+		WriteMoves(sink, units, start, [&](auto&& visit) {
+			FixedMove move;
+			for (const auto& point : moves)
+			{
+				if (!IsMotion(point.type)) continue;
+				if (!GCodeWriter::Quantize(point, move))
+					throw InvalidArgumentError("G-code move can't be stored in fixed point");
+				visit(move, point.p1.z);
+			}
+			}, options);
+	}
+
+	void WriteBinaryGCode(IOutputSink& sink, GCodeUnits units, const OutPoints3& start,
+		const GPointStore& moves, const BinaryGCodeOptions& options)
+	{
+		WriteMoves(sink, units, start, [&](auto&& visit) {
+			FixedMove move;
+			for (const GPoint point : moves)
+			{
+				if (!IsMotion(point.type)) continue;
+				if (!GCodeWriter::Quantize(point, move))
+					throw InvalidArgumentError("G-code move can't be stored in fixed point");
+				visit(move, point.p1.z);
+			}
+			}, options);
+	}
+
+	BinaryGCodeReader::BinaryGCodeReader(const std::filesystem::path& path)
+		: file_{ path, std::ios::binary }
+	{
+		if (!file_) throw IOError("Failed to open binary G-code file: " + path.string());
+		auto read = [&](uint64_t offset, size_t size) {
+			std::string bytes(size, '\0');
+			file_.seekg(static_cast<std::streamoff>(offset));
+			file_.read(bytes.data(), static_cast<std::streamsize>(size));
+			if (!file_) Corrupt("unexpected end of file");
+			return bytes;
+			};
+		file_.seekg(0, std::ios::end);
+		const auto fileSize = static_cast<uint64_t>(file_.tellg());
+		if (fileSize < HEADER_BYTES + TRAILER_BYTES) Corrupt("file too small");
+
+		const auto header = read(0, HEADER_BYTES);
+		if (std::memcmp(header.data(), BINARY_GCODE_MAGIC, sizeof(BINARY_GCODE_MAGIC)) != 0) Corrupt("bad magic");
+		if (GetLE<uint16_t>(header.data() + 4) != BINARY_GCODE_VERSION) Corrupt("unsupported version");
+		units_ = static_cast<GCodeUnits>(header[6]);
+		start_ = { GetFloat(header.data() + 8), GetFloat(header.data() + 12), GetFloat(header.data() + 16) };
+
+		const auto trailer = read(fileSize - TRAILER_BYTES, TRAILER_BYTES);
+		if (std::memcmp(trailer.data() + TRAILER_BYTES - 4, BINARY_GCODE_MAGIC, sizeof(BINARY_GCODE_MAGIC)) != 0) Corrupt("bad trailer");
+		const auto tablesOffset = GetLE<uint64_t>(trailer.data());
+		moveCount_ = GetLE<uint64_t>(trailer.data() + 8);
+		const auto blockCount = GetLE<uint32_t>(trailer.data() + 16);
+		const auto layerCount = GetLE<uint32_t>(trailer.data() + 20);
+		const uint64_t tablesSize = uint64_t{ blockCount } * BLOCK_ENTRY_BYTES + uint64_t{ layerCount } * LAYER_ENTRY_BYTES;
+		if (tablesOffset < HEADER_BYTES || tablesOffset + tablesSize + TRAILER_BYTES != fileSize) Corrupt("bad table offset");
+
+		const auto tables = read(tablesOffset, static_cast<size_t>(tablesSize));
+		const char* p = tables.data();
+		blocks_.resize(blockCount);
+		uint64_t blockMoves = 0;
+		for (auto& block : blocks_)
+		{
+			block.offset = GetLE<uint64_t>(p);
+			block.storedSize = GetLE<uint32_t>(p + 8);
+			block.rawSize = GetLE<uint32_t>(p + 12);
+			block.moveCount = GetLE<uint64_t>(p + 16);
+			p += BLOCK_ENTRY_BYTES;
+			if (block.offset < HEADER_BYTES || block.offset + block.storedSize > tablesOffset || block.storedSize > block.rawSize)
+				Corrupt("bad block entry");
+			blockMoves += block.moveCount;
+		}
+		layers_.resize(layerCount);
+		uint64_t layerMoves = 0;
+		for (auto& layer : layers_)
+		{
+			layer.moveCount = GetLE<uint64_t>(p);
+			layer.block = GetLE<uint32_t>(p + 8);
+			layer.rawOffset = GetLE<uint32_t>(p + 12);
+			layer.height = GetFloat(p + 16);
+			layer.x = GetLE<int64_t>(p + 20);
+			layer.y = GetLE<int64_t>(p + 28);
+			layer.z = GetLE<int64_t>(p + 36);
+			layer.feed = GetLE<int64_t>(p + 44);
+			layer.extrusion = GetLE<int64_t>(p + 52);
+			p += LAYER_ENTRY_BYTES;
+			if (layer.block >= blockCount || layer.rawOffset > blocks_[layer.block].rawSize) Corrupt("bad layer entry");
+			layerMoves += layer.moveCount;
+		}
+		if (blockMoves != moveCount_ || layerMoves != moveCount_) Corrupt("move counts don't match");
+	}
+
+	float BinaryGCodeReader::LayerHeight(size_t layer) const
+	{
+		if (layer >= layers_.size()) throw OutOfRangeError("Layer index out of range");
+		return layers_[layer].height;
+	}
+
+	const std::string& BinaryGCodeReader::LoadBlock(uint32_t block)
+	{
+		if (block == cachedBlock_) return cache_;
+		const auto& entry = blocks_[block];
+		std::string stored(entry.storedSize, '\0');
+		file_.clear();
+		file_.seekg(static_cast<std::streamoff>(entry.offset));
+		file_.read(stored.data(), static_cast<std::streamsize>(stored.size()));
+		if (!file_) throw IOError("Failed to read binary G-code block");
+		cachedBlock_ = UINT32_MAX;
+		if (entry.storedSize == entry.rawSize)
+		{
+			cache_ = std::move(stored);
+		}
+		else
+		{
+			cache_.resize(entry.rawSize);
+			mz_ulong rawSize = entry.rawSize;
+			if (mz_uncompress(reinterpret_cast<unsigned char*>(cache_.data()), &rawSize,
+				reinterpret_cast<const unsigned char*>(stored.data()), static_cast<mz_ulong>(stored.size())) != MZ_OK ||
+				rawSize != entry.rawSize)
+			{
+				Corrupt("block doesn't decompress");
+			}
+		}
+		cachedBlock_ = block;
+		return cache_;
+	}
+
+	template <typename Visitor>
+	void BinaryGCodeReader::DecodeLayer(size_t layer, Visitor&& visit)
+	{
+		if (layer >= layers_.size()) throw OutOfRangeError("Layer index out of range");
+		const auto& entry = layers_[layer];
+		MoveState state{ entry.x, entry.y, entry.z, entry.feed, entry.extrusion };
+		uint32_t block = entry.block;
+		MoveDecoder decoder(LoadBlock(block), entry.rawOffset);
+		for (uint64_t i = 0; i < entry.moveCount; ++i)
+		{
+			// a long layer continues in the next block, which starts from a fresh state
+			while (decoder.AtEnd())
+			{
+				if (++block >= blocks_.size()) Corrupt("layer runs past the last block");
+				decoder = MoveDecoder(LoadBlock(block), 0);
+				state = MoveState{};
+			}
+			visit(decoder.Next(state));
+		}
+	}
+
+	std::vector<GPoint> BinaryGCodeReader::ReadLayer(size_t layer)
+	{
+		std::vector<GPoint> points;
+		if (layer < layers_.size()) points.reserve(static_cast<size_t>(layers_[layer].moveCount));
+		DecodeLayer(layer, [&](const FixedMove& move) { points.push_back(ToPoint(move)); });
+		return points;
+	}
+
+	std::vector<GPoint> BinaryGCodeReader::ReadAll()
+	{
+		std::vector<GPoint> points;
+		points.reserve(static_cast<size_t>(moveCount_));
+		for (size_t layer = 0; layer < layers_.size(); ++layer)
+			DecodeLayer(layer, [&](const FixedMove& move) { points.push_back(ToPoint(move)); });
+		return points;
+	}
+
+	void BinaryGCodeReader::Stream(IOutputSink& sink)
+	{
+		GCodeWriter writer(STREAM_CHUNK_BYTES + STREAM_CHUNK_BYTES / 8);
+		writer.Header(units_, start_);
+		for (size_t layer = 0; layer < layers_.size(); ++layer)
+		{
+			DecodeLayer(layer, [&](const FixedMove& move) {
+				writer.Move(move);
+				if (writer.size() >= STREAM_CHUNK_BYTES)
+				{
+					sink.Write(writer.View());
+					writer.Clear();
+				}
+				});
+		}
+		if (!writer.empty()) sink.Write(writer.View());
+	}
+
+	std::string BinaryGCodeReader::ToString()
+	{
+		std::string out;
+		StringSink sink(out);
+		Stream(sink);
+		return out;
+	}
+} // namespace HsBa::Slicer
@@ -0,0 +1,102 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_BINARY_GCODE_HPP
+#define HSBA_SLICER_BINARY_GCODE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "pointspath.hpp"
+
+namespace HsBa::Slicer
+{
+	class IOutputSink;
+
+	struct BinaryGCodeOptions
+	{
+		// moves per compressed block, blocks end at a layer change once they reach this size
+		size_t blockMoves = size_t{ 1 } << 14;
+		// miniz level 0-10
+		int compressionLevel = 6;
+	};
+
+	// Compact container for G-code moves. Positions, feed and extrusion are kept in the fixed
+	// point units of the text output and stored as zigzag varint deltas in blocks compressed
+	// with miniz. A table at the end gives the block and decoder state where every layer
+	// starts, so one layer can be read without decoding the ones before it. Decoding back to
+	// text gives exactly PointsPath::ToString. Throws InvalidArgumentError for values the text
+	// output can't hold in fixed point (NaN, infinities, |v| >= 2^52 units)
+	void WriteBinaryGCode(IOutputSink& sink, GCodeUnits units, const OutPoints3& start,
+		std::span<const GPoint> moves, const BinaryGCodeOptions& options = {});
+	// the same for the moves of a PointsPath, without unpacking them to a vector first
+	void WriteBinaryGCode(IOutputSink& sink, GCodeUnits units, const OutPoints3& start,
+		const GPointStore& moves, const BinaryGCodeOptions& options = {});
+
+	class BinaryGCodeReader
+	{
+	public:
+		// reads the header and the tables only, blocks are loaded on demand.
+		// Throws IOError if the file can't be read and RuntimeError if it is malformed
+		explicit BinaryGCodeReader(const std::filesystem::path& path);
+
+		GCodeUnits Units() const noexcept
+		{
+			return units_;
+		}
+		const OutPoints3& StartPoint() const noexcept
+		{
+			return start_;
+		}
+		size_t size() const noexcept
+		{
+			return moveCount_;
+		}
+		size_t LayerCount() const noexcept
+		{
+			return layers_.size();
+		}
+		float LayerHeight(size_t layer) const;
+
+		std::vector<GPoint> ReadLayer(size_t layer);
+		std::vector<GPoint> ReadAll();
+		// text of the whole program, layer by layer
+		void Stream(IOutputSink& sink);
+		std::string ToString();
+	private:
+		struct BlockEntry
+		{
+			uint64_t offset = 0;
+			uint32_t storedSize = 0;
+			uint32_t rawSize = 0;
+			uint64_t moveCount = 0;
+		};
+		struct LayerEntry
+		{
+			uint64_t moveCount = 0;
+			uint32_t block = 0;
+			uint32_t rawOffset = 0;
+			float height = 0.0f;
+			// decoder state before the first move of the layer
+			int64_t x = 0, y = 0, z = 0, feed = 0, extrusion = 0;
+		};
+
+		const std::string& LoadBlock(uint32_t block);
+		template <typename Visitor>
+		void DecodeLayer(size_t layer, Visitor&& visit);
+
+		std::ifstream file_;
+		GCodeUnits units_ = GCodeUnits::mm;
+		OutPoints3 start_;
+		uint64_t moveCount_ = 0;
+		std::vector<BlockEntry> blocks_;
+		std::vector<LayerEntry> layers_;
+		// last decompressed block, layers are mostly read in order
+		uint32_t cachedBlock_ = UINT32_MAX;
+		std::string cache_;
+	};
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_BINARY_GCODE_HPP
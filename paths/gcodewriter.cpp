@@ -0,0 +1,219 @@
+﻿#include "gcodewriter.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace HsBa::Slicer
+{
+	namespace
+	{
+		constexpr double POW10[] = { 1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+		constexpr uint64_t IPOW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+		// below 2^52 every half-integer is a double, which keeps the scaled rounding exact
+		constexpr double FIXED_SHORTCUT_LIMIT = 4503599627370496.0;
+		// longest fixed representation of a double: sign, 309 digits, point and decimals
+		constexpr size_t MAX_FIXED_CHARS = 320;
+		constexpr size_t MIN_GROW_BYTES = size_t{ 1 } << 16;
+
+		const char* MoveCode(GcodeType type)
+		{
+			switch (type)
+			{
+			case GcodeType::G0: return "G0";
+			case GcodeType::G1: return "G1";
+			case GcodeType::G2: return "G2";
+			case GcodeType::G3: return "G3";
+			default: return nullptr;
+			}
+		}
+
+		// value * 10^precision rounded to an integer exactly as printf rounds the decimal
+		// expansion (half to even). The product is rounded once; its error only matters when
+		// the product lands exactly on a half, where it tells on which side the exact value lies
+		bool ScaledRound(double value, int precision, uint64_t& magnitude)
+		{
+			const double scale = POW10[precision];
+			const double p = value * scale;
+			if (!(std::abs(p) < FIXED_SHORTCUT_LIMIT)) return false;
+			double q = std::nearbyint(p);
+			if (std::abs(p - q) == 0.5)
+			{
+				const double err = std::fma(value, scale, -p);
+				if (err > 0) q = std::floor(p) + 1.0;
+				else if (err < 0) q = std::floor(p);
+			}
+			magnitude = static_cast<uint64_t>(std::abs(q));
+			return true;
+		}
+	}
+
+	GCodeWriter::GCodeWriter(size_t reserveBytes)
+	{
+		Reserve(reserveBytes);
+	}
+
+	void GCodeWriter::Reserve(size_t bytes)
+	{
+		if (buffer_.size() < bytes) buffer_.resize(bytes);
+	}
+
+	std::string GCodeWriter::Take()
+	{
+		buffer_.resize(used_);
+		used_ = 0;
+		return std::move(buffer_);
+	}
+
+	char* GCodeWriter::Ensure(size_t bytes)
+	{
+		if (buffer_.size() - used_ < bytes)
+			buffer_.resize(std::max({ buffer_.size() * 2, used_ + bytes, MIN_GROW_BYTES }));
+		return buffer_.data() + used_;
+	}
+
+	void GCodeWriter::Append(std::string_view text)
+	{
+		std::memcpy(Ensure(text.size()), text.data(), text.size());
+		used_ += text.size();
+	}
+
+	void GCodeWriter::Fixed(double value, int precision)
+	{
+		char* first = Ensure(MAX_FIXED_CHARS);
+		char* last = first + MAX_FIXED_CHARS;
+		uint64_t magnitude = 0;
+		if (!ScaledRound(value, precision, magnitude))
+		{
+			// huge values, infinities and NaN
+			used_ = std::to_chars(first, last, value, std::chars_format::fixed, precision).ptr - buffer_.data();
+			return;
+		}
+		// printf keeps the sign of negative values that round to zero
+		FixedDigits(std::signbit(value), magnitude, precision);
+	}
+
+	void GCodeWriter::FixedDigits(bool negative, uint64_t magnitude, int precision)
+	{
+		char* out = Ensure(MAX_FIXED_CHARS);
+		char* last = out + MAX_FIXED_CHARS;
+		if (negative) *out++ = '-';
+		const uint64_t unit = IPOW10[precision];
+		out = std::to_chars(out, last, magnitude / unit).ptr;
+		*out++ = '.';
+		uint64_t frac = magnitude % unit;
+		for (int i = precision - 1; i >= 0; --i)
+		{
+			out[i] = static_cast<char>('0' + frac % 10);
+			frac /= 10;
+		}
+		used_ = out + precision - buffer_.data();
+	}
+
+	void GCodeWriter::Coord(char tag, double value)
+	{
+		char* out = Ensure(2);
+		out[0] = ' ';
+		out[1] = tag;
+		used_ += 2;
+		Fixed(value, COORD_PRECISION);
+	}
+
+	void GCodeWriter::Coord(char tag, int64_t value, bool negativeZero)
+	{
+		char* out = Ensure(2);
+		out[0] = ' ';
+		out[1] = tag;
+		used_ += 2;
+		const bool negative = value < 0 || (value == 0 && negativeZero);
+		FixedDigits(negative, value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), COORD_PRECISION);
+	}
+
+	void GCodeWriter::Header(GCodeUnits units, const OutPoints3& start)
+	{
+		Append(units == GCodeUnits::mm ? "G21 ; units mm\n" : "G20 ; units inch\n");
+		Append("G90\nG0");
+		Coord('X', start.x);
+		Coord('Y', start.y);
+		Coord('Z', start.z);
+		Append("\n");
+	}
+
+	void GCodeWriter::Move(const GPoint& point)
+	{
+		const char* code = MoveCode(point.type);
+		if (code == nullptr) return;
+		Append(code);
+		Coord('X', point.p1.x);
+		Coord('Y', point.p1.y);
+		Coord('Z', point.p1.z);
+		if (point.type == GcodeType::G2 || point.type == GcodeType::G3)
+		{
+			Coord('I', point.center.x);
+			Coord('J', point.center.y);
+			Coord('K', point.center.z);
+		}
+		if (point.velocity > 0.0f)
+			Coord('F', point.velocity);
+		Append(" E");
+		Fixed(point.extrusion, EXTRUSION_PRECISION);
+		Append("\n");
+	}
+
+	void GCodeWriter::Move(const FixedMove& move)
+	{
+		const char* code = MoveCode(move.type);
+		if (code == nullptr) return;
+		Append(code);
+		Coord('X', move.x, move.negativeZero & FixedMove::X);
+		Coord('Y', move.y, move.negativeZero & FixedMove::Y);
+		Coord('Z', move.z, move.negativeZero & FixedMove::Z);
+		if (move.type == GcodeType::G2 || move.type == GcodeType::G3)
+		{
+			Coord('I', move.i, move.negativeZero & FixedMove::I);
+			Coord('J', move.j, move.negativeZero & FixedMove::J);
+			Coord('K', move.k, move.negativeZero & FixedMove::K);
+		}
+		if (move.hasFeed)
+			Coord('F', move.feed, move.negativeZero & FixedMove::F);
+		Append(" E");
+		const bool negative = move.extrusion < 0 || (move.extrusion == 0 && (move.negativeZero & FixedMove::E));
+		FixedDigits(negative, move.extrusion < 0 ? 0 - static_cast<uint64_t>(move.extrusion) : static_cast<uint64_t>(move.extrusion),
+			EXTRUSION_PRECISION);
+		Append("\n");
+	}
+
+	bool GCodeWriter::Quantize(const GPoint& point, FixedMove& move)
+	{
+		move = FixedMove{};
+		move.type = point.type;
+		bool ok = true;
+		auto quantize = [&](double value, int precision, int64_t& out, uint8_t field) {
+			uint64_t magnitude = 0;
+			if (!ScaledRound(value, precision, magnitude))
+			{
+				ok = false;
+				return;
+			}
+			const bool negative = std::signbit(value);
+			out = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+			if (negative && magnitude == 0) move.negativeZero |= field;
+			};
+		quantize(point.p1.x, COORD_PRECISION, move.x, FixedMove::X);
+		quantize(point.p1.y, COORD_PRECISION, move.y, FixedMove::Y);
+		quantize(point.p1.z, COORD_PRECISION, move.z, FixedMove::Z);
+		if (point.type == GcodeType::G2 || point.type == GcodeType::G3)
+		{
+			quantize(point.center.x, COORD_PRECISION, move.i, FixedMove::I);
+			quantize(point.center.y, COORD_PRECISION, move.j, FixedMove::J);
+			quantize(point.center.z, COORD_PRECISION, move.k, FixedMove::K);
+		}
+		move.hasFeed = point.velocity > 0.0f;
+		if (move.hasFeed)
+			quantize(point.velocity, COORD_PRECISION, move.feed, FixedMove::F);
+		quantize(point.extrusion, EXTRUSION_PRECISION, move.extrusion, FixedMove::E);
+		return ok;
+	}
+} // namespace HsBa::Slicer
@@ -0,0 +1,81 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_GCODE_WRITER_HPP
+#define HSBA_SLICER_GCODE_WRITER_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "pointspath.hpp"
+
+namespace HsBa::Slicer
+{
+	// a move in the fixed-point units of the text output: 10^-4 for coordinates and feed,
+	// 10^-6 for extrusion. Printing it gives the same text as the GPoint it was taken from
+	struct FixedMove
+	{
+		enum Field : uint8_t { X = 1, Y = 2, Z = 4, I = 8, J = 16, K = 32, F = 64, E = 128 };
+
+		GcodeType type = GcodeType::G1;
+		int64_t x = 0, y = 0, z = 0;
+		int64_t i = 0, j = 0, k = 0;
+		int64_t feed = 0;
+		int64_t extrusion = 0;
+		bool hasFeed = false;
+		// fields printed as -0, which a zero integer can't tell apart from 0
+		uint8_t negativeZero = 0;
+	};
+
+	// G-code text without streams or locale. Numbers match std::fixed output, 4 decimals for
+	// coordinates and feeds and 6 for extrusion. The buffer keeps its capacity across Clear(),
+	// so one writer can format any number of chunks
+	class GCodeWriter
+	{
+	public:
+		static constexpr int COORD_PRECISION = 4;
+		static constexpr int EXTRUSION_PRECISION = 6;
+
+		GCodeWriter() = default;
+		explicit GCodeWriter(size_t reserveBytes);
+
+		// units, absolute positioning and the move to the start point
+		void Header(GCodeUnits units, const OutPoints3& start);
+		// G0/G1/G2/G3 as one line, other types write nothing
+		void Move(const GPoint& point);
+		void Move(const FixedMove& move);
+		// false when a value is not finite or too large for the fixed-point form
+		static bool Quantize(const GPoint& point, FixedMove& move);
+		void Append(std::string_view text);
+
+		std::string_view View() const noexcept
+		{
+			return { buffer_.data(), used_ };
+		}
+		size_t size() const noexcept
+		{
+			return used_;
+		}
+		bool empty() const noexcept
+		{
+			return used_ == 0;
+		}
+		void Clear() noexcept
+		{
+			used_ = 0;
+		}
+		void Reserve(size_t bytes);
+		// moves the text out, the writer starts over without a buffer
+		std::string Take();
+	private:
+		char* Ensure(size_t bytes);
+		void Coord(char tag, double value);
+		void Coord(char tag, int64_t value, bool negativeZero);
+		void Fixed(double value, int precision);
+		void FixedDigits(bool negative, uint64_t magnitude, int precision);
+
+		std::string buffer_;
+		size_t used_ = 0;
+	};
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_GCODE_WRITER_HPP
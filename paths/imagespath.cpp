@@ -7,7 +7,10 @@
 #include <lua.hpp>
 #include "utils/LuaNewObject.hpp"
 
+#include "outputsink.hpp"
+#include "luaviews.hpp"
 #include "base/error.hpp"
+#include "base/thread_pool.hpp"
 #include "cipher/encoder.hpp"
 #include "fileoperator/zipper.hpp"
 #include "fileoperator/bit7z_zipper.hpp"
@@ -16,29 +19,69 @@
 
 namespace HsBa::Slicer
 {
+	namespace
+	{
+		using ImageEntry = std::unordered_map<std::string, std::string>::value_type;
+
+		// images[i] of the scripts follows the iteration order of the map
+		std::vector<const ImageEntry*> ImageEntries(const std::unordered_map<std::string, std::string>& images)
+		{
+			std::vector<const ImageEntry*> entries;
+			entries.reserve(images.size());
+			for (const auto& image : images) entries.push_back(&image);
+			return entries;
+		}
+
+		bool ImageField(lua_State* L, const ImageEntry& image, std::string_view key)
+		{
+			if (key == "path") lua_pushlstring(L, image.first.data(), image.first.size());
+			else if (key == "data") lua_pushlstring(L, image.second.data(), image.second.size());
+			else return false;
+			return true;
+		}
+
+		void PushImageView(lua_State* L, const ImageEntry* const& image)
+		{
+			PushLuaRecordView<ImageEntry, ImageField>(L, *image);
+		}
+	}
+
 	ImagesPath::ImagesPath(std::string_view config_file, std::string_view config_str,const std::function<void(double, std::string_view)>& callback)
 		: config_{ std::string{config_file},std::string{config_str} },
 		images_{}, callback_{ callback }
 	{
 	}
 
-	void ImagesPath::AddImage(std::string_view path, std::string_view image_str)
+	void ImagesPath::AddImage(std::string_view path, std::string image)
 	{
-		images_.emplace(std::string{path}, std::string{image_str});
+		images_.try_emplace(std::string{ path }, std::move(image));
 	}
 	
 	void ImagesPath::Save(const std::filesystem::path& path) const
 	{
 		Zipper zipper;
 		zipper += callback_;
-		zipper.AddByteFile(config_.path, config_.configStr);
+		zipper.AddByteFileView(config_.path, config_.configStr);
+		// images outlive the zipper, so they are compressed straight from images_
 		for (const auto& [path, image] : images_)
 		{
-			zipper.AddByteFile(path, image);
+			zipper.AddByteFileView(path, image);
 		}
 		zipper.Save(path.string());
 	}
 
+	void ImagesPath::Save(const std::filesystem::path& path, ThreadPool& pool) const
+	{
+		Zipper zipper;
+		zipper += callback_;
+		zipper.AddByteFileView(config_.path, config_.configStr);
+		for (const auto& [path, image] : images_)
+		{
+			zipper.AddByteFileView(path, image);
+		}
+		zipper.Save(path.string(), pool);
+	}
+
 	void ImagesPath::Save(const std::filesystem::path& path, std::string_view script,
 		const std::function<void(lua_State*)>& lua_reg) const
 	{
@@ -60,17 +103,9 @@ namespace HsBa::Slicer
 		lua_pushstring(L.get(), config_.configStr.c_str()); lua_setfield(L.get(), -2, "configStr");
 		lua_setglobal(L.get(), "config");
 
-		// push images table
-		lua_newtable(L.get());
-		int idx = 1;
-		for (const auto& [p, img] : images_)
-		{
-			lua_newtable(L.get());
-			lua_pushstring(L.get(), p.c_str()); lua_setfield(L.get(), -2, "path");
-			lua_pushlstring(L.get(), img.data(), img.size()); lua_setfield(L.get(), -2, "data");
-			lua_rawseti(L.get(), -2, idx);
-			++idx;
-		}
+		// push images, each read when the script touches it
+		const auto images = ImageEntries(images_);
+		PushLuaArrayView<const ImageEntry*, PushImageView>(L.get(), images);
 		lua_setglobal(L.get(), "images");
 
 		// push output path
@@ -123,17 +158,9 @@ namespace HsBa::Slicer
 		lua_pushstring(L.get(), config_.path.c_str()); lua_setfield(L.get(), -2, "path");
 		lua_pushstring(L.get(), config_.configStr.c_str()); lua_setfield(L.get(), -2, "configStr");
 		lua_setglobal(L.get(), "config");
-		// push images
-		lua_newtable(L.get());
-		int idx = 1;
-		for (const auto& [p, img] : images_)
-		{
-			lua_newtable(L.get());
-			lua_pushstring(L.get(), p.c_str()); lua_setfield(L.get(), -2, "path");
-			lua_pushlstring(L.get(), img.data(), img.size()); lua_setfield(L.get(), -2, "data");
-			lua_rawseti(L.get(), -2, idx);
-			++idx;
-		}
+		// push images, each read when the script touches it
+		const auto images = ImageEntries(images_);
+		PushLuaArrayView<const ImageEntry*, PushImageView>(L.get(), images);
 		lua_setglobal(L.get(), "images");
 		// push path and funcName
 		lua_pushstring(L.get(), path.string().c_str());
@@ -189,17 +216,9 @@ namespace HsBa::Slicer
 		lua_pushstring(L.get(), config_.configStr.c_str()); lua_setfield(L.get(), -2, "configStr");
 		lua_setglobal(L.get(), "config");
 
-		// push images table
-		lua_newtable(L.get());
-		int idx = 1;
-		for (const auto& [p, img] : images_)
-		{
-			lua_newtable(L.get());
-			lua_pushstring(L.get(), p.c_str()); lua_setfield(L.get(), -2, "path");
-			lua_pushlstring(L.get(), img.data(), img.size()); lua_setfield(L.get(), -2, "data");
-			lua_rawseti(L.get(), -2, idx);
-			++idx;
-		}
+		// push images, each read when the script touches it
+		const auto images = ImageEntries(images_);
+		PushLuaArrayView<const ImageEntry*, PushImageView>(L.get(), images);
 		lua_setglobal(L.get(), "images");
 
 		int loadStatus = luaL_loadbuffer(L.get(), script.data(), script.size(), "ImagesPathToStringScript");
@@ -240,17 +259,9 @@ namespace HsBa::Slicer
 		lua_pushstring(L.get(), config_.path.c_str()); lua_setfield(L.get(), -2, "path");
 		lua_pushstring(L.get(), config_.configStr.c_str()); lua_setfield(L.get(), -2, "configStr");
 		lua_setglobal(L.get(), "config");
-		// push images
-		lua_newtable(L.get());
-		int idx = 1;
-		for (const auto& [p, img] : images_)
-		{
-			lua_newtable(L.get());
-			lua_pushstring(L.get(), p.c_str()); lua_setfield(L.get(), -2, "path");
-			lua_pushlstring(L.get(), img.data(), img.size()); lua_setfield(L.get(), -2, "data");
-			lua_rawseti(L.get(), -2, idx);
-			++idx;
-		}
+		// push images, each read when the script touches it
+		const auto images = ImageEntries(images_);
+		PushLuaArrayView<const ImageEntry*, PushImageView>(L.get(), images);
 		lua_setglobal(L.get(), "images");
 		// push funcName
 		lua_pushstring(L.get(), funcName.data()); lua_setglobal(L.get(), "funcName");
@@ -286,18 +297,26 @@ namespace HsBa::Slicer
 		return ToString(std::string_view{script}, funcName, lua_reg);
 	}
 
-	std::string ImagesPath::ToString() const
+	void ImagesPath::Stream(IOutputSink& sink) const
 	{
-		callback_(0.0, "save as string, no use callback");
-		std::ostringstream oss;
-		oss << "#" << config_.path << "\n";
-		oss << config_.configStr << "\n";
+		std::string text = "#" + config_.path + "\n" + config_.configStr + "\n";
+		sink.Write(text);
 		for (const auto& [path, image] : images_)
 		{
-			oss << "#" << path << "\n";
-			oss << Cipher::Encoder::base64_decode_to_string(image) << "\n";
+			text = "#" + path + "\n";
+			sink.Write(text);
+			sink.Write(Cipher::Encoder::base64_decode_to_string(image));
+			sink.Write("\n");
 		}
-		return oss.str();
+	}
+
+	std::string ImagesPath::ToString() const
+	{
+		callback_(0.0, "save as string, no use callback");
+		std::string out;
+		StringSink sink(out);
+		Stream(sink);
+		return out;
 	}
 
 	
@@ -9,13 +9,19 @@
 
 namespace HsBa::Slicer
 {
+	class ThreadPool;
+
 	class ImagesPath : public IPath
 	{
 	public:
 		ImagesPath(std::string_view config_file, std::string_view config_str,
 			const std::function<void(double,std::string_view)>& callback = [](double,std::string_view){});
 		virtual ~ImagesPath() = default;
+		// the text form of ToString, Save writes a zip archive instead
+		virtual void Stream(IOutputSink& sink) const override;
 		virtual void Save(const std::filesystem::path&) const override;
+		// same archive as Save, the images are deflated on pool while earlier ones are written
+		void Save(const std::filesystem::path& path, ThreadPool& pool) const;
 		virtual void Save(const std::filesystem::path&, std::string_view script,
 			const std::function<void(lua_State*)>& lua_reg = {}) const override;
 		virtual std::string ToString() const override;
@@ -29,7 +35,8 @@ namespace HsBa::Slicer
 			const std::function<void(lua_State*)>& lua_reg = {}) const override;
 		virtual void Save(const std::filesystem::path& path, const std::filesystem::path& script_file, std::string_view funcName,
 			const std::function<void(lua_State*)>& lua_reg = {}) const override;
-		void AddImage(std::string_view path, std::string_view image_str);
+		// takes the encoded image by value, move in e.g. the result of ToPNG to avoid a copy
+		void AddImage(std::string_view path, std::string image);
 	private:
 		struct ConfigFile {
 			std::string path;
@@ -0,0 +1,177 @@
+﻿#include "layerblob.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include "base/error.hpp"
+
+namespace HsBa::Slicer
+{
+    namespace
+    {
+        constexpr size_t HEADER_BYTES = 16;
+        // packed doubles are copied as they are when the host layout is already the blob layout
+        constexpr bool DIRECT_COPY = std::endian::native == std::endian::little &&
+            sizeof(Point2D) == 2 * sizeof(double) && offsetof(Point2D, y) == sizeof(double);
+
+        template <typename T>
+        unsigned char* PutLE(unsigned char* out, T value)
+        {
+            using U = std::make_unsigned_t<T>;
+            auto bits = static_cast<U>(value);
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                out[i] = static_cast<unsigned char>(bits & 0xFF);
+                bits = static_cast<U>(bits >> 8);
+            }
+            return out + sizeof(T);
+        }
+
+        template <typename T>
+        T GetLE(const unsigned char* in)
+        {
+            using U = std::make_unsigned_t<T>;
+            U bits = 0;
+            for (size_t i = sizeof(T); i-- > 0;)
+            {
+                bits = static_cast<U>((bits << 8) | in[i]);
+            }
+            return static_cast<T>(bits);
+        }
+
+        int32_t Quantize(double v, double resolution)
+        {
+            const double q = std::round(v / resolution);
+            // also false for NaN
+            if (!(q >= std::numeric_limits<int32_t>::min() && q <= std::numeric_limits<int32_t>::max()))
+            {
+                throw InvalidArgumentError("Layer coordinate doesn't fit the Int32 blob encoding");
+            }
+            return static_cast<int32_t>(q);
+        }
+
+        [[noreturn]] void Corrupt(const char* what)
+        {
+            throw RuntimeError(std::string("Corrupt layer blob: ") + what);
+        }
+    }
+
+    void EncodeLayerBlob(const PolygonsD& layer, LayerBlobEncoding encoding, double resolution,
+        std::vector<unsigned char>& out)
+    {
+        if (!(resolution > 0.0) || !std::isfinite(resolution))
+        {
+            throw InvalidArgumentError("Layer blob resolution must be positive");
+        }
+        if (layer.size() > std::numeric_limits<uint32_t>::max())
+        {
+            throw InvalidArgumentError("Too many polygons in one layer");
+        }
+        const size_t coordBytes = encoding == LayerBlobEncoding::Int32 ? sizeof(int32_t) : sizeof(double);
+        size_t points = 0;
+        for (const auto& polygon : layer)
+        {
+            if (polygon.size() > std::numeric_limits<uint32_t>::max())
+            {
+                throw InvalidArgumentError("Too many points in one polygon");
+            }
+            points += polygon.size();
+        }
+        out.resize(HEADER_BYTES + layer.size() * sizeof(uint32_t) + points * 2 * coordBytes);
+
+        unsigned char* p = out.data();
+        *p++ = static_cast<unsigned char>(encoding);
+        *p++ = 0;
+        *p++ = 0;
+        *p++ = 0;
+        p = PutLE(p, static_cast<uint32_t>(layer.size()));
+        p = PutLE(p, std::bit_cast<uint64_t>(resolution));
+        for (const auto& polygon : layer)
+        {
+            p = PutLE(p, static_cast<uint32_t>(polygon.size()));
+        }
+        for (const auto& polygon : layer)
+        {
+            if (encoding == LayerBlobEncoding::Int32)
+            {
+                for (const auto& point : polygon)
+                {
+                    p = PutLE(p, Quantize(point.x, resolution));
+                    p = PutLE(p, Quantize(point.y, resolution));
+                }
+            }
+            else if constexpr (DIRECT_COPY)
+            {
+                if (!polygon.empty()) std::memcpy(p, polygon.data(), polygon.size() * sizeof(Point2D));
+                p += polygon.size() * sizeof(Point2D);
+            }
+            else
+            {
+                for (const auto& point : polygon)
+                {
+                    p = PutLE(p, std::bit_cast<uint64_t>(point.x));
+                    p = PutLE(p, std::bit_cast<uint64_t>(point.y));
+                }
+            }
+        }
+    }
+
+    void DecodeLayerBlob(std::span<const unsigned char> blob, PolygonsD& out)
+    {
+        if (blob.size() < HEADER_BYTES) Corrupt("too short");
+        const unsigned char* p = blob.data();
+        const auto encoding = static_cast<LayerBlobEncoding>(p[0]);
+        if (encoding != LayerBlobEncoding::Float64 && encoding != LayerBlobEncoding::Int32) Corrupt("unknown encoding");
+        const size_t coordBytes = encoding == LayerBlobEncoding::Int32 ? sizeof(int32_t) : sizeof(double);
+        const auto polygons = GetLE<uint32_t>(p + 4);
+        const double resolution = std::bit_cast<double>(GetLE<uint64_t>(p + 8));
+        p += HEADER_BYTES;
+        if ((blob.size() - HEADER_BYTES) / sizeof(uint32_t) < polygons) Corrupt("polygon table truncated");
+
+        size_t points = 0;
+        for (uint32_t i = 0; i < polygons; ++i)
+        {
+            points += GetLE<uint32_t>(p + i * sizeof(uint32_t));
+        }
+        if (points > blob.size() / (2 * coordBytes) ||
+            blob.size() != HEADER_BYTES + polygons * sizeof(uint32_t) + points * 2 * coordBytes)
+        {
+            Corrupt("size doesn't match the point count");
+        }
+
+        out.resize(polygons);
+        const unsigned char* coords = p + polygons * sizeof(uint32_t);
+        for (uint32_t i = 0; i < polygons; ++i)
+        {
+            auto& polygon = out[i];
+            polygon.resize(GetLE<uint32_t>(p + i * sizeof(uint32_t)));
+            if (encoding == LayerBlobEncoding::Int32)
+            {
+                for (auto& point : polygon)
+                {
+                    point.x = GetLE<int32_t>(coords) * resolution;
+                    point.y = GetLE<int32_t>(coords + sizeof(int32_t)) * resolution;
+                    coords += 2 * sizeof(int32_t);
+                }
+            }
+            else if constexpr (DIRECT_COPY)
+            {
+                if (!polygon.empty()) std::memcpy(polygon.data(), coords, polygon.size() * sizeof(Point2D));
+                coords += polygon.size() * sizeof(Point2D);
+            }
+            else
+            {
+                for (auto& point : polygon)
+                {
+                    point.x = std::bit_cast<double>(GetLE<uint64_t>(coords));
+                    point.y = std::bit_cast<double>(GetLE<uint64_t>(coords + sizeof(double)));
+                    coords += 2 * sizeof(double);
+                }
+            }
+        }
+    }
+
+} // namespace HsBa::Slicer
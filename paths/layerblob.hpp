@@ -0,0 +1,34 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_LAYER_BLOB_HPP
+#define HSBA_SLICER_LAYER_BLOB_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "2D/FloatPolygons.hpp"
+
+namespace HsBa::Slicer
+{
+    enum class LayerBlobEncoding : uint8_t
+    {
+        Float64 = 0,
+        // coordinates rounded to multiples of the resolution, half the size of Float64
+        Int32 = 1
+    };
+
+    constexpr double DEFAULT_LAYER_BLOB_RESOLUTION = 1e-4;
+
+    // layer_data blob written by LayersPath::Save, all little-endian:
+    // u8 encoding, 3 zero bytes, u32 polygon count, f64 resolution,
+    // u32 point count of every polygon, then the x, y pairs as f64 or as i32 multiples of the resolution.
+    // Throws InvalidArgumentError when a coordinate doesn't fit the encoding
+    void EncodeLayerBlob(const PolygonsD& layer, LayerBlobEncoding encoding, double resolution,
+        std::vector<unsigned char>& out);
+    // decodes straight into out, reusing the storage it already has.
+    // Throws RuntimeError for a malformed blob
+    void DecodeLayerBlob(std::span<const unsigned char> blob, PolygonsD& out);
+
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_LAYER_BLOB_HPP
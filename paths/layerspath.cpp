@@ -1,11 +1,15 @@
 ﻿#include "layerspath.hpp"
 
+#include <cmath>
 #include <format>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #include <lua.hpp>
 
+#include "outputsink.hpp"
+#include "luaviews.hpp"
 #include "base/error.hpp"
 #include "fileoperator/sql_adapter.hpp"
 #include "fileoperator/LuaAdapter.hpp"
@@ -13,6 +17,26 @@
 
 namespace HsBa::Slicer
 {
+    namespace
+    {
+        bool PointField(lua_State* L, const Point2D& pt, std::string_view key)
+        {
+            if (key == "x") lua_pushnumber(L, pt.x);
+            else if (key == "y") lua_pushnumber(L, pt.y);
+            else return false;
+            return true;
+        }
+
+        void PushPointView(lua_State* L, const Point2D& pt)
+        {
+            PushLuaRecordView<Point2D, PointField>(L, pt);
+        }
+
+        void PushPolygonView(lua_State* L, const PolygonD& polygon)
+        {
+            PushLuaArrayView<Point2D, PushPointView>(L, polygon);
+        }
+    }
 
     LayersPath::LayersPath(const std::function<void(std::string_view, std::string_view)>& callback)
         : callback_(callback)
@@ -24,6 +48,30 @@ namespace HsBa::Slicer
         layers_.emplace_back(LayersData{layerConfig, layer});
     }
 
+    void LayersPath::PushLuaLayers(lua_State* L) const
+    {
+        // layers[i].config, layers[i].data[j][k].x of the scripts, read from layers_ when touched
+        PushLuaArrayView(L, layers_.data(), layers_.size(), sizeof(LayersData), [](lua_State* L, const void* layer) {
+            PushLuaRecordView(L, layer, [](lua_State* L, const void* layer, std::string_view key) {
+                const auto& data = *static_cast<const LayersData*>(layer);
+                if (key == "config") lua_pushlstring(L, data.layerConfig.data(), data.layerConfig.size());
+                else if (key == "data") PushLuaArrayView<PolygonD, PushPolygonView>(L, data.layer);
+                else return false;
+                return true;
+                });
+            });
+    }
+
+    void LayersPath::SetBlobEncoding(LayerBlobEncoding encoding, double resolution)
+    {
+        if (!(resolution > 0.0) || !std::isfinite(resolution))
+        {
+            throw InvalidArgumentError("Layer blob resolution must be positive");
+        }
+        encoding_ = encoding;
+        resolution_ = resolution;
+    }
+
     void LayersPath::Save(const std::filesystem::path& path) const
     {
         SQL::SQLiteAdapter db;
@@ -40,28 +88,20 @@ namespace HsBa::Slicer
                 {"layer_config", "TEXT NOT NULL"},
                 {"layer_data", "BLOB NOT NULL"}
             });
+        // one transaction through one compiled insert, an autocommitted insert per layer
+        // would wait for its own journal sync
+        SQL::SQLiteTransaction transaction(db);
+        auto insert = db.Prepare("INSERT INTO layers (layer_config, layer_data) VALUES (?, ?)");
+        std::vector<unsigned char> blob;
         for (const auto& layerData : layers_)
         {
-            std::ostringstream ss;
-            ss << "{";
-            for (const auto& polygon : layerData.layer)
-            {
-                ss << "[";
-                for (const auto& point : polygon)
-                {
-                    ss << std::format("({},{}),", point.x, point.y);
-                }
-                ss.seekp(-1, ss.cur);
-                ss << "],";
-            }
-            ss << "}";
-            db | SQL::SQLInsert(
-                "layers",
-                {
-                    {"layer_config", layerData.layerConfig},
-                    {"layer_data", ss.str()}
-                });
+            EncodeLayerBlob(layerData.layer, encoding_, resolution_, blob);
+            insert.BindText(1, layerData.layerConfig);
+            insert.BindBlob(2, blob);
+            insert.Step();
+            insert.Reset();
         }
+        transaction.Commit();
     }
 
         void LayersPath::Save(const std::filesystem::path& path, std::string_view script,
@@ -88,33 +128,7 @@ namespace HsBa::Slicer
 
 
         // push layers as global similar to ToString
-        lua_newtable(L.get());
-        int idx = 1;
-        for (const auto& layerData : layers_)
-        {
-            lua_newtable(L.get()); // layerData
-            lua_pushstring(L.get(), layerData.layerConfig.c_str()); lua_setfield(L.get(), -2, "config");
-            lua_newtable(L.get());
-            int poly_idx = 1;
-            for (const auto& poly : layerData.layer)
-            {
-                lua_newtable(L.get());
-                int pt_idx = 1;
-                for (const auto& pt : poly)
-                {
-                    lua_newtable(L.get());
-                    lua_pushnumber(L.get(), pt.x); lua_setfield(L.get(), -2, "x");
-                    lua_pushnumber(L.get(), pt.y); lua_setfield(L.get(), -2, "y");
-                    lua_rawseti(L.get(), -2, pt_idx);
-                    ++pt_idx;
-                }
-                lua_rawseti(L.get(), -2, poly_idx);
-                ++poly_idx;
-            }
-            lua_setfield(L.get(), -2, "data");
-            lua_rawseti(L.get(), -2, idx);
-            ++idx;
-        }
+        PushLuaLayers(L.get());
         lua_setglobal(L.get(), "layers");
 
         if (script.empty())
@@ -181,33 +195,7 @@ namespace HsBa::Slicer
         lua_setglobal(L.get(), "db");
 
         // push layers
-        lua_newtable(L.get());
-        int idx = 1;
-        for (const auto& layerData : layers_)
-        {
-            lua_newtable(L.get()); // layerData
-            lua_pushstring(L.get(), layerData.layerConfig.c_str()); lua_setfield(L.get(), -2, "config");
-            lua_newtable(L.get());
-            int poly_idx = 1;
-            for (const auto& poly : layerData.layer)
-            {
-                lua_newtable(L.get());
-                int pt_idx = 1;
-                for (const auto& pt : poly)
-                {
-                    lua_newtable(L.get());
-                    lua_pushnumber(L.get(), pt.x); lua_setfield(L.get(), -2, "x");
-                    lua_pushnumber(L.get(), pt.y); lua_setfield(L.get(), -2, "y");
-                    lua_rawseti(L.get(), -2, pt_idx);
-                    ++pt_idx;
-                }
-                lua_rawseti(L.get(), -2, poly_idx);
-                ++poly_idx;
-            }
-            lua_setfield(L.get(), -2, "data");
-            lua_rawseti(L.get(), -2, idx);
-            ++idx;
-        }
+        PushLuaLayers(L.get());
         lua_setglobal(L.get(), "layers");
 
         // push path
@@ -264,28 +252,37 @@ namespace HsBa::Slicer
         Save(path, std::string_view{script}, funcName, lua_reg);
     }
 
-    std::string LayersPath::ToString() const
+    void LayersPath::Stream(IOutputSink& sink) const
     {
-        std::ostringstream ss;
-        ss << "{";
+        // one layer is formatted at a time, the buffer is reused for the next one
+        std::string text;
+        sink.Write("{");
         for (const auto& layerData : layers_)
         {
-            ss << "{config: " << layerData.layerConfig << ", data: ";
-            ss << "{";
+            text.clear();
+            auto out = std::back_inserter(text);
+            std::format_to(out, "{{config: {}, data: {{", layerData.layerConfig);
             for (const auto& polygon : layerData.layer)
             {
-                ss << "[";
-                for (const auto& point : polygon)
+                text += '[';
+                for (size_t i = 0; i < polygon.size(); ++i)
                 {
-                    ss << std::format("({},{}),", point.x, point.y);
+                    std::format_to(out, i == 0 ? "({},{})" : ",({},{})", polygon[i].x, polygon[i].y);
                 }
-                ss.seekp(-1, ss.cur);
-                ss << "],";
+                text += "],";
             }
-            ss << "}},";
+            text += "}},";
+            sink.Write(text);
         }
-        ss << "}";
-        return ss.str();
+        sink.Write("}");
+    }
+
+    std::string LayersPath::ToString() const
+    {
+        std::string out;
+        StringSink sink(out);
+        Stream(sink);
+        return out;
     }
 
     std::string LayersPath::ToString(const std::string_view script,
@@ -299,33 +296,7 @@ namespace HsBa::Slicer
         if (lua_reg) lua_reg(L.get());
 
         // push layers as global like Save
-        lua_newtable(L.get());
-        int idx = 1;
-        for (const auto& layerData : layers_)
-        {
-            lua_newtable(L.get()); // layerData
-            lua_pushstring(L.get(), layerData.layerConfig.c_str()); lua_setfield(L.get(), -2, "config");
-            lua_newtable(L.get());
-            int poly_idx = 1;
-            for (const auto& poly : layerData.layer)
-            {
-                lua_newtable(L.get());
-                int pt_idx = 1;
-                for (const auto& pt : poly)
-                {
-                    lua_newtable(L.get());
-                    lua_pushnumber(L.get(), pt.x); lua_setfield(L.get(), -2, "x");
-                    lua_pushnumber(L.get(), pt.y); lua_setfield(L.get(), -2, "y");
-                    lua_rawseti(L.get(), -2, pt_idx);
-                    ++pt_idx;
-                }
-                lua_rawseti(L.get(), -2, poly_idx);
-                ++poly_idx;
-            }
-            lua_setfield(L.get(), -2, "data");
-            lua_rawseti(L.get(), -2, idx);
-            ++idx;
-        }
+        PushLuaLayers(L.get());
         lua_setglobal(L.get(), "layers");
 
         int loadStatus = luaL_loadbuffer(L.get(), script.data(), script.size(), "LayersPathToStringScript");
@@ -376,33 +347,7 @@ namespace HsBa::Slicer
         luaL_openlibs(L.get());
         if (lua_reg) lua_reg(L.get());
         // like without funcName, push layers
-        lua_newtable(L.get());
-        int idx = 1;
-        for (const auto& layerData : layers_)
-        {
-            lua_newtable(L.get()); // layerData
-            lua_pushstring(L.get(), layerData.layerConfig.c_str()); lua_setfield(L.get(), -2, "config");
-            lua_newtable(L.get());
-            int poly_idx = 1;
-            for (const auto& poly : layerData.layer)
-            {
-                lua_newtable(L.get());
-                int pt_idx = 1;
-                for (const auto& pt : poly)
-                {
-                    lua_newtable(L.get());
-                    lua_pushnumber(L.get(), pt.x); lua_setfield(L.get(), -2, "x");
-                    lua_pushnumber(L.get(), pt.y); lua_setfield(L.get(), -2, "y");
-                    lua_rawseti(L.get(), -2, pt_idx);
-                    ++pt_idx;
-                }
-                lua_rawseti(L.get(), -2, poly_idx);
-                ++poly_idx;
-            }
-            lua_setfield(L.get(), -2, "data");
-            lua_rawseti(L.get(), -2, idx);
-            ++idx;
-        }
+        PushLuaLayers(L.get());
         lua_setglobal(L.get(), "layers");
         // push function name
         lua_pushstring(L.get(), funcName.data());
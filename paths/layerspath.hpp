@@ -7,6 +7,7 @@
 
 #include "IPath.hpp"
 #include "2D/FloatPolygons.hpp"
+#include "layerblob.hpp"
 
 namespace HsBa::Slicer
 {
@@ -15,6 +16,8 @@ namespace HsBa::Slicer
     public:
         LayersPath(const std::function<void(std::string_view, std::string_view)>& callback = [](std::string_view, std::string_view){});
         virtual ~LayersPath() = default;
+        // the text form of ToString, one layer at a time
+        virtual void Stream(IOutputSink& sink) const override;
         virtual void Save(const std::filesystem::path& path) const override;
         virtual void Save(const std::filesystem::path& path, std::string_view script,
             const std::function<void(lua_State*)>& lua_reg = {}) const override;
@@ -30,7 +33,11 @@ namespace HsBa::Slicer
         virtual void Save(const std::filesystem::path& path, const std::filesystem::path& script_file, std::string_view funcName,
             const std::function<void(lua_State*)>& lua_reg = {}) const override;
         void push_back(const std::string& layerConfig, const PolygonsD& layer);
+        // how Save packs the points of every layer, see layerblob.hpp
+        void SetBlobEncoding(LayerBlobEncoding encoding, double resolution = DEFAULT_LAYER_BLOB_RESOLUTION);
     private:
+        // the layers global of the scripts, read-only views over layers_
+        void PushLuaLayers(lua_State* L) const;
         struct LayersData
         {
             std::string layerConfig;
@@ -38,6 +45,8 @@ namespace HsBa::Slicer
         };
         std::function<void(std::string_view, std::string_view)> callback_;
         std::vector<LayersData> layers_;
+        LayerBlobEncoding encoding_ = LayerBlobEncoding::Float64;
+        double resolution_ = DEFAULT_LAYER_BLOB_RESOLUTION;
     };
 
 } // namepace HsBa::Slicer
@@ -0,0 +1,156 @@
+﻿#include "layerspathreader.hpp"
+
+#include "layerblob.hpp"
+#include "base/error.hpp"
+
+namespace HsBa::Slicer
+{
+    namespace
+    {
+        constexpr const char* COLUMNS = "SELECT id, layer_config, layer_data FROM layers ";
+
+        // a statement left mid-way would keep its read transaction open
+        class ResetOnExit
+        {
+        public:
+            explicit ResetOnExit(SQL::SQLiteStatement& statement) : statement_{ statement } {}
+            ~ResetOnExit()
+            {
+                statement_.Reset();
+            }
+        private:
+            SQL::SQLiteStatement& statement_;
+        };
+
+        void ReadRow(const SQL::SQLiteStatement& statement, LayerRecord& out)
+        {
+            out.id = statement.ColumnInt64(0);
+            out.config.assign(statement.ColumnText(1));
+            DecodeLayerBlob(statement.ColumnBlob(2), out.layer);
+        }
+    }
+
+    LayersPathReader::LayersPathReader(const std::filesystem::path& path, size_t prefetch)
+        : prefetch_{ prefetch }
+    {
+        if (!std::filesystem::exists(path))
+        {
+            throw SQL::SQLAdapterConnectionError("Layers database not found: " + path.string());
+        }
+        db_.Connect(path.string());
+        byId_ = db_.Prepare(std::string(COLUMNS) + "WHERE id = ?");
+        after_ = db_.Prepare(std::string(COLUMNS) + "WHERE id > ? ORDER BY id LIMIT ?");
+        range_ = db_.Prepare(std::string(COLUMNS) + "WHERE id BETWEEN ? AND ? ORDER BY id");
+
+        auto summary = db_.Prepare("SELECT COUNT(*), MIN(id), MAX(id) FROM layers");
+        if (summary.Step())
+        {
+            count_ = static_cast<size_t>(summary.ColumnInt64(0));
+            firstId_ = summary.ColumnInt64(1);
+            lastId_ = summary.ColumnInt64(2);
+        }
+    }
+
+    LayersPathReader::~LayersPathReader()
+    {
+        if (pending_.valid())
+        {
+            pending_.wait();
+        }
+    }
+
+    void LayersPathReader::WaitPrefetch()
+    {
+        if (!pending_.valid()) return;
+        try
+        {
+            pending_.get();
+        }
+        catch (...)
+        {
+            // a failed read ahead is dropped, the layer is read again when asked for and reports the error then
+            while (!ahead_.empty())
+            {
+                spare_.push_back(std::move(ahead_.front()));
+                ahead_.pop_front();
+            }
+        }
+    }
+
+    void LayersPathReader::Prefetch(int64_t after, size_t count)
+    {
+        ResetOnExit reset(after_);
+        after_.BindInt64(1, after);
+        after_.BindInt64(2, static_cast<int64_t>(count));
+        while (after_.Step())
+        {
+            LayerRecord record;
+            if (!spare_.empty())
+            {
+                record = std::move(spare_.back());
+                spare_.pop_back();
+            }
+            ReadRow(after_, record);
+            ahead_.push_back(std::move(record));
+        }
+    }
+
+    const LayerRecord& LayersPathReader::Layer(int64_t id)
+    {
+        WaitPrefetch();
+        while (!ahead_.empty() && ahead_.front().id < id)
+        {
+            spare_.push_back(std::move(ahead_.front()));
+            ahead_.pop_front();
+        }
+        if (!ahead_.empty() && ahead_.front().id == id)
+        {
+            std::swap(current_, ahead_.front());
+            spare_.push_back(std::move(ahead_.front()));
+            ahead_.pop_front();
+        }
+        else
+        {
+            // a jump backwards or past the read ahead layers
+            while (!ahead_.empty())
+            {
+                spare_.push_back(std::move(ahead_.front()));
+                ahead_.pop_front();
+            }
+            bool found = false;
+            {
+                ResetOnExit reset(byId_);
+                byId_.BindInt64(1, id);
+                found = byId_.Step();
+                if (found) ReadRow(byId_, current_);
+            }
+            if (!found)
+            {
+                throw OutOfRangeError("No layer with id " + std::to_string(id));
+            }
+        }
+
+        if (ahead_.size() < prefetch_)
+        {
+            const int64_t after = ahead_.empty() ? id : ahead_.back().id;
+            const size_t count = prefetch_ - ahead_.size();
+            pending_ = std::async(std::launch::async, [this, after, count]() { Prefetch(after, count); });
+        }
+        return current_;
+    }
+
+    void LayersPathReader::ReadRange(int64_t first, int64_t last, const std::function<void(const LayerRecord&)>& visit)
+    {
+        WaitPrefetch();
+        ResetOnExit reset(range_);
+        range_.BindInt64(1, first);
+        range_.BindInt64(2, last);
+        LayerRecord record;
+        while (range_.Step())
+        {
+            ReadRow(range_, record);
+            visit(record);
+        }
+    }
+
+} // namespace HsBa::Slicer
@@ -0,0 +1,75 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_LAYERS_PATH_READER_HPP
+#define HSBA_SLICER_LAYERS_PATH_READER_HPP
+
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "2D/FloatPolygons.hpp"
+#include "fileoperator/sql_adapter.hpp"
+
+namespace HsBa::Slicer
+{
+    struct LayerRecord
+    {
+        int64_t id = 0;
+        std::string config;
+        PolygonsD layer;
+    };
+
+    // Reads the database written by LayersPath::Save one layer at a time. Every lookup goes
+    // through the id primary key, and the layers after the last one asked for are read and
+    // decoded on a background thread while the caller works on the current one.
+    // Not safe to share between threads
+    class LayersPathReader
+    {
+    public:
+        // throws SQLAdapterError if the file can't be opened or has no layers table
+        explicit LayersPathReader(const std::filesystem::path& path, size_t prefetch = 2);
+        LayersPathReader(const LayersPathReader&) = delete;
+        LayersPathReader& operator=(const LayersPathReader&) = delete;
+        ~LayersPathReader();
+
+        size_t size() const noexcept
+        {
+            return count_;
+        }
+        // ids of the first and last layer, 0 for an empty database
+        int64_t FirstId() const noexcept
+        {
+            return firstId_;
+        }
+        int64_t LastId() const noexcept
+        {
+            return lastId_;
+        }
+        // valid until the next call. Throws OutOfRangeError if there is no layer with this id
+        const LayerRecord& Layer(int64_t id);
+        // every layer with first <= id <= last in id order, the record is reused between rows
+        void ReadRange(int64_t first, int64_t last, const std::function<void(const LayerRecord&)>& visit);
+    private:
+        void WaitPrefetch();
+        void Prefetch(int64_t after, size_t count);
+
+        SQL::SQLiteAdapter db_;
+        SQL::SQLiteStatement byId_;
+        SQL::SQLiteStatement after_;
+        SQL::SQLiteStatement range_;
+        size_t prefetch_;
+        size_t count_ = 0;
+        int64_t firstId_ = 0;
+        int64_t lastId_ = 0;
+        LayerRecord current_;
+        // layers read ahead in id order, and records whose storage is reused
+        std::deque<LayerRecord> ahead_;
+        std::vector<LayerRecord> spare_;
+        std::future<void> pending_;
+    };
+
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_LAYERS_PATH_READER_HPP
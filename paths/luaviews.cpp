@@ -0,0 +1,182 @@
+﻿#include "luaviews.hpp"
+
+#include <cstddef>
+
+#include <lua.hpp>
+
+namespace HsBa::Slicer
+{
+	namespace
+	{
+		constexpr const char* ARRAY_VIEW = "HsBa.Slicer.ArrayView";
+		constexpr const char* RECORD_VIEW = "HsBa.Slicer.RecordView";
+		constexpr const char* RECORD_COPY = "HsBa.Slicer.RecordCopy";
+
+		// either a strided array or a cursor pusher, whose state follows the header in the same userdata
+		struct alignas(std::max_align_t) ArrayView
+		{
+			const unsigned char* data;
+			size_t size;
+			size_t stride;
+			LuaElementPusher element;
+			LuaCursorPusher cursor;
+		};
+
+		struct RecordView
+		{
+			const void* object;
+			LuaFieldPusher fields;
+		};
+
+		// the copy follows the header in the same userdata
+		struct alignas(std::max_align_t) RecordCopy
+		{
+			LuaFieldPusher fields;
+		};
+
+		void PushElement(lua_State* L, ArrayView* view, size_t index)
+		{
+			if (view->cursor != nullptr)
+			{
+				view->cursor(L, view + 1, index);
+			}
+			else
+			{
+				view->element(L, view->data + index * view->stride);
+			}
+		}
+
+		int ArrayIndex(lua_State* L)
+		{
+			auto* view = static_cast<ArrayView*>(luaL_checkudata(L, 1, ARRAY_VIEW));
+			int isInteger = 0;
+			const lua_Integer i = lua_tointegerx(L, 2, &isInteger);
+			if (!isInteger || i < 1 || static_cast<lua_Unsigned>(i) > view->size)
+			{
+				lua_pushnil(L);
+				return 1;
+			}
+			PushElement(L, view, static_cast<size_t>(i - 1));
+			return 1;
+		}
+
+		int ArrayLength(lua_State* L)
+		{
+			const auto* view = static_cast<const ArrayView*>(luaL_checkudata(L, 1, ARRAY_VIEW));
+			lua_pushinteger(L, static_cast<lua_Integer>(view->size));
+			return 1;
+		}
+
+		int ArrayNext(lua_State* L)
+		{
+			auto* view = static_cast<ArrayView*>(luaL_checkudata(L, 1, ARRAY_VIEW));
+			const lua_Integer i = luaL_checkinteger(L, 2) + 1;
+			if (i < 1 || static_cast<lua_Unsigned>(i) > view->size)
+			{
+				return 0;
+			}
+			lua_pushinteger(L, i);
+			PushElement(L, view, static_cast<size_t>(i - 1));
+			return 2;
+		}
+
+		int ArrayPairs(lua_State* L)
+		{
+			luaL_checkudata(L, 1, ARRAY_VIEW);
+			lua_pushcfunction(L, ArrayNext);
+			lua_pushvalue(L, 1);
+			lua_pushinteger(L, 0);
+			return 3;
+		}
+
+		int RecordIndex(lua_State* L)
+		{
+			const auto* view = static_cast<const RecordView*>(luaL_checkudata(L, 1, RECORD_VIEW));
+			if (lua_type(L, 2) == LUA_TSTRING)
+			{
+				size_t length = 0;
+				const char* key = lua_tolstring(L, 2, &length);
+				if (view->fields(L, view->object, std::string_view(key, length)))
+				{
+					return 1;
+				}
+			}
+			lua_pushnil(L);
+			return 1;
+		}
+
+		int RecordCopyIndex(lua_State* L)
+		{
+			const auto* copy = static_cast<const RecordCopy*>(luaL_checkudata(L, 1, RECORD_COPY));
+			if (lua_type(L, 2) == LUA_TSTRING)
+			{
+				size_t length = 0;
+				const char* key = lua_tolstring(L, 2, &length);
+				if (copy->fields(L, copy + 1, std::string_view(key, length)))
+				{
+					return 1;
+				}
+			}
+			lua_pushnil(L);
+			return 1;
+		}
+
+		int ReadOnly(lua_State* L)
+		{
+			return luaL_error(L, "path data is read-only in scripts, copy it into a table to change it");
+		}
+
+		void PushMetatable(lua_State* L, const char* name, lua_CFunction index)
+		{
+			if (luaL_newmetatable(L, name) == 0)
+			{
+				return;
+			}
+			lua_pushcfunction(L, index);
+			lua_setfield(L, -2, "__index");
+			lua_pushcfunction(L, ReadOnly);
+			lua_setfield(L, -2, "__newindex");
+			if (index == ArrayIndex)
+			{
+				lua_pushcfunction(L, ArrayLength);
+				lua_setfield(L, -2, "__len");
+				lua_pushcfunction(L, ArrayPairs);
+				lua_setfield(L, -2, "__pairs");
+			}
+		}
+	}
+
+	void PushLuaRecordView(lua_State* L, const void* object, LuaFieldPusher fields)
+	{
+		auto* view = static_cast<RecordView*>(lua_newuserdata(L, sizeof(RecordView)));
+		*view = RecordView{ object, fields };
+		PushMetatable(L, RECORD_VIEW, RecordIndex);
+		lua_setmetatable(L, -2);
+	}
+
+	void PushLuaArrayView(lua_State* L, const void* data, size_t size, size_t stride, LuaElementPusher element)
+	{
+		auto* view = static_cast<ArrayView*>(lua_newuserdata(L, sizeof(ArrayView)));
+		*view = ArrayView{ static_cast<const unsigned char*>(data), size, stride, element, nullptr };
+		PushMetatable(L, ARRAY_VIEW, ArrayIndex);
+		lua_setmetatable(L, -2);
+	}
+
+	void* PushLuaArrayView(lua_State* L, size_t size, size_t stateBytes, LuaCursorPusher element)
+	{
+		auto* view = static_cast<ArrayView*>(lua_newuserdata(L, sizeof(ArrayView) + stateBytes));
+		*view = ArrayView{ nullptr, size, 0, nullptr, element };
+		PushMetatable(L, ARRAY_VIEW, ArrayIndex);
+		lua_setmetatable(L, -2);
+		return view + 1;
+	}
+
+	void* PushLuaRecordCopy(lua_State* L, size_t bytes, LuaFieldPusher fields)
+	{
+		auto* copy = static_cast<RecordCopy*>(lua_newuserdata(L, sizeof(RecordCopy) + bytes));
+		copy->fields = fields;
+		PushMetatable(L, RECORD_COPY, RecordCopyIndex);
+		lua_setmetatable(L, -2);
+		return copy + 1;
+	}
+} // namespace HsBa::Slicer
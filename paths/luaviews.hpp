@@ -0,0 +1,86 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_LUA_VIEWS_HPP
+#define HSBA_SLICER_LUA_VIEWS_HPP
+
+#include <cstddef>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+struct lua_State;
+
+namespace HsBa::Slicer
+{
+	// Read-only Lua views over path data, scripts read fields when they touch them instead of
+	// getting a table copy of everything up front. A view holds a raw pointer, so it must not
+	// outlive the data, which holds for the lua_State of one ToString or Save call
+
+	// pushes field key of object and returns true, or returns false for nil
+	using LuaFieldPusher = bool (*)(lua_State* L, const void* object, std::string_view key);
+	using LuaElementPusher = void (*)(lua_State* L, const void* element);
+	// pushes element index (0-based) of a container read through a cursor, state is the view's
+	// copy of that cursor
+	using LuaCursorPusher = void (*)(lua_State* L, void* state, size_t index);
+
+	// object.key, e.g. point.p1 or point.velocity
+	void PushLuaRecordView(lua_State* L, const void* object, LuaFieldPusher fields);
+	// view[i] for 1 <= i <= #view, ipairs and pairs walk it in order
+	void PushLuaArrayView(lua_State* L, const void* data, size_t size, size_t stride, LuaElementPusher element);
+	// a view keeping stateBytes of cursor state for element, which Lua never destroys. Returns
+	// where the state goes
+	void* PushLuaArrayView(lua_State* L, size_t size, size_t stateBytes, LuaCursorPusher element);
+	// a record view that owns a copy of the object, for values made on demand. Returns
+	// where the copy goes
+	void* PushLuaRecordCopy(lua_State* L, size_t bytes, LuaFieldPusher fields);
+
+	template <typename T, bool (*Fields)(lua_State*, const T&, std::string_view)>
+	void PushLuaRecordView(lua_State* L, const T& object)
+	{
+		PushLuaRecordView(L, &object, [](lua_State* L, const void* p, std::string_view key) {
+			return Fields(L, *static_cast<const T*>(p), key);
+			});
+	}
+
+	template <typename T, bool (*Fields)(lua_State*, const T&, std::string_view)>
+	void PushLuaRecordCopy(lua_State* L, const T& object)
+	{
+		static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+			"Lua never runs destructors of userdata");
+		void* copy = PushLuaRecordCopy(L, sizeof(T), [](lua_State* L, const void* p, std::string_view key) {
+			return Fields(L, *static_cast<const T*>(p), key);
+			});
+		::new (copy) T(object);
+	}
+
+	template <typename T, void (*Element)(lua_State*, const T&)>
+	void PushLuaArrayView(lua_State* L, std::span<const T> items)
+	{
+		PushLuaArrayView(L, items.data(), items.size(), sizeof(T), [](lua_State* L, const void* p) {
+			Element(L, *static_cast<const T*>(p));
+			});
+	}
+	// view over a store that makes its elements when read, such as GPointStore. The view keeps
+	// an iterator, so reading element i + 1 after i, as ipairs and counted loops do, steps it
+	// instead of seeking from a checkpoint. Elements are pushed as record copies
+	template <typename Store, bool (*Fields)(lua_State*, const typename Store::value_type&, std::string_view)>
+	void PushLuaStoreView(lua_State* L, const Store& store)
+	{
+		struct Cursor
+		{
+			const Store* store;
+			typename Store::const_iterator it;
+		};
+		static_assert(std::is_trivially_copyable_v<Cursor> && std::is_trivially_destructible_v<Cursor>,
+			"Lua never runs destructors of userdata");
+		void* state = PushLuaArrayView(L, store.size(), sizeof(Cursor), [](lua_State* L, void* state, size_t index) {
+			auto& cursor = *static_cast<Cursor*>(state);
+			if (cursor.it.index() + 1 == index) ++cursor.it;
+			else if (cursor.it.index() != index) cursor.it = cursor.store->At(index);
+			PushLuaRecordCopy<typename Store::value_type, Fields>(L, *cursor.it);
+			});
+		::new (state) Cursor{ &store, store.begin() };
+	}
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_LUA_VIEWS_HPP
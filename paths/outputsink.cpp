@@ -0,0 +1,143 @@
+﻿#include "outputsink.hpp"
+
+#include <algorithm>
+
+#include "base/error.hpp"
+
+namespace HsBa::Slicer
+{
+	FileSink::FileSink(const std::filesystem::path& path, bool asyncWrites, size_t bufferBytes)
+		: capacity_{ std::max<size_t>(bufferBytes, 1) }, async_{ asyncWrites }
+	{
+		// whole buffers are handed over, a second copy in the stream would only cost time
+		file_.rdbuf()->pubsetbuf(nullptr, 0);
+		file_.open(path, std::ios::binary | std::ios::trunc);
+		if (!file_.is_open())
+		{
+			throw IOError("Failed to open output file: " + path.string());
+		}
+		buffer_.reserve(capacity_);
+		if (async_) spare_.reserve(capacity_);
+	}
+
+	FileSink::~FileSink()
+	{
+		try
+		{
+			if (file_.is_open()) Close();
+		}
+		catch (...)
+		{
+			// a background write may still reference spare_, wait for it regardless
+			if (pending_.valid()) pending_.wait();
+		}
+	}
+
+	void FileSink::Write(std::string_view data)
+	{
+		while (!data.empty())
+		{
+			const size_t n = std::min(data.size(), capacity_ - buffer_.size());
+			buffer_.append(data.substr(0, n));
+			data.remove_prefix(n);
+			if (buffer_.size() == capacity_) Submit();
+		}
+	}
+
+	void FileSink::Flush()
+	{
+		Submit();
+		Wait();
+		file_.flush();
+		if (!file_) throw IOError("Failed to write output file");
+	}
+
+	void FileSink::Close()
+	{
+		Flush();
+		file_.close();
+		if (!file_) throw IOError("Failed to close output file");
+	}
+
+	void FileSink::Submit()
+	{
+		if (buffer_.empty()) return;
+		if (!async_)
+		{
+			WriteOut(buffer_);
+			buffer_.clear();
+			return;
+		}
+		// the previous buffer must be on disk before its storage is reused
+		Wait();
+		std::swap(buffer_, spare_);
+		buffer_.clear();
+		pending_ = std::async(std::launch::async, [this]() { WriteOut(spare_); });
+	}
+
+	void FileSink::Wait()
+	{
+		if (pending_.valid()) pending_.get();
+	}
+
+	void FileSink::WriteOut(const std::string& buffer)
+	{
+		file_.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		if (!file_) throw IOError("Failed to write output file");
+	}
+
+	SinkStreamBuf::SinkStreamBuf(IOutputSink& sink, size_t bufferBytes)
+		: sink_{ sink }, buffer_(std::max<size_t>(bufferBytes, 1))
+	{
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+	}
+
+	SinkStreamBuf::~SinkStreamBuf()
+	{
+		try
+		{
+			Drain();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void SinkStreamBuf::Drain()
+	{
+		const auto n = static_cast<size_t>(pptr() - pbase());
+		// reset first, a throwing sink must not see the same bytes twice
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+		if (n != 0) sink_.Write({ buffer_.data(), n });
+	}
+
+	SinkStreamBuf::int_type SinkStreamBuf::overflow(int_type ch)
+	{
+		Drain();
+		if (!traits_type::eq_int_type(ch, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize SinkStreamBuf::xsputn(const char* s, std::streamsize count)
+	{
+		// large pieces skip the buffer
+		if (count >= static_cast<std::streamsize>(buffer_.size()))
+		{
+			Drain();
+			sink_.Write({ s, static_cast<size_t>(count) });
+			return count;
+		}
+		return std::streambuf::xsputn(s, count);
+	}
+
+	int SinkStreamBuf::sync()
+	{
+		Drain();
+		sink_.Flush();
+		return 0;
+	}
+} // namespace HsBa::Slicer
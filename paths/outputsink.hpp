@@ -0,0 +1,90 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_OUTPUT_SINK_HPP
+#define HSBA_SLICER_OUTPUT_SINK_HPP
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace HsBa::Slicer
+{
+	// destination of streamed program text, IPath::Stream writes into it chunk by chunk
+	class IOutputSink
+	{
+	public:
+		virtual ~IOutputSink() = default;
+		virtual void Write(std::string_view data) = 0;
+		virtual void Flush() {}
+	};
+
+	// appends to a string owned by the caller, ToString is built on it
+	class StringSink final : public IOutputSink
+	{
+	public:
+		explicit StringSink(std::string& out) : out_{ out } {}
+		void Write(std::string_view data) override
+		{
+			out_.append(data);
+		}
+	private:
+		std::string& out_;
+	};
+
+	// buffered file output, whole buffers go to an unbuffered file stream. With asyncWrites a
+	// full buffer is written on a background thread while the next one fills. Close() reports
+	// write errors as IOError, the destructor closes silently
+	class FileSink final : public IOutputSink
+	{
+	public:
+		static constexpr size_t DEFAULT_BUFFER_BYTES = size_t{ 1 } << 20;
+
+		explicit FileSink(const std::filesystem::path& path, bool asyncWrites = false,
+			size_t bufferBytes = DEFAULT_BUFFER_BYTES);
+		FileSink(const FileSink&) = delete;
+		FileSink& operator=(const FileSink&) = delete;
+		~FileSink() override;
+
+		void Write(std::string_view data) override;
+		// everything written so far has reached the file
+		void Flush() override;
+		void Close();
+	private:
+		void Submit();
+		void Wait();
+		void WriteOut(const std::string& buffer);
+
+		std::ofstream file_;
+		std::string buffer_;
+		// buffer being written by the background thread
+		std::string spare_;
+		std::future<void> pending_;
+		size_t capacity_;
+		bool async_;
+	};
+
+	// std::ostream adapter for code that formats through streams. Enable badbit exceptions
+	// on the stream to get the sink's own errors instead of a failed stream
+	class SinkStreamBuf final : public std::streambuf
+	{
+	public:
+		static constexpr size_t DEFAULT_BUFFER_BYTES = size_t{ 1 } << 16;
+
+		explicit SinkStreamBuf(IOutputSink& sink, size_t bufferBytes = DEFAULT_BUFFER_BYTES);
+		~SinkStreamBuf() override;
+	protected:
+		int_type overflow(int_type ch) override;
+		std::streamsize xsputn(const char* s, std::streamsize count) override;
+		int sync() override;
+	private:
+		void Drain();
+
+		IOutputSink& sink_;
+		std::vector<char> buffer_;
+	};
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_OUTPUT_SINK_HPP
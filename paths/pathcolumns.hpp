@@ -0,0 +1,193 @@
+﻿#pragma once
+#ifndef HSBA_SLICER_PATH_COLUMNS_HPP
+#define HSBA_SLICER_PATH_COLUMNS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace HsBa::Slicer
+{
+	// Building blocks of the column stores of PointsPath and RobotPath. A move is a tag byte
+	// plus the changes of its coordinates in a byte stream; what rarely changes is kept once per
+	// run, and the tag picks the move type and speed from a palette
+
+	// moves between the checkpoints of a store, a random access read scans at most this many
+	constexpr size_t PATH_STORE_CHECKPOINT = 256;
+
+	// appends value - previous as a zigzag varint. U is the unsigned bit pattern of a float or
+	// double; the difference wraps, so every pattern comes back, and the nearby values of a path
+	// take 2 to 4 bytes instead of the 4 or 8 of the value
+	template <typename U>
+	void PutDelta(std::vector<uint8_t>& bytes, U previous, U value)
+	{
+		static_assert(std::is_unsigned_v<U>);
+		const U delta = static_cast<U>(value - previous);
+		// sign to the lowest bit, small negative changes stay short
+		U zigzag = static_cast<U>(delta << 1) ^ static_cast<U>(0 - (delta >> (std::numeric_limits<U>::digits - 1)));
+		while (zigzag >= 0x80)
+		{
+			bytes.push_back(static_cast<uint8_t>(zigzag | 0x80));
+			zigzag >>= 7;
+		}
+		bytes.push_back(static_cast<uint8_t>(zigzag));
+	}
+
+	// reads a change written by PutDelta at pos, moves pos past it and applies it to value
+	template <typename U>
+	void GetDelta(const std::vector<uint8_t>& bytes, size_t& pos, U& value)
+	{
+		U zigzag = 0;
+		for (int shift = 0;; shift += 7)
+		{
+			const uint8_t byte = bytes[pos++];
+			zigzag |= static_cast<U>(byte & 0x7f) << shift;
+			if (byte < 0x80) break;
+		}
+		value += static_cast<U>(zigzag >> 1) ^ static_cast<U>(0 - (zigzag & 1));
+	}
+
+	// values that change rarely, e.g. the height or the program index, stored once per run
+	template <typename T>
+	class RunColumn
+	{
+	public:
+		// value of move index, moves are appended in order
+		void push_back(size_t index, const T& value)
+		{
+			if (values_.empty() || !(values_.back() == value))
+			{
+				starts_.push_back(index);
+				values_.push_back(value);
+			}
+		}
+		// run holding move index, 0 for moves before the first run
+		size_t RunOf(size_t index) const
+		{
+			const auto it = std::upper_bound(starts_.begin(), starts_.end(), index);
+			return it == starts_.begin() ? 0 : static_cast<size_t>(it - starts_.begin()) - 1;
+		}
+		// first move of the run after run
+		size_t NextStart(size_t run) const
+		{
+			return run + 1 < starts_.size() ? starts_[run + 1] : std::numeric_limits<size_t>::max();
+		}
+		const T& operator[](size_t run) const
+		{
+			return values_[run];
+		}
+		bool empty() const noexcept
+		{
+			return values_.empty();
+		}
+		void clear()
+		{
+			starts_.clear();
+			values_.clear();
+		}
+		size_t MemoryBytes() const noexcept
+		{
+			return starts_.capacity() * sizeof(size_t) + values_.capacity() * sizeof(T);
+		}
+	private:
+		std::vector<size_t> starts_;
+		std::vector<T> values_;
+	};
+
+	// distinct small records, a tag byte per move selects one
+	template <typename T>
+	class Palette
+	{
+	public:
+		// tags from CAPACITY on are left to the store
+		static constexpr uint8_t CAPACITY = 254;
+
+		// tag of value, CAPACITY once the palette is full and value is not in it
+		uint8_t Find(const T& value)
+		{
+			if (last_ < entries_.size() && entries_[last_] == value) return last_;
+			for (size_t i = 0; i < entries_.size(); ++i)
+			{
+				if (entries_[i] == value)
+				{
+					last_ = static_cast<uint8_t>(i);
+					return last_;
+				}
+			}
+			if (entries_.size() == CAPACITY) return CAPACITY;
+			entries_.push_back(value);
+			last_ = static_cast<uint8_t>(entries_.size() - 1);
+			return last_;
+		}
+		const T& operator[](uint8_t tag) const
+		{
+			return entries_[tag];
+		}
+		void clear()
+		{
+			entries_.clear();
+			last_ = 0;
+		}
+		size_t MemoryBytes() const noexcept
+		{
+			return entries_.capacity() * sizeof(T);
+		}
+	private:
+		std::vector<T> entries_;
+		uint8_t last_ = 0;
+	};
+
+	// forward iterator of a store, dereferencing makes the point, so it returns it by value.
+	// The store keeps the read position in a Cursor and provides Get and Advance for it
+	template <typename Store>
+	class PathStoreIterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using iterator_concept = std::forward_iterator_tag;
+		using value_type = typename Store::value_type;
+		using difference_type = std::ptrdiff_t;
+		using reference = value_type;
+		using pointer = void;
+
+		PathStoreIterator() = default;
+
+		value_type operator*() const
+		{
+			return store_->Get(cursor_);
+		}
+		PathStoreIterator& operator++()
+		{
+			store_->Advance(cursor_);
+			return *this;
+		}
+		PathStoreIterator operator++(int)
+		{
+			auto copy = *this;
+			++*this;
+			return copy;
+		}
+		size_t index() const noexcept
+		{
+			return cursor_.index;
+		}
+		friend bool operator==(const PathStoreIterator& a, const PathStoreIterator& b) noexcept
+		{
+			return a.cursor_.index == b.cursor_.index;
+		}
+	private:
+		friend Store;
+		PathStoreIterator(const Store* store, const typename Store::Cursor& cursor)
+			: store_{ store }, cursor_{ cursor }
+		{ }
+
+		const Store* store_ = nullptr;
+		typename Store::Cursor cursor_{};
+	};
+} // namespace HsBa::Slicer
+
+#endif // !HSBA_SLICER_PATH_COLUMNS_HPP
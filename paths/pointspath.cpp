@@ -1,17 +1,26 @@
 ﻿#include "pointspath.hpp"
+#include "gcodewriter.hpp"
+#include "outputsink.hpp"
+#include "binarygcode.hpp"
+#include "luaviews.hpp"
 
 #include <ranges>
 #include <format>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
-#include <iomanip>
 #include <string>
+#include <cmath>
+#include <future>
+#include <algorithm>
+#include <exception>
+#include <bit>
 
 #include <lua.hpp>
 #include "utils/LuaNewObject.hpp"
 
 #include "base/error.hpp"
+#include "base/thread_pool.hpp"
 
 namespace HsBa::Slicer
 {
@@ -34,6 +43,321 @@ namespace HsBa::Slicer
 			default: return "G";
 		}
 	}
+
+	bool Vec3Field(lua_State* L, const OutPoints3& p, std::string_view key)
+	{
+		if (key == "x") lua_pushnumber(L, p.x);
+		else if (key == "y") lua_pushnumber(L, p.y);
+		else if (key == "z") lua_pushnumber(L, p.z);
+		else return false;
+		return true;
+	}
+
+	bool GPointField(lua_State* L, const GPoint& pt, std::string_view key)
+	{
+		if (key == "type") lua_pushstring(L, GcodeTypeToString(pt.type));
+		else if (key == "p1") PushLuaRecordCopy<OutPoints3, Vec3Field>(L, pt.p1);
+		else if (key == "center") PushLuaRecordCopy<OutPoints3, Vec3Field>(L, pt.center);
+		else if (key == "velocity") lua_pushnumber(L, pt.velocity);
+		else if (key == "extrusion") lua_pushnumber(L, pt.extrusion);
+		else return false;
+		return true;
+	}
+	}
+
+	namespace {
+	// moves per parallel formatting task, a task ends at the next height change after this
+	constexpr size_t FORMAT_CHUNK_MOVES = size_t{ 1 } << 14;
+	constexpr size_t MAX_FORMAT_CHUNK_MOVES = 4 * FORMAT_CHUNK_MOVES;
+	// formatted chunks kept per thread before the oldest must be written out
+	constexpr size_t FORMAT_CHUNKS_PER_THREAD = 2;
+
+	// arcs close to a full turn are ambiguous for controllers, stop before
+	constexpr double MAX_ARC_SWEEP = 1.9 * 3.14159265358979323846;
+
+	struct Circle
+	{
+		double cx, cy, r;
+	};
+
+	std::optional<Circle> CircleThrough(const OutPoints3& a, const OutPoints3& b, const OutPoints3& c)
+	{
+		const double bx = b.x - a.x, by = b.y - a.y, cx = c.x - a.x, cy = c.y - a.y;
+		const double d = 2.0 * (bx * cy - by * cx);
+		if (std::abs(d) < 1e-12) return std::nullopt;
+		const double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+		const double ux = (cy * b2 - by * c2) / d, uy = (bx * c2 - cx * b2) / d;
+		return Circle{ a.x + ux, a.y + uy, std::hypot(ux, uy) };
+	}
+
+	bool Linear(const GPoint& move)
+	{
+		return move.type == GcodeType::G1;
+	}
+
+	// moves[first, last] on one arc starting at from, within tolerance and turning one way;
+	// returns the direction (+1 counter-clockwise) or 0
+	int CheckArc(const OutPoints3& from, std::span<const GPoint> moves, size_t first, size_t last,
+		const ArcFitOptions& options, Circle& circle)
+	{
+		auto fitted = CircleThrough(from, moves[first + (last - first) / 2].p1, moves[last].p1);
+		if (!fitted || fitted->r < options.minRadius || fitted->r > options.maxRadius) return 0;
+		circle = *fitted;
+		int direction = 0;
+		double sweep = 0;
+		OutPoints3 prev = from;
+		for (size_t i = first; i <= last; ++i)
+		{
+			const auto& p = moves[i].p1;
+			const double ax = prev.x - circle.cx, ay = prev.y - circle.cy;
+			const double bx = p.x - circle.cx, by = p.y - circle.cy;
+			const double turn = std::atan2(ax * by - ay * bx, ax * bx + ay * by);
+			const int dir = turn > 0 ? 1 : (turn < 0 ? -1 : 0);
+			if (dir == 0 || (direction != 0 && dir != direction)) return 0;
+			direction = dir;
+			sweep += std::abs(turn);
+			if (sweep > MAX_ARC_SWEEP) return 0;
+			// the vertex and the segment midpoint must both stay close to the circle
+			const double mx = (prev.x + p.x) * 0.5 - circle.cx, my = (prev.y + p.y) * 0.5 - circle.cy;
+			if (std::abs(std::hypot(bx, by) - circle.r) > options.tolerance ||
+				std::abs(std::hypot(mx, my) - circle.r) > options.tolerance)
+				return 0;
+			prev = p;
+		}
+		return direction;
+	}
+	}
+
+	std::vector<GPoint> FitArcs(const OutPoints3& start, std::span<const GPoint> moves,
+		const ArcFitOptions& options, ArcFitStats* stats, double startExtrusion)
+	{
+		const size_t minMoves = std::max<size_t>(options.minMoves, 2);
+		std::vector<GPoint> res;
+		res.reserve(moves.size());
+		ArcFitStats local;
+		OutPoints3 from = start;
+		size_t i = 0;
+		while (i < moves.size())
+		{
+			const auto& first = moves[i];
+			// candidate run: consecutive G1 moves at the start height with the same feed that all
+			// extrude or all travel
+			auto extruding = [&](size_t k) {
+				const double before = options.relativeExtrusion ? 0.0 : k == 0 ? startExtrusion : moves[k - 1].extrusion;
+				return moves[k].extrusion > before;
+				};
+			const bool firstExtruding = extruding(i);
+			size_t runEnd = i;
+			while (runEnd < moves.size() && Linear(moves[runEnd]) && moves[runEnd].p1.z == from.z &&
+				moves[runEnd].velocity == first.velocity && extruding(runEnd) == firstExtruding)
+				++runEnd;
+			size_t best = 0;
+			Circle circle{};
+			int direction = 0;
+			if (runEnd - i >= minMoves)
+			{
+				// gallop then bisect on the run length, longer runs are tried first
+				Circle c{};
+				size_t good = 0, bad = runEnd - i + 1;
+				size_t len = minMoves;
+				while (len < bad)
+				{
+					if (int dir = CheckArc(from, moves, i, i + len - 1, options, c); dir != 0)
+					{
+						good = len; circle = c; direction = dir;
+						len = std::min(len * 2, bad - 1);
+						if (len == good) break;
+					}
+					else
+					{
+						bad = len;
+						break;
+					}
+				}
+				while (good != 0 && bad - good > 1)
+				{
+					size_t mid = good + (bad - good) / 2;
+					if (int dir = CheckArc(from, moves, i, i + mid - 1, options, c); dir != 0)
+					{
+						good = mid; circle = c; direction = dir;
+					}
+					else bad = mid;
+				}
+				best = good;
+			}
+			if (best == 0)
+			{
+				res.push_back(first);
+				from = first.p1;
+				++i;
+				continue;
+			}
+			const auto& last = moves[i + best - 1];
+			GPoint arc = last;
+			arc.type = direction > 0 ? GcodeType::G3 : GcodeType::G2;
+			arc.center = OutPoints3{ static_cast<float>(circle.cx - from.x), static_cast<float>(circle.cy - from.y), 0.0f };
+			if (options.relativeExtrusion)
+			{
+				arc.extrusion = 0.0;
+				for (size_t k = i; k < i + best; ++k) arc.extrusion += moves[k].extrusion;
+			}
+			res.push_back(arc);
+			++local.arcs;
+			from = last.p1;
+			i += best;
+		}
+		local.movesIn = moves.size();
+		local.movesOut = res.size();
+		if (stats) *stats += local;
+		return res;
+	}
+
+	namespace {
+	bool IsZero(const OutPoints3& p)
+	{
+		return std::bit_cast<uint32_t>(p.x) == 0 && std::bit_cast<uint32_t>(p.y) == 0 && std::bit_cast<uint32_t>(p.z) == 0;
+	}
+	}
+
+	bool GPointStore::Style::operator==(const Style& other) const noexcept
+	{
+		// bitwise, so -0 and NaN speeds come back as they went in
+		return type == other.type && center == other.center &&
+			std::bit_cast<uint32_t>(velocity) == std::bit_cast<uint32_t>(other.velocity);
+	}
+
+	void GPointStore::push_back(const GPoint& point)
+	{
+		const size_t index = tags_.size();
+		if (index % PATH_STORE_CHECKPOINT == 0)
+			checkpoints_.push_back(Checkpoint{ deltas_.size(), lastX_, lastY_, lastExtrusion_, centers_.size(), wide_.size() });
+
+		const bool arc = point.type == GcodeType::G2 || point.type == GcodeType::G3;
+		const Style style{ point.type, point.velocity, arc || !IsZero(point.center) };
+		const uint8_t tag = styles_.Find(style);
+		if (tag == WIDE) wide_.push_back(style);
+		tags_.push_back(tag);
+
+		const uint32_t x = std::bit_cast<uint32_t>(point.p1.x);
+		const uint32_t y = std::bit_cast<uint32_t>(point.p1.y);
+		const uint64_t extrusion = std::bit_cast<uint64_t>(point.extrusion);
+		PutDelta(deltas_, lastX_, x);
+		PutDelta(deltas_, lastY_, y);
+		PutDelta(deltas_, lastExtrusion_, extrusion);
+		lastX_ = x;
+		lastY_ = y;
+		lastExtrusion_ = extrusion;
+		z_.push_back(index, std::bit_cast<uint32_t>(point.p1.z));
+		if (style.center) centers_.push_back(point.center);
+	}
+
+	void GPointStore::reserve(size_t moves)
+	{
+		tags_.reserve(moves);
+		// x and y take about 3 bytes each on print paths, extrusion about 5
+		deltas_.reserve(moves * 11);
+		checkpoints_.reserve(moves / PATH_STORE_CHECKPOINT + 1);
+	}
+
+	void GPointStore::shrink_to_fit()
+	{
+		tags_.shrink_to_fit();
+		deltas_.shrink_to_fit();
+		centers_.shrink_to_fit();
+		checkpoints_.shrink_to_fit();
+	}
+
+	void GPointStore::clear()
+	{
+		*this = GPointStore{};
+	}
+
+	GPoint GPointStore::operator[](size_t i) const
+	{
+		return Get(Seek(i));
+	}
+
+	GPointStore::const_iterator GPointStore::begin() const
+	{
+		return At(0);
+	}
+
+	GPointStore::const_iterator GPointStore::end() const
+	{
+		Cursor cursor;
+		cursor.index = size();
+		return const_iterator(this, cursor);
+	}
+
+	GPointStore::const_iterator GPointStore::At(size_t i) const
+	{
+		if (i >= size()) return end();
+		return const_iterator(this, Seek(i));
+	}
+
+	size_t GPointStore::MemoryBytes() const noexcept
+	{
+		return tags_.capacity() * sizeof(uint8_t) + deltas_.capacity() * sizeof(uint8_t) + z_.MemoryBytes() +
+			styles_.MemoryBytes() + wide_.capacity() * sizeof(Style) + centers_.capacity() * sizeof(OutPoints3) +
+			checkpoints_.capacity() * sizeof(Checkpoint);
+	}
+
+	GPointStore::Cursor GPointStore::Seek(size_t i) const
+	{
+		const Checkpoint& checkpoint = checkpoints_[i / PATH_STORE_CHECKPOINT];
+		Cursor cursor;
+		cursor.index = i - i % PATH_STORE_CHECKPOINT;
+		cursor.center = checkpoint.centers;
+		cursor.wide = checkpoint.wide;
+		cursor.offset = checkpoint.offset;
+		cursor.x = checkpoint.x;
+		cursor.y = checkpoint.y;
+		cursor.extrusion = checkpoint.extrusion;
+		Decode(cursor);
+		while (cursor.index < i)
+		{
+			const uint8_t tag = tags_[cursor.index];
+			if (StyleOf(tag, cursor).center) ++cursor.center;
+			if (tag == WIDE) ++cursor.wide;
+			++cursor.index;
+			Decode(cursor);
+		}
+		cursor.zRun = z_.RunOf(i);
+		return cursor;
+	}
+
+	void GPointStore::Advance(Cursor& cursor) const
+	{
+		const uint8_t tag = tags_[cursor.index];
+		if (StyleOf(tag, cursor).center) ++cursor.center;
+		if (tag == WIDE) ++cursor.wide;
+		if (++cursor.index >= size()) return;
+		Decode(cursor);
+		if (cursor.index >= z_.NextStart(cursor.zRun)) ++cursor.zRun;
+	}
+
+	void GPointStore::Decode(Cursor& cursor) const
+	{
+		GetDelta(deltas_, cursor.offset, cursor.x);
+		GetDelta(deltas_, cursor.offset, cursor.y);
+		GetDelta(deltas_, cursor.offset, cursor.extrusion);
+	}
+
+	GPoint GPointStore::Get(const Cursor& cursor) const
+	{
+		const Style& style = StyleOf(tags_[cursor.index], cursor);
+		GPoint point;
+		point.type = style.type;
+		point.p1 = { std::bit_cast<float>(cursor.x), std::bit_cast<float>(cursor.y), std::bit_cast<float>(z_[cursor.zRun]) };
+		if (style.center) point.center = centers_[cursor.center];
+		point.velocity = style.velocity;
+		point.extrusion = std::bit_cast<double>(cursor.extrusion);
+		return point;
+	}
+
+	const GPointStore::Style& GPointStore::StyleOf(uint8_t tag, const Cursor& cursor) const
+	{
+		return tag == WIDE ? wide_[cursor.wide] : styles_[tag];
 	}
 
 	PointsPath::PointsPath(GCodeUnits units , OutPoints3 p) :
@@ -42,58 +366,153 @@ namespace HsBa::Slicer
 
 	void PointsPath::push_back(const GPoint& point)
 	{
-		points_.emplace_back(point);
+		points_.push_back(point);
 	}
 
 
-	std::string PointsPath::ToString() const
+	void PointsPath::FitArcs(const ArcFitOptions& options, ThreadPool* pool, ArcFitStats* stats)
 	{
-		std::ostringstream ss;
-		ss << std::fixed << std::setprecision(4);
-		// Units header
-		if (units_ == GCodeUnits::mm)
-			ss << "G21 ; units mm\n";
-		else
-			ss << "G20 ; units inch\n";
-		// Start absolute positioning
-		ss << "G90\n";
-		// start point move
-		ss << "G0 X" << startPoint_.x << " Y" << startPoint_.y << " Z" << startPoint_.z << "\n";
-
-		for (const auto& pt : points_)
+		// layers start where the height changes, each keeps the position and absolute E it starts from
+		std::vector<size_t> bounds{ 0 };
+		std::vector<OutPoints3> from{ startPoint_ };
+		std::vector<double> fromExtrusion{ 0.0 };
+		GPoint previous;
+		for (auto it = points_.begin(); it != points_.end(); ++it)
 		{
-			if(pt.type == GcodeType::G0 || pt.type == GcodeType::G1)
+			const GPoint point = *it;
+			if (it.index() > 0 && point.p1.z != previous.p1.z)
 			{
-				auto code = GcodeTypeToString(pt.type);
-				ss << code;
-				// For linear moves include XYZ, feed and extrusion
-				ss << " ";
-				ss << "X" << pt.p1.x << " Y" << pt.p1.y << " Z" << pt.p1.z;
-				if (pt.velocity > 0.0f)
-					ss << " F" << pt.velocity;
-				ss << " E" << std::setprecision(6) << pt.extrusion << std::setprecision(4);
-				ss << "\n";
+				bounds.push_back(it.index());
+				from.push_back(previous.p1);
+				fromExtrusion.push_back(previous.extrusion);
 			}
-			else if (pt.type == GcodeType::G2 || pt.type == GcodeType::G3)
+			previous = point;
+		}
+		bounds.push_back(points_.size());
+		const size_t layers = bounds.size() - 1;
+		std::vector<std::vector<GPoint>> fitted(layers);
+		std::vector<ArcFitStats> layerStats(layers);
+		auto fitLayer = [&](size_t l) {
+			// a layer is unpacked only while it is fitted
+			const std::vector<GPoint> layer(points_.At(bounds[l]), points_.At(bounds[l + 1]));
+			fitted[l] = Slicer::FitArcs(from[l], layer, options, &layerStats[l], fromExtrusion[l]);
+			};
+		if (pool == nullptr || layers < 2)
+		{
+			for (size_t l = 0; l < layers; ++l) fitLayer(l);
+		}
+		else
+		{
+			std::vector<std::future<void>> futures;
+			futures.reserve(layers);
+			for (size_t l = 0; l < layers; ++l)
+				futures.emplace_back(pool->submit(fitLayer, l));
+			std::exception_ptr error;
+			for (auto& f : futures)
 			{
-				auto code = GcodeTypeToString(pt.type);
-				ss << code;
-				// For arc moves include XYZ, IJK, feed and extrusion
-				ss << " ";
-				ss << "X" << pt.p1.x << " Y" << pt.p1.y << " Z" << pt.p1.z;
-				ss << " I" << pt.center.x << " J" << pt.center.y << " K" << pt.center.z;
-				if (pt.velocity > 0.0f)
-					ss << " F" << pt.velocity;
-				ss << " E" << std::setprecision(6) << pt.extrusion << std::setprecision(4);
-				ss << "\n";
+				try { f.get(); }
+				catch (...) { if (!error) error = std::current_exception(); }
 			}
-			else
+			if (error) std::rethrow_exception(error);
+		}
+		GPointStore merged;
+		size_t total = 0;
+		for (const auto& layer : fitted) total += layer.size();
+		merged.reserve(total);
+		for (auto& layer : fitted)
+		{
+			for (const auto& point : layer) merged.push_back(point);
+			std::vector<GPoint>().swap(layer);
+		}
+		points_ = std::move(merged);
+		if (stats)
+			for (const auto& s : layerStats) *stats += s;
+	}
+
+	void PointsPath::Write(GCodeWriter& writer) const
+	{
+		writer.Header(units_, startPoint_);
+		for (const auto& pt : points_)
+		{
+			writer.Move(pt);
+		}
+	}
+
+	void PointsPath::Stream(IOutputSink& sink) const
+	{
+		GCodeWriter writer(STREAM_CHUNK_BYTES + STREAM_CHUNK_BYTES / 8);
+		writer.Header(units_, startPoint_);
+		for (const auto& pt : points_)
+		{
+			writer.Move(pt);
+			if (writer.size() >= STREAM_CHUNK_BYTES)
 			{
-				continue;
+				sink.Write(writer.View());
+				writer.Clear();
 			}
 		}
+		if (!writer.empty()) sink.Write(writer.View());
+	}
+
+	void PointsPath::Stream(IOutputSink& sink, ThreadPool& pool) const
+	{
+		// chunks end where the height changes once they are long enough; lines don't depend on
+		// each other, so a single huge layer is cut anyway
+		std::vector<size_t> bounds{ 0 };
+		float previousZ = 0.0f;
+		for (auto it = points_.begin(); it != points_.end(); ++it)
+		{
+			const size_t i = it.index();
+			const float z = (*it).p1.z;
+			const size_t length = i - bounds.back();
+			if (i > 0 && ((length >= FORMAT_CHUNK_MOVES && z != previousZ) || length >= MAX_FORMAT_CHUNK_MOVES))
+				bounds.push_back(i);
+			previousZ = z;
+		}
+		bounds.push_back(points_.size());
+
+		GCodeWriter header;
+		header.Header(units_, startPoint_);
+		sink.Write(header.View());
 
-		return ss.str();
+		auto format = [this, &bounds](size_t chunk) {
+			GCodeWriter writer;
+			for (auto it = points_.At(bounds[chunk]), end = points_.At(bounds[chunk + 1]); it != end; ++it)
+			{
+				writer.Move(*it);
+			}
+			return writer.Take();
+			};
+		const size_t window = std::max<size_t>(2, FORMAT_CHUNKS_PER_THREAD * pool.ThreadCount());
+		// the tasks reference bounds, RunOrdered lets them finish before it goes away
+		RunOrdered(pool, bounds.size() - 1, window, format,
+			[&sink](size_t, const std::string& text) { sink.Write(text); });
+	}
+
+	void PointsPath::Save(const std::filesystem::path& path, ThreadPool& pool) const
+	{
+		FileSink sink(path, true);
+		Stream(sink, pool);
+		sink.Close();
+	}
+
+	void PointsPath::SaveBinary(const std::filesystem::path& path) const
+	{
+		SaveBinary(path, BinaryGCodeOptions{});
+	}
+
+	void PointsPath::SaveBinary(const std::filesystem::path& path, const BinaryGCodeOptions& options) const
+	{
+		FileSink sink(path, true);
+		WriteBinaryGCode(sink, units_, startPoint_, points_, options);
+		sink.Close();
+	}
+
+	std::string PointsPath::ToString() const
+	{
+		GCodeWriter writer;
+		Write(writer);
+		return writer.Take();
 	}
 
 	std::string PointsPath::ToString(std::string_view script,
@@ -105,43 +524,8 @@ namespace HsBa::Slicer
 		luaL_openlibs(L.get());
 		if (lua_reg) lua_reg(L.get());
 
-		// push points table
-		lua_newtable(L.get()); // points table at -1
-		int idx = 1;
-		for (const auto& pt : points_)
-		{
-			lua_newtable(L.get()); // point table
-			// type
-			lua_pushstring(L.get(), GcodeTypeToString(pt.type));
-			lua_setfield(L.get(), -2, "type");
-			// p1
-			lua_newtable(L.get());
-			lua_pushnumber(L.get(), pt.p1.x);
-			lua_setfield(L.get(), -2, "x");
-			lua_pushnumber(L.get(), pt.p1.y);
-			lua_setfield(L.get(), -2, "y");
-			lua_pushnumber(L.get(), pt.p1.z);
-			lua_setfield(L.get(), -2, "z");
-			lua_setfield(L.get(), -2, "p1");
-			// center
-			lua_newtable(L.get());
-			lua_pushnumber(L.get(), pt.center.x);
-			lua_setfield(L.get(), -2, "x");
-			lua_pushnumber(L.get(), pt.center.y);
-			lua_setfield(L.get(), -2, "y");
-			lua_pushnumber(L.get(), pt.center.z);
-			lua_setfield(L.get(), -2, "z");
-			lua_setfield(L.get(), -2, "center");
-			// velocity and extrusion
-			lua_pushnumber(L.get(), pt.velocity);
-			lua_setfield(L.get(), -2, "velocity");
-			lua_pushnumber(L.get(), pt.extrusion);
-			lua_setfield(L.get(), -2, "extrusion");
-
-			// set into points[idx]
-			lua_rawseti(L.get(), -2, idx);
-			++idx;
-		}
+		// points are read lazily through views, nothing is copied up front
+		PushLuaStoreView<GPointStore, GPointField>(L.get(), points_);
 		lua_setglobal(L.get(), "points");
 
 		// push startPoint
@@ -201,9 +585,9 @@ namespace HsBa::Slicer
 
 	void PointsPath::Save(const std::filesystem::path& p) const
 	{
-		auto txt = ToString();
-		std::ofstream ofs(p, std::ios::binary);
-		ofs << txt;
+		FileSink sink(p, true);
+		Stream(sink);
+		sink.Close();
 	}
 
 	void PointsPath::Save(const std::filesystem::path& p, std::string_view script,
@@ -221,43 +605,8 @@ namespace HsBa::Slicer
 		if (!L) throw RuntimeError("Lua init failed");
 		luaL_openlibs(L.get());
 		if (lua_reg) lua_reg(L.get());
-		// push points as global
-		lua_newtable(L.get());
-		int idx = 1;
-		for (const auto& pt : points_)
-		{
-			lua_newtable(L.get()); // point table
-			// type
-			lua_pushstring(L.get(), GcodeTypeToString(pt.type));
-			lua_setfield(L.get(), -2, "type");
-			// p1
-			lua_newtable(L.get());
-			lua_pushnumber(L.get(), pt.p1.x);
-			lua_setfield(L.get(), -2, "x");
-			lua_pushnumber(L.get(), pt.p1.y);
-			lua_setfield(L.get(), -2, "y");
-			lua_pushnumber(L.get(), pt.p1.z);
-			lua_setfield(L.get(), -2, "z");
-			lua_setfield(L.get(), -2, "p1");
-			// center
-			lua_newtable(L.get());
-			lua_pushnumber(L.get(), pt.center.x);
-			lua_setfield(L.get(), -2, "x");
-			lua_pushnumber(L.get(), pt.center.y);
-			lua_setfield(L.get(), -2, "y");
-			lua_pushnumber(L.get(), pt.center.z);
-			lua_setfield(L.get(), -2, "z");
-			lua_setfield(L.get(), -2, "center");
-			// velocity and extrusion
-			lua_pushnumber(L.get(), pt.velocity);
-			lua_setfield(L.get(), -2, "velocity");
-			lua_pushnumber(L.get(), pt.extrusion);
-			lua_setfield(L.get(), -2, "extrusion");
-
-			// set into points[idx]
-			lua_rawseti(L.get(), -2, idx);
-			++idx;
-		}
+		// push points as global, read lazily through views
+		PushLuaStoreView<GPointStore, GPointField>(L.get(), points_);
 		lua_setglobal(L.get(), "points");
 		// push startPoint
 		lua_newtable(L.get());
@@ -2,10 +2,13 @@
 #ifndef HSBA_SLICER_POINTS_PATH_HPP
 #define HSBA_SLICER_POINTS_PATH_HPP
 
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <vector>
 
 #include "IPath.hpp"
+#include "pathcolumns.hpp"
 
 namespace HsBa::Slicer
 {
@@ -13,6 +16,7 @@ namespace HsBa::Slicer
     constexpr int GCODE_G17_VALUE = 17;  // Select XY plane
     constexpr int GCODE_G90_VALUE = 90;  // Absolute positioning
     constexpr float DEFAULT_VELOCITY = 100.0f;  // Default velocity for GPoint
+    constexpr size_t STREAM_CHUNK_BYTES = size_t{ 1 } << 18;  // text handed to a sink at once
 	enum class GcodeType
 	{
 		G0,
@@ -38,20 +42,155 @@ namespace HsBa::Slicer
 	{
 		GcodeType type = GcodeType::G1;
 		OutPoints3 p1;
-		OutPoints3 center; // 圆弧运动的过渡点
+		OutPoints3 center; // 圆弧运动的圆心，相对起点的偏移，输出为I J K
 		float velocity = DEFAULT_VELOCITY;
 		double extrusion = 0.0;
 	};
 
+	class ThreadPool;
+	class GCodeWriter;
+	struct BinaryGCodeOptions;
+
+	// the moves of a PointsPath in columns, about a third of the memory of a GPoint vector.
+	// x, y and extrusion are kept as the changes of their bit patterns from the previous move
+	// (see PutDelta), so every value reads back exactly as it was pushed. Heights are stored
+	// once per change, centers only for moves that have one, and type and feed come from a
+	// palette. Reads return GPoint by value
+	class GPointStore
+	{
+	public:
+		using value_type = GPoint;
+		using const_iterator = PathStoreIterator<GPointStore>;
+
+		void push_back(const GPoint& point);
+		void reserve(size_t moves);
+		// gives back what reserve or growth left unused
+		void shrink_to_fit();
+		void clear();
+		size_t size() const noexcept
+		{
+			return tags_.size();
+		}
+		bool empty() const noexcept
+		{
+			return tags_.empty();
+		}
+		GPoint operator[](size_t i) const;
+		const_iterator begin() const;
+		const_iterator end() const;
+		// iterator to move i, found from the checkpoint before it
+		const_iterator At(size_t i) const;
+		// bytes held, capacity included
+		size_t MemoryBytes() const noexcept;
+	private:
+		friend const_iterator;
+		struct Style
+		{
+			GcodeType type;
+			float velocity;
+			// G2/G3, or a move with a center that isn't +0
+			bool center;
+			bool operator==(const Style& other) const noexcept;
+		};
+		// stream offset and values before every PATH_STORE_CHECKPOINT-th move
+		struct Checkpoint
+		{
+			size_t offset;
+			uint32_t x, y;
+			uint64_t extrusion;
+			size_t centers, wide;
+		};
+		struct Cursor
+		{
+			size_t index = 0;
+			size_t zRun = 0;
+			size_t center = 0, wide = 0;
+			// stream offset after the move at index
+			size_t offset = 0;
+			uint32_t x = 0, y = 0;
+			uint64_t extrusion = 0;
+		};
+		Cursor Seek(size_t i) const;
+		void Advance(Cursor& cursor) const;
+		// reads the move at cursor.index from the stream
+		void Decode(Cursor& cursor) const;
+		GPoint Get(const Cursor& cursor) const;
+		const Style& StyleOf(uint8_t tag, const Cursor& cursor) const;
+
+		static constexpr uint8_t WIDE = Palette<Style>::CAPACITY;
+
+		std::vector<uint8_t> tags_;
+		// x, y and extrusion changes of every move
+		std::vector<uint8_t> deltas_;
+		// bit patterns of the heights
+		RunColumn<uint32_t> z_;
+		Palette<Style> styles_;
+		std::vector<Style> wide_;
+		std::vector<OutPoints3> centers_;
+		std::vector<Checkpoint> checkpoints_;
+		uint32_t lastX_ = 0, lastY_ = 0;
+		uint64_t lastExtrusion_ = 0;
+	};
+
+	struct ArcFitOptions
+	{
+		// maximal distance of the replaced vertices and segment midpoints from the arc
+		double tolerance = 0.01;
+		double minRadius = 0.5;
+		double maxRadius = 1000.0;
+		// fewer consecutive G1 moves stay linear
+		size_t minMoves = 3;
+		// extrusion of a move is the amount of that move instead of the absolute E position
+		bool relativeExtrusion = false;
+	};
+
+	struct ArcFitStats
+	{
+		size_t movesIn = 0;
+		size_t movesOut = 0;
+		size_t arcs = 0;
+
+		ArcFitStats& operator+=(const ArcFitStats& other)
+		{
+			movesIn += other.movesIn;
+			movesOut += other.movesOut;
+			arcs += other.arcs;
+			return *this;
+		}
+	};
+
+	// replaces runs of G1 moves at the same height and feed that lie on a circle within the
+	// tolerance by G2/G3 arcs. start is the position before the first move and startExtrusion
+	// the absolute E there, unused with relative extrusion
+	std::vector<GPoint> FitArcs(const OutPoints3& start, std::span<const GPoint> moves,
+		const ArcFitOptions& options = {}, ArcFitStats* stats = nullptr, double startExtrusion = 0.0);
+
 	class PointsPath : public IPath
 	{
 	public:
 		PointsPath(GCodeUnits units = GCodeUnits::mm,OutPoints3 p = {0.0,0.0,0.0});
 		void push_back(const GPoint& point);
+		// arc fitting in place, every layer (run of moves at one height) is fitted on its own,
+		// concurrently when a pool is given
+		void FitArcs(const ArcFitOptions& options = {}, ThreadPool* pool = nullptr, ArcFitStats* stats = nullptr);
+		size_t size() const noexcept
+		{
+			return points_.size();
+		}
+		// appends the whole program, ToString and Save format through this
+		void Write(GCodeWriter& writer) const;
 		virtual ~PointsPath() = default;
+		virtual void Stream(IOutputSink& sink) const override;
+		// chunks of whole layers are formatted concurrently and written in order, the output
+		// is the same as the serial one. Only a few chunks per thread are held at a time
+		void Stream(IOutputSink& sink, ThreadPool& pool) const;
+		void Save(const std::filesystem::path& path, ThreadPool& pool) const;
 		virtual void Save(const std::filesystem::path&) const override;
 		virtual void Save(const std::filesystem::path&, std::string_view script,
 			const std::function<void(lua_State*)>& lua_reg = {}) const override;
+		// compact binary container with a layer table, see binarygcode.hpp
+		void SaveBinary(const std::filesystem::path& path) const;
+		void SaveBinary(const std::filesystem::path& path, const BinaryGCodeOptions& options) const;
 		virtual std::string ToString() const override;
 		virtual std::string ToString(std::string_view script,
 			const std::function<void(lua_State*)>& lua_reg = {}) const override;
@@ -68,7 +207,7 @@ namespace HsBa::Slicer
 			return points_[i];
 		}
 	private:
-		std::vector<GPoint> points_;
+		GPointStore points_;
 		OutPoints3 startPoint_;
 		GCodeUnits units_ = GCodeUnits::mm;
 	};
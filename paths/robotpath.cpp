@@ -1,15 +1,22 @@
 ﻿#include "robotpath.hpp"
+#include "outputsink.hpp"
 
 #include <sstream>
 #include <iomanip>
+#include <ostream>
 #include <string>
 #include <fstream>
 #include <format>
+#include <future>
+#include <exception>
+#include <algorithm>
+#include <bit>
 
 #include <lua.hpp>
 #include "utils/LuaNewObject.hpp"
 
 #include "base/error.hpp"
+#include "base/thread_pool.hpp"
 
 namespace HsBa::Slicer
 {
@@ -35,11 +42,192 @@ namespace {
         default: return "Unknown";
         }
     }
+
+	bool OpensSegment(RLPointType t)
+	{
+		return t == RLPointType::ProgramLStart || t == RLPointType::ProgramStart || t == RLPointType::ProgramCStart;
+	}
+
+	bool ClosesSegment(RLPointType t)
+	{
+		return t == RLPointType::ProgramLEnd || t == RLPointType::ProgramCEnd;
+	}
+
+	// index counts from 1
+	std::string ModuleName(RLType type, size_t index)
+	{
+		switch (type)
+		{
+		case RLType::Abb: return std::format("Part{}", index);
+		case RLType::Kuka: return std::format("part{}", index);
+		default: return std::format("PART{}", index);
+		}
+	}
+
+	std::string ModuleFileName(RLType type, std::string_view name)
+	{
+		switch (type)
+		{
+		case RLType::Abb: return std::format("{}.mod", name);
+		case RLType::Kuka: return std::format("{}.src", name);
+		default: return std::format("{}.ls", name);
+		}
+	}
+
+	bool IsZero(const OutPoints3& p)
+	{
+		return std::bit_cast<uint32_t>(p.x) == 0 && std::bit_cast<uint32_t>(p.y) == 0 && std::bit_cast<uint32_t>(p.z) == 0;
+	}
+
+	bool Circular(RLPointType t)
+	{
+		return t == RLPointType::MoveC || t == RLPointType::ProgramCStart || t == RLPointType::ProgramC ||
+			t == RLPointType::ProgramCEnd;
+	}
 }
 }
 
 namespace HsBa::Slicer
 {
+	bool RLPointStore::Style::operator==(const Style& other) const noexcept
+	{
+		return type == other.type && middle == other.middle &&
+			std::bit_cast<uint32_t>(velocity) == std::bit_cast<uint32_t>(other.velocity);
+	}
+
+	void RLPointStore::push_back(const RLPoint& point)
+	{
+		const size_t index = tags_.size();
+		if (index % PATH_STORE_CHECKPOINT == 0)
+			checkpoints_.push_back(Checkpoint{ deltas_.size(), lastX_, lastY_, lastZ_, middles_.size(), wide_.size() });
+
+		const Style style{ point.type, point.velocity, Circular(point.type) || !IsZero(point.middle) };
+		const uint8_t tag = styles_.Find(style);
+		if (tag == WIDE) wide_.push_back(style);
+		tags_.push_back(tag);
+
+		const uint32_t x = std::bit_cast<uint32_t>(point.end.x);
+		const uint32_t y = std::bit_cast<uint32_t>(point.end.y);
+		const uint32_t z = std::bit_cast<uint32_t>(point.end.z);
+		PutDelta(deltas_, lastX_, x);
+		PutDelta(deltas_, lastY_, y);
+		PutDelta(deltas_, lastZ_, z);
+		lastX_ = x;
+		lastY_ = y;
+		lastZ_ = z;
+		programs_.push_back(index, point.programIndex);
+		if (style.middle) middles_.push_back(point.middle);
+	}
+
+	void RLPointStore::reserve(size_t points)
+	{
+		tags_.reserve(points);
+		// about 3 bytes for x and y each, z rarely changes
+		deltas_.reserve(points * 7);
+		checkpoints_.reserve(points / PATH_STORE_CHECKPOINT + 1);
+	}
+
+	void RLPointStore::shrink_to_fit()
+	{
+		tags_.shrink_to_fit();
+		deltas_.shrink_to_fit();
+		middles_.shrink_to_fit();
+		checkpoints_.shrink_to_fit();
+	}
+
+	void RLPointStore::clear()
+	{
+		*this = RLPointStore{};
+	}
+
+	RLPoint RLPointStore::operator[](size_t i) const
+	{
+		return Get(Seek(i));
+	}
+
+	RLPointStore::const_iterator RLPointStore::begin() const
+	{
+		return At(0);
+	}
+
+	RLPointStore::const_iterator RLPointStore::end() const
+	{
+		Cursor cursor;
+		cursor.index = size();
+		return const_iterator(this, cursor);
+	}
+
+	RLPointStore::const_iterator RLPointStore::At(size_t i) const
+	{
+		if (i >= size()) return end();
+		return const_iterator(this, Seek(i));
+	}
+
+	size_t RLPointStore::MemoryBytes() const noexcept
+	{
+		return tags_.capacity() * sizeof(uint8_t) + deltas_.capacity() * sizeof(uint8_t) + programs_.MemoryBytes() +
+			styles_.MemoryBytes() + wide_.capacity() * sizeof(Style) + middles_.capacity() * sizeof(OutPoints3) +
+			checkpoints_.capacity() * sizeof(Checkpoint);
+	}
+
+	RLPointStore::Cursor RLPointStore::Seek(size_t i) const
+	{
+		const Checkpoint& checkpoint = checkpoints_[i / PATH_STORE_CHECKPOINT];
+		Cursor cursor;
+		cursor.index = i - i % PATH_STORE_CHECKPOINT;
+		cursor.middle = checkpoint.middles;
+		cursor.wide = checkpoint.wide;
+		cursor.offset = checkpoint.offset;
+		cursor.x = checkpoint.x;
+		cursor.y = checkpoint.y;
+		cursor.z = checkpoint.z;
+		Decode(cursor);
+		while (cursor.index < i)
+		{
+			const uint8_t tag = tags_[cursor.index];
+			if (StyleOf(tag, cursor).middle) ++cursor.middle;
+			if (tag == WIDE) ++cursor.wide;
+			++cursor.index;
+			Decode(cursor);
+		}
+		cursor.programRun = programs_.RunOf(i);
+		return cursor;
+	}
+
+	void RLPointStore::Advance(Cursor& cursor) const
+	{
+		const uint8_t tag = tags_[cursor.index];
+		if (StyleOf(tag, cursor).middle) ++cursor.middle;
+		if (tag == WIDE) ++cursor.wide;
+		if (++cursor.index >= size()) return;
+		Decode(cursor);
+		if (cursor.index >= programs_.NextStart(cursor.programRun)) ++cursor.programRun;
+	}
+
+	void RLPointStore::Decode(Cursor& cursor) const
+	{
+		GetDelta(deltas_, cursor.offset, cursor.x);
+		GetDelta(deltas_, cursor.offset, cursor.y);
+		GetDelta(deltas_, cursor.offset, cursor.z);
+	}
+
+	RLPoint RLPointStore::Get(const Cursor& cursor) const
+	{
+		const Style& style = StyleOf(tags_[cursor.index], cursor);
+		RLPoint point;
+		point.type = style.type;
+		point.end = { std::bit_cast<float>(cursor.x), std::bit_cast<float>(cursor.y), std::bit_cast<float>(cursor.z) };
+		if (style.middle) point.middle = middles_[cursor.middle];
+		point.velocity = style.velocity;
+		point.programIndex = programs_[cursor.programRun];
+		return point;
+	}
+
+	const RLPointStore::Style& RLPointStore::StyleOf(uint8_t tag, const Cursor& cursor) const
+	{
+		return tag == WIDE ? wide_[cursor.wide] : styles_[tag];
+	}
+
 	RobotPath::RobotPath(RLType robotType, OutPoints3 startPoint, std::string startProgramFunc, std::string endProgramFunc) 
 		: robotType_{robotType}, points_{}, startPoint_{startPoint}, startProgramFunc_{startProgramFunc}, endProgramFunc_{endProgramFunc}
 	{
@@ -47,7 +235,7 @@ namespace HsBa::Slicer
 
 	void RobotPath::push_back(const RLPoint& point)
 	{
-		points_.emplace_back(point);
+		points_.push_back(point);
 	}
 
 	RLType RobotPath::getRobotType() const
@@ -57,9 +245,11 @@ namespace HsBa::Slicer
 
 	void RobotPath::Save(const std::filesystem::path& p) const
 	{
-		auto txt = ToString();
-		std::ofstream ofs(p, std::ios::binary);
-		ofs << txt;
+		if (robotType_ != RLType::Abb && robotType_ != RLType::Kuka && robotType_ != RLType::Fanuc)
+			throw NotSupportedError("Not support robot, please use lua script");
+		FileSink sink(p, true);
+		Stream(sink);
+		sink.Close();
 	}
 
 	void RobotPath::Save(const std::filesystem::path& p, std::string_view script,
@@ -70,28 +260,194 @@ namespace HsBa::Slicer
 		ofs << txt;
 	}
 
-	std::string RobotPath::ToString() const
+	void RobotPath::Stream(IOutputSink& sink) const
 	{
-		std::ostringstream ss;
+		if (robotType_ != RLType::Abb && robotType_ != RLType::Kuka && robotType_ != RLType::Fanuc)
+			throw NotSupportedError("Not support robot, please use lua script");
+		SinkStreamBuf buf(sink);
+		std::ostream ss(&buf);
+		ss.exceptions(std::ios::badbit);
 		ss << "# RobotPath default export\n";
 		switch (robotType_)
 		{
 		case RLType::Abb:
 			ss << "! Robot: ABB\n";
-			ss << GenerateAbbCode();
+			GenerateAbbCode(ss);
 			break;
 		case RLType::Kuka:
 			ss << "# Robot: KUKA\n";
-			ss << GenerateKukaCode();
+			GenerateKukaCode(ss);
 			break;
-		case RLType::Fanuc:
+		default:
 			ss << "# Robot: FANUC\n";
-			ss << GenerateFanucCode();
+			GenerateFanucCode(ss);
 			break;
-		default:
+		}
+		ss.flush();
+	}
+
+	std::vector<std::pair<size_t, size_t>> RobotPath::ModuleRanges(size_t movesPerModule) const
+	{
+		const size_t limit = std::max<size_t>(movesPerModule, 1);
+		std::vector<std::pair<size_t, size_t>> ranges;
+		size_t first = 0;
+		bool inSegment = false;
+		while (first < points_.size())
+		{
+			const size_t hardEnd = std::min(first + limit, points_.size());
+			// last place in the second half of the module where no program segment is open
+			size_t cut = 0;
+			bool open = inSegment;
+			for (auto it = points_.At(first), end = points_.At(hardEnd); it != end; ++it)
+			{
+				const RLPointType type = (*it).type;
+				if (OpensSegment(type)) open = true;
+				else if (ClosesSegment(type)) open = false;
+				if (!open && (it.index() + 1 - first) * 2 > limit) cut = it.index() + 1;
+			}
+			if (hardEnd == points_.size() || cut == 0)
+			{
+				cut = hardEnd;
+				inSegment = open;
+			}
+			else
+			{
+				inSegment = false;
+			}
+			ranges.emplace_back(first, cut);
+			first = cut;
+		}
+		return ranges;
+	}
+
+	void RobotPath::WriteModule(const std::filesystem::path& file, size_t index, size_t first, size_t last) const
+	{
+		FileSink sink(file);
+		{
+			SinkStreamBuf buf(sink);
+			std::ostream ss(&buf);
+			ss.exceptions(std::ios::badbit);
+			const auto name = ModuleName(robotType_, index);
+			switch (robotType_)
+			{
+			case RLType::Abb:
+				ss << "MODULE " << name << "\n";
+				ss << "  PROC " << name << "()\n";
+				ss << std::fixed << std::setprecision(4);
+				WriteAbbMoves(ss, first, last);
+				ss << "  ENDPROC\n";
+				ss << "ENDMODULE\n";
+				break;
+			case RLType::Kuka:
+				ss << "DEF " << name << "()\n";
+				WriteKukaMoves(ss, first, last);
+				ss << "END\n";
+				break;
+			default:
+				ss << "; " << name << "\n";
+				WriteFanucMoves(ss, first, last);
+				break;
+			}
+			ss.flush();
+		}
+		sink.Close();
+	}
+
+	std::vector<std::filesystem::path> RobotPath::SaveModules(const std::filesystem::path& dir,
+		const RobotModuleOptions& options, ThreadPool* pool) const
+	{
+		if (robotType_ != RLType::Abb && robotType_ != RLType::Kuka && robotType_ != RLType::Fanuc)
 			throw NotSupportedError("Not support robot, please use lua script");
+		std::filesystem::create_directories(dir);
+		const auto ranges = ModuleRanges(options.movesPerModule);
+
+		std::vector<std::filesystem::path> files;
+		files.reserve(ranges.size() + 1);
+		const char* mainName = robotType_ == RLType::Abb ? "mainModule" : robotType_ == RLType::Kuka ? "main" : "MAIN";
+		files.push_back(dir / ModuleFileName(robotType_, mainName));
+		for (size_t m = 0; m < ranges.size(); ++m)
+			files.push_back(dir / ModuleFileName(robotType_, ModuleName(robotType_, m + 1)));
+
+		auto writeModule = [&](size_t m) {
+			WriteModule(files[m + 1], m + 1, ranges[m].first, ranges[m].second);
+			};
+		// submitted inside the try, so a failing submit still waits for the queued modules, which
+		// reference files and ranges, before the error leaves this frame
+		std::vector<std::future<void>> futures;
+		std::exception_ptr error;
+		try
+		{
+			if (pool != nullptr && ranges.size() > 1)
+			{
+				futures.reserve(ranges.size());
+				for (size_t m = 0; m < ranges.size(); ++m)
+					futures.emplace_back(pool->submit(writeModule, m));
+			}
+
+			// the main routine is written while the modules are
+			FileSink sink(files.front());
+			{
+				SinkStreamBuf buf(sink);
+				std::ostream ss(&buf);
+				ss.exceptions(std::ios::badbit);
+				switch (robotType_)
+				{
+				case RLType::Abb:
+					ss << "! default z10 for not in program and fine for programing\n";
+					ss << "! default workjob1 and tooldata1\n";
+					ss << "MODULE mainModule\n";
+					ss << "  PROC main()\n";
+					ss << "    MOVEJ " << std::fixed << std::setprecision(4)
+						<< "[" << startPoint_.x << "," << startPoint_.y << "," << startPoint_.z << ",0.0,0.0,0.0]"
+						<< " ,v100 ,z10 ,tooldata1\\Wobj=workjob1; !Start Point\n";
+					for (size_t m = 0; m < ranges.size(); ++m)
+						ss << "    " << ModuleName(robotType_, m + 1) << ";\n";
+					ss << "  ENDPROC\n";
+					ss << "ENDMODULE\n";
+					break;
+				case RLType::Kuka:
+					ss << "; KUKA simple export\n";
+					ss << "DEF main()\n";
+					ss << "  ; start P[0]\n";
+					ss << "  P[0]:=\"Start\"\n";
+					for (size_t m = 0; m < ranges.size(); ++m)
+						ss << "  " << ModuleName(robotType_, m + 1) << "()\n";
+					ss << "END\n";
+					break;
+				default:
+					ss << "; FANUC simple export\n";
+					ss << "PR[1]=\"Start\"\n";
+					for (size_t m = 0; m < ranges.size(); ++m)
+						ss << "  CALL " << ModuleName(robotType_, m + 1) << " ;\n";
+					break;
+				}
+				ss.flush();
+			}
+			sink.Close();
+			if (futures.empty())
+			{
+				for (size_t m = 0; m < ranges.size(); ++m) writeModule(m);
+			}
+		}
+		catch (...)
+		{
+			error = std::current_exception();
 		}
-		return ss.str();
+		for (auto& f : futures)
+		{
+			try { f.get(); }
+			catch (...) { if (!error) error = std::current_exception(); }
+		}
+		if (error) std::rethrow_exception(error);
+		return files;
+	}
+
+	std::string RobotPath::ToString() const
+	{
+		std::string out;
+		StringSink sink(out);
+		Stream(sink);
+		return out;
 	}
 
 	std::string RobotPath::ToString(std::string_view script,
@@ -189,11 +545,10 @@ namespace HsBa::Slicer
 		return body;
 	}
 
-	std::string RobotPath::GenerateAbbCode() const
+	void RobotPath::GenerateAbbCode(std::ostream& ss) const
 	{
 
 		// simple ABB-like textual representation
-		std::ostringstream ss;
 		ss << "! default z10 for not in program and fine for programing\n";
 		ss << "! default workjob1 and tooldata1\n";
 		// define modules
@@ -203,10 +558,16 @@ namespace HsBa::Slicer
 		ss << "    MOVEJ " << std::fixed << std::setprecision(4)
 			<< "[" << startPoint_.x << "," << startPoint_.y << "," << startPoint_.z << ",0.0,0.0,0.0]"
 			<< " ,v100 ,z10 ,tooldata1\\Wobj=workjob1; !Start Point\n";
-		// points
-		for (size_t i = 0; i < points_.size(); ++i)
+		WriteAbbMoves(ss, 0, points_.size());
+		ss << "  ENDPROC\n";
+		ss << "ENDMODULE\n";
+	}
+
+	void RobotPath::WriteAbbMoves(std::ostream& ss, size_t first, size_t last) const
+	{
+		for (auto it = points_.At(first), end = points_.At(last); it != end; ++it)
 		{
-			auto &pt = points_[i];
+			const RLPoint pt = *it;
 			if (pt.type == RLPointType::ProgramLStart || pt.type == RLPointType::ProgramStart ||
 				pt.type == RLPointType::ProgramCStart)
 			{
@@ -261,21 +622,23 @@ namespace HsBa::Slicer
 				continue;
 			}
 		}
-		ss << "  ENDPROC\n";
-		ss << "ENDMODULE\n";
-		return ss.str();
 	}
 
-	std::string RobotPath::GenerateKukaCode() const
+	void RobotPath::GenerateKukaCode(std::ostream& ss) const
 	{
-		std::ostringstream ss;
 		ss << "; KUKA simple export\n";
 		ss << "DEF main()\n";
 		ss << "  ; start P[0]\n";
 		ss << "  P[0]:=\"Start\"\n";
-		for (size_t i = 0; i < points_.size(); ++i)
+		WriteKukaMoves(ss, 0, points_.size());
+		ss << "END\n";
+	}
+
+	void RobotPath::WriteKukaMoves(std::ostream& ss, size_t first, size_t last) const
+	{
+		for (auto it = points_.At(first), end = points_.At(last); it != end; ++it)
 		{
-			auto &pt = points_[i];
+			const RLPoint pt = *it;
 			ss << "  ; " << RLPointTypeToString(pt.type) << " to (" << pt.end.x << "," << pt.end.y << "," << pt.end.z << ")\n";
 			if (pt.type == RLPointType::ProgramLStart || pt.type == RLPointType::ProgramStart ||
 				pt.type == RLPointType::ProgramCStart)
@@ -309,18 +672,20 @@ namespace HsBa::Slicer
 				ss << "\n";
 			}
 		}
-		ss << "END\n";
-		return ss.str();
 	}
 
-	std::string RobotPath::GenerateFanucCode() const
+	void RobotPath::GenerateFanucCode(std::ostream& ss) const
 	{
-		std::ostringstream ss;
 		ss << "; FANUC simple export\n";
 		ss << "PR[1]=\"Start\"\n";
-		for (size_t i = 0; i < points_.size(); ++i)
+		WriteFanucMoves(ss, 0, points_.size());
+	}
+
+	void RobotPath::WriteFanucMoves(std::ostream& ss, size_t first, size_t last) const
+	{
+		for (auto it = points_.At(first), end = points_.At(last); it != end; ++it)
 		{
-			auto &pt = points_[i];
+			const RLPoint pt = *it;
 			ss << "  ! " << RLPointTypeToString(pt.type) << " to (" << pt.end.x << "," << pt.end.y << "," << pt.end.z << ")\n";
 			if (pt.type == RLPointType::ProgramLStart || pt.type == RLPointType::ProgramStart ||
 				pt.type == RLPointType::ProgramCStart)
@@ -341,7 +706,7 @@ namespace HsBa::Slicer
 			}
 			else
 			{
-				ss << "  J P[" << i << "] 100% FINE ;";
+				ss << "  J P[" << it.index() << "] 100% FINE ;";
 			}
 			if (pt.type == RLPointType::ProgramLStart || pt.type == RLPointType::ProgramStart || pt.type == RLPointType::ProgramCStart ||
 				pt.type == RLPointType::ProgramL || pt.type == RLPointType::ProgramC ||
@@ -354,7 +719,6 @@ namespace HsBa::Slicer
 				ss << "\n";
 			}
 		}
-		return ss.str();
 	}
 
 	std::string RobotPath::ToString(std::string_view script, std::string_view funcName,
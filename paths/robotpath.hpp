@@ -2,9 +2,13 @@
 #ifndef HSBA_SLICER_ROBOT_PATH_HPP
 #define HSBA_SLICER_ROBOT_PATH_HPP
 
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
 #include <vector>
 
 #include "IPath.hpp"
+#include "pathcolumns.hpp"
 
 namespace HsBa::Slicer
 {
@@ -34,6 +38,14 @@ namespace HsBa::Slicer
 		Undefine = ROBOT_UNDEFINED_TYPE,
 	};
 
+	class ThreadPool;
+
+	struct RobotModuleOptions
+	{
+		// moves per module or sub-program at most, controllers limit how large one may be
+		size_t movesPerModule = 20000;
+	};
+
 	struct RLPoint
 	{
 		OutPoints3 end;
@@ -43,6 +55,82 @@ namespace HsBa::Slicer
 		size_t programIndex = 0;
 	};
 
+	// the points of a RobotPath in columns, about a third of the memory of an RLPoint vector.
+	// Targets are kept as the changes of their bit patterns from the previous point (see
+	// PutDelta), so they read back exactly, middles only for points that have one, the program
+	// index once per change, and type and speed come from a palette. Reads return RLPoint by value
+	class RLPointStore
+	{
+	public:
+		using value_type = RLPoint;
+		using const_iterator = PathStoreIterator<RLPointStore>;
+
+		void push_back(const RLPoint& point);
+		void reserve(size_t points);
+		// gives back what reserve or growth left unused
+		void shrink_to_fit();
+		void clear();
+		size_t size() const noexcept
+		{
+			return tags_.size();
+		}
+		bool empty() const noexcept
+		{
+			return tags_.empty();
+		}
+		RLPoint operator[](size_t i) const;
+		const_iterator begin() const;
+		const_iterator end() const;
+		// iterator to point i, found from the checkpoint before it
+		const_iterator At(size_t i) const;
+		// bytes held, capacity included
+		size_t MemoryBytes() const noexcept;
+	private:
+		friend const_iterator;
+		struct Style
+		{
+			RLPointType type;
+			float velocity;
+			// circular moves, or a point with a middle that isn't +0
+			bool middle;
+			bool operator==(const Style& other) const noexcept;
+		};
+		// stream offset and target before every PATH_STORE_CHECKPOINT-th point
+		struct Checkpoint
+		{
+			size_t offset;
+			uint32_t x, y, z;
+			size_t middles, wide;
+		};
+		struct Cursor
+		{
+			size_t index = 0;
+			size_t programRun = 0;
+			size_t middle = 0, wide = 0;
+			// stream offset after the point at index
+			size_t offset = 0;
+			uint32_t x = 0, y = 0, z = 0;
+		};
+		Cursor Seek(size_t i) const;
+		void Advance(Cursor& cursor) const;
+		// reads the target of the point at cursor.index from the stream
+		void Decode(Cursor& cursor) const;
+		RLPoint Get(const Cursor& cursor) const;
+		const Style& StyleOf(uint8_t tag, const Cursor& cursor) const;
+
+		static constexpr uint8_t WIDE = Palette<Style>::CAPACITY;
+
+		std::vector<uint8_t> tags_;
+		// x, y and z changes of every point
+		std::vector<uint8_t> deltas_;
+		RunColumn<size_t> programs_;
+		Palette<Style> styles_;
+		std::vector<Style> wide_;
+		std::vector<OutPoints3> middles_;
+		std::vector<Checkpoint> checkpoints_;
+		uint32_t lastX_ = 0, lastY_ = 0, lastZ_ = 0;
+	};
+
 	class RobotPath : public IPath
 	{
 		public:
@@ -50,10 +138,18 @@ namespace HsBa::Slicer
 			void push_back(const RLPoint& point);
 			virtual ~RobotPath() = default;
 			RLType getRobotType() const;
+			virtual void Stream(IOutputSink& sink) const override;
 			virtual void Save(const std::filesystem::path&) const override;
 			virtual void Save(const std::filesystem::path&, std::string_view script,
 				const std::function<void(lua_State*)>& lua_reg = {}) const override;
 			virtual std::string ToString() const override;
+			// the program split into modules (ABB), sub-programs (KUKA) or called programs (FANUC) of
+			// options.movesPerModule moves at most, one file each in dir, plus a main routine calling
+			// them in order. A module ends outside a program segment when one of those falls in its
+			// second half. Modules are formatted and written concurrently when a pool is given.
+			// Returns the files written, the main routine first
+			std::vector<std::filesystem::path> SaveModules(const std::filesystem::path& dir,
+				const RobotModuleOptions& options = {}, ThreadPool* pool = nullptr) const;
 			virtual std::string ToString(std::string_view script,
 				const std::function<void(lua_State*)>& lua_reg = {}) const override;
 			virtual void Save(const std::filesystem::path& path, std::string_view script, std::string_view funcName,
@@ -71,12 +167,18 @@ namespace HsBa::Slicer
 		private:
 			RLType robotType_;
 			OutPoints3 startPoint_;
-			std::vector<RLPoint> points_;
+			RLPointStore points_;
 			std::string startProgramFunc_;
 			std::string endProgramFunc_;
-			std::string GenerateAbbCode() const;
-			std::string GenerateKukaCode() const;
-			std::string GenerateFanucCode() const;
+			void GenerateAbbCode(std::ostream& ss) const;
+			void GenerateKukaCode(std::ostream& ss) const;
+			void GenerateFanucCode(std::ostream& ss) const;
+			void WriteAbbMoves(std::ostream& ss, size_t first, size_t last) const;
+			void WriteKukaMoves(std::ostream& ss, size_t first, size_t last) const;
+			void WriteFanucMoves(std::ostream& ss, size_t first, size_t last) const;
+			// [first, last) ranges of the modules of SaveModules
+			std::vector<std::pair<size_t, size_t>> ModuleRanges(size_t movesPerModule) const;
+			void WriteModule(const std::filesystem::path& file, size_t index, size_t first, size_t last) const;
 	};
 } // namespace HsBa::Slicer
 
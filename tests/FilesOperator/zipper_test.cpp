@@ -2,7 +2,10 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include <filesystem>
+#include <memory>
 
+#include "base/error.hpp"
+#include "base/thread_pool.hpp"
 #include "fileoperator/zipper.hpp"
 #include "fileoperator/unzipper.hpp"
 #include "fileoperator/LuaAdapter.hpp"
@@ -55,6 +58,89 @@ BOOST_AUTO_TEST_CASE(test_zipper)
 	BOOST_TEST_MESSAGE("Zipper test completed successfully");
 }
 
+BOOST_AUTO_TEST_CASE(test_parallel_zipper)
+{
+	using namespace HsBa::Slicer;
+	std::unordered_map<std::string, std::string> files;
+	for (int i = 0; i < 24; ++i)
+	{
+		std::string text;
+		for (int line = 0; line < 200 * (i + 1); ++line)
+		{
+			text += "G1 X" + std::to_string(line * 7 % 1000) + " Y" + std::to_string(i) + "\n";
+		}
+		files["layer" + std::to_string(i) + ".txt"] = std::move(text);
+	}
+	// incompressible bytes are kept in stored blocks
+	std::string noise(5000, '\0');
+	unsigned state = 12345;
+	for (auto& c : noise)
+	{
+		state = state * 1103515245u + 12345u;
+		c = static_cast<char>(state >> 24);
+	}
+	files["noise.bin"] = noise;
+	files["tiny.txt"] = "ab";
+	files["empty.txt"] = "";
+
+	auto fill = [&files](Zipper& zipper) {
+		for (const auto& [name, data] : files)
+		{
+			if (name == "noise.bin") zipper.AddByteFile(name, std::make_shared<const std::string>(data));
+			else zipper.AddByteFileView(name, data);
+		}
+		};
+	const std::string parallel_path = "parallel_test.zip";
+	const std::string serial_path = "serial_test.zip";
+	ThreadPool pool(3);
+	Zipper parallel(MinizCompression::Tight);
+	fill(parallel);
+	BOOST_REQUIRE_NO_THROW(parallel.Save(parallel_path, pool));
+	Zipper serial(MinizCompression::Tight);
+	fill(serial);
+	BOOST_REQUIRE_NO_THROW(serial.Save(serial_path));
+
+	const auto extracted = MiniZExtractFileToBuffer(parallel_path);
+	BOOST_REQUIRE_EQUAL(extracted.size(), files.size());
+	for (const auto& [name, data] : files)
+	{
+		BOOST_REQUIRE(extracted.contains(name));
+		BOOST_CHECK(extracted.at(name) == data);
+	}
+	BOOST_CHECK(extracted == MiniZExtractFileToBuffer(serial_path));
+
+	// entries deflated on the pool are written as compressed data, miniz inflates them and checks the crc
+	mz_zip_archive reader{};
+	mz_zip_zero_struct(&reader);
+	BOOST_REQUIRE(mz_zip_reader_init_file(&reader, parallel_path.c_str(), 0));
+	for (const std::string name : { "layer23.txt", "noise.bin" })
+	{
+		const int index = mz_zip_reader_locate_file(&reader, name.c_str(), nullptr, 0);
+		BOOST_REQUIRE_GE(index, 0);
+		mz_zip_archive_file_stat stat;
+		BOOST_REQUIRE(mz_zip_reader_file_stat(&reader, static_cast<mz_uint>(index), &stat));
+		BOOST_CHECK_EQUAL(stat.m_method, MZ_DEFLATED);
+		BOOST_CHECK_EQUAL(stat.m_uncomp_size, files.at(name).size());
+		if (name == "layer23.txt") BOOST_CHECK_LT(stat.m_comp_size * 4, stat.m_uncomp_size);
+		size_t size = 0;
+		void* data = mz_zip_reader_extract_to_heap(&reader, static_cast<mz_uint>(index), &size, 0);
+		BOOST_REQUIRE(data != nullptr);
+		BOOST_CHECK(std::string_view(static_cast<const char*>(data), size) == files.at(name));
+		mz_free(data);
+	}
+	mz_zip_reader_end(&reader);
+	std::filesystem::remove(parallel_path);
+	std::filesystem::remove(serial_path);
+
+	// the writer is closed when the archive can't be written
+	Zipper failing(MinizCompression::Tight);
+	fill(failing);
+	BOOST_CHECK_THROW(failing.Save("no_such_dir/parallel_test.zip", pool), IOError);
+
+	Zipper empty;
+	BOOST_REQUIRE_THROW(empty.AddByteFile("null.bin", std::shared_ptr<const std::string>{}), InvalidArgumentError);
+}
+
 BOOST_AUTO_TEST_CASE(test_unzipper)
 {
 	BOOST_TEST_MESSAGE("Running Zipper test");
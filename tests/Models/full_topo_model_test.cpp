@@ -2,6 +2,8 @@
 // Use the header-only variant to provide the test runner (avoids linking issues)
 #include <boost/test/included/unit_test.hpp>
 
+#include <memory_resource>
+
 #include "base/IModel.hpp"
 #include "meshmodel/FullTopoModel.hpp"
 #include "2D/IntPolygon.hpp"
@@ -94,6 +96,46 @@ BOOST_AUTO_TEST_CASE(slice_cube_at_zero)
 	BOOST_CHECK(has_closed);
 }
 
+// counts what the scratch overload takes from its resource
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	size_t allocations = 0;
+private:
+	void* do_allocate(size_t bytes, size_t align) override
+	{
+		++allocations;
+		return std::pmr::new_delete_resource()->allocate(bytes, align);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t align) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+BOOST_AUTO_TEST_CASE(slice_cube_with_scratch)
+{
+	SimpleCubeModel model;
+	FullTopoModel topo(model);
+
+	// temporaries come from the given resource, the slices match the default ones
+	CountingResource counting;
+	BOOST_CHECK(topo.Slice(0.0f, &counting) == topo.Slice(0.0f));
+	BOOST_CHECK_GT(counting.allocations, 0u);
+
+	// one arena reused over the layers, released after each
+	auto& arena = ThreadLocalArena();
+	for (float height : { -0.5f, 0.0f, 0.25f, 0.75f })
+	{
+		auto polys = topo.Slice(height, &arena);
+		arena.release();
+		BOOST_CHECK(polys == topo.Slice(height));
+		BOOST_CHECK(!polys.empty());
+	}
+	BOOST_CHECK(topo.Slice(0.0f, nullptr) == topo.Slice(0.0f));
+}
+
 BOOST_AUTO_TEST_CASE(slice_cube_with_lua)
 {
 	SimpleCubeModel model;
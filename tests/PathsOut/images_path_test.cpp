@@ -2,6 +2,7 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "paths/imagespath.hpp"
+#include "fileoperator/zipper.hpp"
 #include <filesystem>
 #include <fstream>
 
@@ -76,4 +77,28 @@ return output_path
     std::filesystem::remove(tmp, ec);
 }
 
+BOOST_AUTO_TEST_CASE(test_save_moved_images)
+{
+    ImagesPath ip("cfgfile", "{}");
+    std::string img(4096, '\x7f');
+    img[0] = '\x89';
+    std::string expected = img;
+    ip.AddImage("moved.png", std::move(img));
+    // a plain char pointer must not be ambiguous
+    const char* literal = "eA==";
+    ip.AddImage("literal.png", literal);
+
+    auto tmp = std::filesystem::temp_directory_path() / "images_moved_test.zip";
+    std::error_code ec; std::filesystem::remove(tmp, ec);
+    ip.Save(tmp);
+
+    auto files = MiniZExtractFileToBuffer(tmp.string());
+    BOOST_REQUIRE_EQUAL(files.count("moved.png"), 1u);
+    BOOST_CHECK(files["moved.png"] == expected);
+    BOOST_CHECK_EQUAL(files["literal.png"], "eA==");
+    BOOST_CHECK_EQUAL(files["cfgfile"], "{}");
+
+    std::filesystem::remove(tmp, ec);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,10 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "paths/layerspath.hpp"
+#include "paths/layerspathreader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <lua.hpp>
@@ -95,4 +99,130 @@ return true
   std::filesystem::remove(tmpdb, ec);
 }
 
+BOOST_AUTO_TEST_CASE(test_packed_blob_save)
+{
+    LayersPath lp;
+    std::vector<PolygonsD> layers(5000);
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        layers[l].resize(4);
+        for (size_t k = 0; k < 4; ++k)
+        {
+            for (int i = 0; i < 50; ++i)
+            {
+                layers[l][k].push_back({ std::cos(i * 0.1) * 10.0 + k + l * 1e-3, std::sin(i * 0.1) * 10.0 - k });
+            }
+        }
+        lp.push_back("cfg" + std::to_string(l), layers[l]);
+    }
+
+    auto tmpdb = std::filesystem::temp_directory_path() / "layers_packed.db";
+    for (auto encoding : { LayerBlobEncoding::Float64, LayerBlobEncoding::Int32 })
+    {
+        std::error_code ec; std::filesystem::remove(tmpdb, ec);
+        lp.SetBlobEncoding(encoding);
+        auto start = std::chrono::steady_clock::now();
+        lp.Save(tmpdb);
+        const double save_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        BOOST_TEST_MESSAGE("saved " << layers.size() << " layers in " << save_ms << " ms");
+
+        SQL::SQLiteAdapter db;
+        db.Connect(tmpdb.string());
+        auto select = db.Prepare("SELECT layer_config, layer_data FROM layers ORDER BY id");
+        size_t row = 0;
+        double max_error = 0.0;
+        PolygonsD decoded;
+        while (select.Step())
+        {
+            BOOST_REQUIRE_LT(row, layers.size());
+            BOOST_CHECK_EQUAL(select.ColumnText(0), "cfg" + std::to_string(row));
+            DecodeLayerBlob(select.ColumnBlob(1), decoded);
+            BOOST_REQUIRE_EQUAL(decoded.size(), layers[row].size());
+            for (size_t k = 0; k < decoded.size(); ++k)
+            {
+                BOOST_REQUIRE_EQUAL(decoded[k].size(), layers[row][k].size());
+                for (size_t i = 0; i < decoded[k].size(); ++i)
+                {
+                    max_error = std::max({ max_error, std::abs(decoded[k][i].x - layers[row][k][i].x),
+                        std::abs(decoded[k][i].y - layers[row][k][i].y) });
+                }
+            }
+            ++row;
+        }
+        BOOST_CHECK_EQUAL(row, layers.size());
+        if (encoding == LayerBlobEncoding::Float64)
+            BOOST_CHECK_EQUAL(max_error, 0.0);
+        else
+            BOOST_CHECK_LE(max_error, DEFAULT_LAYER_BLOB_RESOLUTION / 2);
+    }
+    std::error_code ec; std::filesystem::remove(tmpdb, ec);
+
+    PolygonsD out_of_range(1);
+    out_of_range[0].push_back({ 1e9, 0.0 });
+    std::vector<unsigned char> blob;
+    BOOST_CHECK_THROW(EncodeLayerBlob(out_of_range, LayerBlobEncoding::Int32, DEFAULT_LAYER_BLOB_RESOLUTION, blob), InvalidArgumentError);
+    EncodeLayerBlob(out_of_range, LayerBlobEncoding::Float64, DEFAULT_LAYER_BLOB_RESOLUTION, blob);
+    blob.pop_back();
+    PolygonsD decoded;
+    BOOST_CHECK_THROW(DecodeLayerBlob(blob, decoded), RuntimeError);
+}
+
+BOOST_AUTO_TEST_CASE(test_layers_reader)
+{
+    LayersPath lp;
+    std::vector<PolygonsD> layers(2000);
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        layers[l].resize(2);
+        for (size_t k = 0; k < 2; ++k)
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                layers[l][k].push_back({ i * 0.5 + k, l * 0.2 - i });
+            }
+        }
+        lp.push_back("cfg" + std::to_string(l), layers[l]);
+    }
+    auto tmpdb = std::filesystem::temp_directory_path() / "layers_reader.db";
+    std::error_code ec; std::filesystem::remove(tmpdb, ec);
+    lp.Save(tmpdb);
+
+    {
+        LayersPathReader reader(tmpdb);
+        BOOST_REQUIRE_EQUAL(reader.size(), layers.size());
+        BOOST_CHECK_EQUAL(reader.LastId() - reader.FirstId() + 1, static_cast<int64_t>(layers.size()));
+
+        // in order, served by the read ahead
+        auto start = std::chrono::steady_clock::now();
+        for (int64_t id = reader.FirstId(); id <= reader.LastId(); ++id)
+        {
+            const auto& record = reader.Layer(id);
+            const size_t l = static_cast<size_t>(id - reader.FirstId());
+            BOOST_REQUIRE_EQUAL(record.id, id);
+            BOOST_CHECK_EQUAL(record.config, "cfg" + std::to_string(l));
+            BOOST_CHECK(record.layer == layers[l]);
+        }
+        const double per_layer_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / layers.size();
+        BOOST_TEST_MESSAGE("sequential read " << per_layer_us << " us per layer");
+
+        // jumps in both directions
+        for (int64_t offset : { 1500, 3, 3, 4, 1999, 0 })
+        {
+            const auto& record = reader.Layer(reader.FirstId() + offset);
+            BOOST_CHECK(record.layer == layers[static_cast<size_t>(offset)]);
+        }
+        BOOST_CHECK_THROW(reader.Layer(reader.LastId() + 1), OutOfRangeError);
+
+        size_t visited = 0;
+        reader.ReadRange(reader.FirstId() + 100, reader.FirstId() + 199, [&](const LayerRecord& record) {
+            BOOST_CHECK(record.layer == layers[100 + visited]);
+            ++visited;
+            });
+        BOOST_CHECK_EQUAL(visited, 100u);
+    }
+    std::filesystem::remove(tmpdb, ec);
+
+    BOOST_CHECK_THROW(LayersPathReader{ tmpdb }, SQL::SQLAdapterError);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
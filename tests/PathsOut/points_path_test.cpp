@@ -2,8 +2,26 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "paths/pointspath.hpp"
+#include "paths/gcodewriter.hpp"
 #include "paths/robotpath.hpp"
+#include "paths/outputsink.hpp"
+#include "paths/binarygcode.hpp"
+#include "base/error.hpp"
+#include "base/thread_pool.hpp"
+#include "2D/IntPolygon.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
 
 BOOST_AUTO_TEST_SUITE(points_path_test)
 
@@ -124,6 +142,108 @@ BOOST_AUTO_TEST_CASE(test_robot_outputs)
 	BOOST_CHECK_NE(outFanuc.find("J P"), std::string::npos);
 }
 
+BOOST_AUTO_TEST_CASE(test_robot_output_digits)
+{
+	using namespace HsBa::Slicer;
+
+	// coordinates off the 10^-4 grid print as given, KUKA and FANUC print 6 digits and
+	// ABB rounds 0.03125 to 0.0312 itself
+	RLPoint line;
+	line.type = RLPointType::MoveL;
+	line.end = { 0.123456f, 0.03125f, 12.5f };
+	RLPoint arc;
+	arc.type = RLPointType::MoveC;
+	arc.end = { 1.00001f, 2.0f, 0.3f };
+	arc.middle = { 0.5f, 0.123456f, 0.0f };
+
+	const auto coords = [](const OutPoints3& p, bool fixed, const char* y = ",", const char* z = ",") {
+		std::ostringstream ss;
+		if (fixed) ss << std::fixed << std::setprecision(4);
+		ss << p.x << y << p.y << z << p.z;
+		return ss.str();
+		};
+
+	for (RLType type : { RLType::Abb, RLType::Kuka, RLType::Fanuc })
+	{
+		RobotPath path(type);
+		path.push_back(line);
+		path.push_back(arc);
+		const auto text = path.ToString();
+		if (type == RLType::Abb)
+		{
+			BOOST_CHECK_NE(text.find("[" + coords(line.end, true) + ","), std::string::npos);
+			BOOST_CHECK_NE(text.find("[" + coords(arc.middle, true) + ",0.0,0.0,0.0], [" + coords(arc.end, true) + ","), std::string::npos);
+			BOOST_CHECK_NE(text.find("[0.1235,0.0312,12.5000,"), std::string::npos);
+		}
+		else if (type == RLType::Kuka)
+		{
+			BOOST_CHECK_NE(text.find("LIN {X " + coords(line.end, false, ", Y ", ", Z ")), std::string::npos);
+			BOOST_CHECK_NE(text.find("CIRC {X " + coords(arc.middle, false, ", Y ", ", Z ")), std::string::npos);
+			BOOST_CHECK_NE(text.find("(0.123456,0.03125,12.5)"), std::string::npos);
+		}
+		else
+		{
+			BOOST_CHECK_NE(text.find("via=(" + coords(arc.middle, false) + ") end=(" + coords(arc.end, false) + ")"), std::string::npos);
+			BOOST_CHECK_NE(text.find("end=(1.00001,2,0.3)"), std::string::npos);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_robot_modules)
+{
+	using namespace HsBa::Slicer;
+
+	auto read = [](const std::filesystem::path& file) {
+		std::ifstream ifs(file, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		};
+
+	for (RLType type : { RLType::Abb, RLType::Kuka, RLType::Fanuc })
+	{
+		RobotPath path(type, { 1.0f, 2.0f, 3.0f });
+		for (int i = 0; i < 50000; ++i)
+		{
+			RLPoint p;
+			const int k = i % 700;
+			p.type = k == 0 ? RLPointType::MoveJ : k == 1 ? RLPointType::ProgramLStart
+				: k < 600 ? (k % 5 == 0 ? RLPointType::ProgramC : RLPointType::ProgramL)
+				: k == 600 ? RLPointType::ProgramLEnd : RLPointType::MoveL;
+			p.end = { static_cast<float>(i) * 0.1f, 1.0f, 2.0f };
+			p.middle = { 0.0f, 1.0f, 0.0f };
+			p.programIndex = i / 700;
+			path.push_back(p);
+		}
+
+		const auto dir = std::filesystem::temp_directory_path() / "hsba_robot_modules";
+		const auto serialDir = std::filesystem::temp_directory_path() / "hsba_robot_modules_serial";
+		std::filesystem::remove_all(dir);
+		std::filesystem::remove_all(serialDir);
+
+		ThreadPool pool(4);
+		const auto files = path.SaveModules(dir, { 1000 }, &pool);
+		const auto serialFiles = path.SaveModules(serialDir, { 1000 });
+		BOOST_REQUIRE_EQUAL(files.size(), serialFiles.size());
+		BOOST_CHECK_GE(files.size(), 51u);
+
+		// the main routine calls every module once
+		const auto mainText = read(files.front());
+		for (size_t m = 1; m < files.size(); ++m)
+		{
+			BOOST_CHECK_NE(mainText.find(files[m].stem().string()), std::string::npos);
+			const auto text = read(files[m]);
+			BOOST_CHECK(text == read(serialFiles[m]));
+			// at most 1000 moves of no more than two lines each, plus the header and footer
+			BOOST_CHECK_LE(std::count(text.begin(), text.end(), '\n'), 2 * 1000 + 8);
+		}
+
+		std::filesystem::remove_all(dir);
+		std::filesystem::remove_all(serialDir);
+	}
+
+	RobotPath other(RLType::Unknown);
+	BOOST_CHECK_THROW(other.SaveModules(std::filesystem::temp_directory_path() / "hsba_robot_other"), NotSupportedError);
+}
+
 BOOST_AUTO_TEST_CASE(test_robot_script_out)
 {
 	using namespace HsBa::Slicer;
@@ -185,4 +305,547 @@ return result
 	}
 }
 
+BOOST_AUTO_TEST_CASE(test_arc_fitting)
+{
+	using namespace HsBa::Slicer;
+
+	// two layers, each a quarter circle of radius 10 sampled with 90 G1 moves and a short straight tail
+	auto build = [](PointsPath& path) {
+		double e = 0.0;
+		for (int layer = 0; layer < 2; ++layer)
+		{
+			float z = 0.2f * (layer + 1);
+			GPoint travel;
+			travel.type = GcodeType::G0;
+			travel.p1 = { 10.0f, 0.0f, z };
+			path.push_back(travel);
+			for (int i = 1; i <= 90; ++i)
+			{
+				double t = 3.14159265358979323846 / 2.0 * i / 90.0;
+				GPoint p;
+				p.p1 = { static_cast<float>(10.0 * std::cos(t)), static_cast<float>(10.0 * std::sin(t)), z };
+				e += 0.01;
+				p.extrusion = e;
+				path.push_back(p);
+			}
+			for (int i = 1; i <= 3; ++i)
+			{
+				GPoint p;
+				p.p1 = { -2.0f * i, 10.0f, z };
+				e += 0.01;
+				p.extrusion = e;
+				path.push_back(p);
+			}
+		}
+		};
+	PointsPath path(GCodeUnits::mm, { 0.0f, 0.0f, 0.0f });
+	build(path);
+	BOOST_CHECK_EQUAL(path.size(), 2u * 94u);
+
+	ArcFitStats stats;
+	path.FitArcs({}, nullptr, &stats);
+	BOOST_CHECK_EQUAL(stats.arcs, 2u);
+	BOOST_CHECK_EQUAL(stats.movesIn, 2u * 94u);
+	// per layer: travel, one arc, three straight moves
+	BOOST_CHECK_EQUAL(path.size(), 2u * 5u);
+	BOOST_CHECK_EQUAL(stats.movesOut, path.size());
+
+	auto arc = path[1];
+	BOOST_CHECK(arc.type == GcodeType::G3);
+	BOOST_CHECK_SMALL(arc.p1.x, 1e-4f);
+	BOOST_CHECK_CLOSE(arc.p1.y, 10.0f, 1e-3);
+	// centre is relative to the arc start (10, 0)
+	BOOST_CHECK_CLOSE(arc.center.x, -10.0f, 1e-2);
+	BOOST_CHECK_SMALL(arc.center.y, 1e-2f);
+	BOOST_CHECK_CLOSE(arc.extrusion, 0.9, 1e-3);
+	BOOST_CHECK_NE(path.ToString().find("G3 X"), std::string::npos);
+
+	// layers fitted on a pool give the same path
+	PointsPath parallel(GCodeUnits::mm, { 0.0f, 0.0f, 0.0f });
+	build(parallel);
+	ThreadPool pool(2);
+	parallel.FitArcs({}, &pool);
+	BOOST_CHECK_EQUAL(parallel.ToString(), path.ToString());
+
+	// with absolute E a G1 travel keeps the E it starts from, so it is not merged into the
+	// extruding arc after it even when it starts the span
+	std::vector<GPoint> layer;
+	for (int i = 1; i <= 30; ++i)
+	{
+		double t = 3.14159265358979323846 / 2.0 * i / 30.0;
+		GPoint p;
+		p.p1 = { static_cast<float>(10.0 * std::cos(t)), static_cast<float>(10.0 * std::sin(t)), 0.4f };
+		p.extrusion = 5.0 + 0.01 * (i - 1);
+		layer.push_back(p);
+	}
+	ArcFitStats layerStats;
+	const auto fitted = FitArcs({ 10.0f, 0.0f, 0.4f }, layer, {}, &layerStats, 5.0);
+	BOOST_REQUIRE_EQUAL(fitted.size(), 2u);
+	BOOST_CHECK(fitted[0].type == GcodeType::G1);
+	BOOST_CHECK_EQUAL(fitted[0].extrusion, 5.0);
+	BOOST_CHECK(fitted[1].type == GcodeType::G3);
+	BOOST_CHECK_EQUAL(layerStats.arcs, 1u);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_gcode_writer)
+{
+	using namespace HsBa::Slicer;
+
+	// the stream based formatting ToString used before, kept as the reference
+	auto reference = [](const OutPoints3& start, const std::vector<GPoint>& points) {
+		std::ostringstream ss;
+		ss << std::fixed << std::setprecision(4);
+		ss << "G21 ; units mm\nG90\n";
+		ss << "G0 X" << start.x << " Y" << start.y << " Z" << start.z << "\n";
+		for (const auto& pt : points)
+		{
+			ss << (pt.type == GcodeType::G0 ? "G0" : pt.type == GcodeType::G1 ? "G1" : pt.type == GcodeType::G2 ? "G2" : "G3");
+			ss << " X" << pt.p1.x << " Y" << pt.p1.y << " Z" << pt.p1.z;
+			if (pt.type == GcodeType::G2 || pt.type == GcodeType::G3)
+				ss << " I" << pt.center.x << " J" << pt.center.y << " K" << pt.center.z;
+			if (pt.velocity > 0.0f)
+				ss << " F" << pt.velocity;
+			ss << " E" << std::setprecision(6) << pt.extrusion << std::setprecision(4) << "\n";
+		}
+		return ss.str();
+	};
+
+	// ties, negative zero, values rounding to zero, huge and non-finite numbers
+	const float coords[] = { 0.0f, -0.0f, 0.00005f, -0.00005f, 0.125f, -1e-7f, 1e30f,
+		std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() };
+	const double extrusions[] = { 0.0000005, 0.0000025, -0.0000025, 1e300, -1e-9, 0.1234565 };
+	OutPoints3 start{ 1.5f, -0.0f, 0.00005f };
+	PointsPath path(GCodeUnits::mm, start);
+	std::vector<GPoint> points;
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<double> dist(-500.0, 500.0);
+	for (int i = 0; i < 200000; ++i)
+	{
+		GPoint p;
+		p.type = static_cast<GcodeType>(i % 4);
+		p.p1 = { static_cast<float>(dist(gen)), static_cast<float>(dist(gen)), static_cast<float>(dist(gen) * 1e-3) };
+		p.center = { static_cast<float>(dist(gen)), static_cast<float>(dist(gen)), 0.0f };
+		p.velocity = i % 5 == 0 ? 0.0f : static_cast<float>(std::abs(dist(gen)) * 10.0);
+		p.extrusion = i % 3 == 0 ? std::round(dist(gen) * 1e6) / 1e6 + 5e-7 : dist(gen);
+		if (i < static_cast<int>(std::size(coords))) p.p1.x = p.center.y = coords[i];
+		if (i < static_cast<int>(std::size(extrusions))) p.extrusion = extrusions[i];
+		points.push_back(p);
+		path.push_back(p);
+	}
+
+	auto start_time = std::chrono::steady_clock::now();
+	auto expected = reference(start, points);
+	auto stream_time = std::chrono::steady_clock::now();
+	auto out = path.ToString();
+	auto writer_time = std::chrono::steady_clock::now();
+	BOOST_CHECK(out == expected);
+
+	auto mbps = [&](auto from, auto to) {
+		return out.size() / 1e6 / std::chrono::duration<double>(to - from).count();
+	};
+	BOOST_TEST_MESSAGE("G-code formatting: stream " << mbps(start_time, stream_time) << " MB/s, writer "
+		<< mbps(stream_time, writer_time) << " MB/s");
+
+	// the buffer is reused after Clear
+	GCodeWriter writer;
+	path.Write(writer);
+	const auto* data = writer.View().data();
+	writer.Clear();
+	path.Write(writer);
+	BOOST_CHECK_EQUAL(static_cast<const void*>(writer.View().data()), static_cast<const void*>(data));
+	BOOST_CHECK(writer.View() == expected);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_streamed_save)
+{
+	using namespace HsBa::Slicer;
+
+	auto read = [](const std::filesystem::path& file) {
+		std::ifstream ifs(file, std::ios::binary);
+		return std::string{ std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>() };
+	};
+
+	PointsPath path(GCodeUnits::mm, { 0.0f, 0.0f, 0.0f });
+	for (int i = 0; i < 50000; ++i)
+	{
+		GPoint p;
+		p.type = i % 10 == 0 ? GcodeType::G0 : GcodeType::G1;
+		p.p1 = { static_cast<float>(i % 100), static_cast<float>(i / 100), static_cast<float>(i / 5000) * 0.2f };
+		p.extrusion = i * 0.01;
+		path.push_back(p);
+	}
+	const auto expected = path.ToString();
+	BOOST_REQUIRE_GT(expected.size(), STREAM_CHUNK_BYTES);
+
+	auto file = std::filesystem::temp_directory_path() / "hsba_streamed_save.gcode";
+	path.Save(file);
+	BOOST_CHECK(read(file) == expected);
+
+	// small buffers force many hand-overs, with and without the background writer
+	for (bool async : { false, true })
+	{
+		FileSink sink(file, async, 4096);
+		path.Stream(sink);
+		sink.Close();
+		BOOST_CHECK(read(file) == expected);
+	}
+
+	RobotPath robot(RLType::Abb);
+	RLPoint a;
+	a.end = { 1.0f, 2.0f, 3.0f };
+	for (int i = 0; i < 1000; ++i) robot.push_back(a);
+	robot.Save(file);
+	BOOST_CHECK(read(file) == robot.ToString());
+	std::filesystem::remove(file);
+
+	BOOST_CHECK_THROW(FileSink(std::filesystem::temp_directory_path() / "hsba_missing_dir" / "out.gcode"), IOError);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_parallel_formatting)
+{
+	using namespace HsBa::Slicer;
+
+	// many thin layers and one long layer that has to be cut without a height change
+	PointsPath path(GCodeUnits::mm, { 0.0f, 0.0f, 0.0f });
+	for (int i = 0; i < 400000; ++i)
+	{
+		GPoint p;
+		p.type = i % 50 == 0 ? GcodeType::G0 : GcodeType::G1;
+		const float z = i < 300000 ? static_cast<float>(i / 2000) * 0.2f : 100.0f;
+		p.p1 = { static_cast<float>(i % 997) * 0.1f, static_cast<float>(i % 991) * 0.1f, z };
+		p.extrusion = i * 0.001;
+		path.push_back(p);
+	}
+
+	auto serial_start = std::chrono::steady_clock::now();
+	const auto expected = path.ToString();
+	auto serial_end = std::chrono::steady_clock::now();
+
+	ThreadPool pool(4);
+	std::string out;
+	StringSink sink(out);
+	path.Stream(sink, pool);
+	auto parallel_end = std::chrono::steady_clock::now();
+	BOOST_CHECK(out == expected);
+	const double serial_ms = std::chrono::duration<double, std::milli>(serial_end - serial_start).count();
+	const double parallel_ms = std::chrono::duration<double, std::milli>(parallel_end - serial_end).count();
+	BOOST_TEST_MESSAGE("G-code formatting of " << expected.size() / 1e6 << " MB: serial " << serial_ms
+		<< " ms, 4 threads " << parallel_ms << " ms");
+
+	auto file = std::filesystem::temp_directory_path() / "hsba_parallel_save.gcode";
+	path.Save(file, pool);
+	std::ifstream ifs(file, std::ios::binary);
+	BOOST_CHECK(std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()) == expected);
+	ifs.close();
+	std::filesystem::remove(file);
+
+	// a failing sink stops the stream, the chunks still formatting are waited for
+	struct FailingSink final : IOutputSink
+	{
+		size_t writes = 0;
+		void Write(std::string_view) override
+		{
+			if (++writes == 3) throw IOError("sink full");
+		}
+	} failing;
+	BOOST_CHECK_THROW(path.Stream(failing, pool), IOError);
+	BOOST_CHECK_EQUAL(failing.writes, 3u);
+
+	// an empty path still gets its header
+	PointsPath empty;
+	std::string header;
+	StringSink headerSink(header);
+	empty.Stream(headerSink, pool);
+	BOOST_CHECK_EQUAL(header, empty.ToString());
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_gcode)
+{
+	using namespace HsBa::Slicer;
+
+	PointsPath path(GCodeUnits::mm, { 1.5f, -0.0f, 0.0f });
+	std::vector<std::vector<GPoint>> layers;
+	double extrusion = 0.0;
+	for (int layer = 0; layer < 50; ++layer)
+	{
+		layers.emplace_back();
+		// layer 10 is longer than several blocks
+		const int moves = layer == 10 ? 5000 : 200 + layer * 10;
+		for (int i = 0; i < moves; ++i)
+		{
+			GPoint p;
+			p.type = static_cast<GcodeType>(i % 4);
+			p.p1 = { static_cast<float>(i % 97) * 0.37f, i % 31 == 0 ? -0.0f : static_cast<float>(i % 89) * 0.41f,
+				static_cast<float>(layer + 1) * 0.2f };
+			p.center = { 1.25f, -2.5f, 0.0f };
+			p.velocity = i % 7 == 0 ? 0.0f : 1200.0f + static_cast<float>(i / 100) * 60.0f;
+			extrusion += 0.0123;
+			p.extrusion = extrusion;
+			layers.back().push_back(p);
+			path.push_back(p);
+		}
+	}
+
+	auto file = std::filesystem::temp_directory_path() / "hsba_binary.hbgc";
+	BinaryGCodeOptions options;
+	options.blockMoves = 1000;
+	path.SaveBinary(file, options);
+	const auto text = path.ToString();
+	const auto binary_size = std::filesystem::file_size(file);
+	BOOST_CHECK_LT(binary_size * 3, text.size());
+
+	{
+		auto load_start = std::chrono::steady_clock::now();
+		BinaryGCodeReader reader(file);
+		const auto back = reader.ToString();
+		auto load_end = std::chrono::steady_clock::now();
+		BOOST_CHECK(back == text);
+		BOOST_CHECK_EQUAL(reader.LayerCount(), layers.size());
+		BOOST_CHECK_EQUAL(reader.size(), path.size());
+		const double load_ms = std::chrono::duration<double, std::milli>(load_end - load_start).count();
+		BOOST_TEST_MESSAGE("binary G-code " << binary_size << " bytes, text " << text.size()
+			<< " bytes, decoded in " << load_ms << " ms");
+
+		// random access, layers come back in the same fixed point as the text output
+		for (size_t layer : { size_t{ 37 }, size_t{ 10 }, size_t{ 0 } })
+		{
+			const auto points = reader.ReadLayer(layer);
+			BOOST_CHECK_CLOSE(reader.LayerHeight(layer), layers[layer].front().p1.z, 1e-4);
+			GCodeWriter expected, actual;
+			for (const auto& p : layers[layer]) expected.Move(p);
+			for (const auto& p : points) actual.Move(p);
+			BOOST_CHECK(actual.View() == expected.View());
+		}
+		BOOST_CHECK(std::signbit(reader.ReadLayer(0)[0].p1.y));
+		BOOST_CHECK_THROW(reader.ReadLayer(layers.size()), OutOfRangeError);
+	}
+
+	std::ofstream(file, std::ios::binary) << "not a binary G-code file, just some text";
+	BOOST_CHECK_THROW(BinaryGCodeReader{ file }, RuntimeError);
+	std::filesystem::remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(test_point_stores)
+{
+	using namespace HsBa::Slicer;
+
+	// a print path built the way the slicer builds one: three walls and a zigzag infill of four
+	// parts a layer, integer polygons divided by integerization, E accumulated in double from the
+	// segment lengths and an arc now and then with its center off any grid
+	constexpr size_t moves = 1000000;
+	constexpr double pi = 3.14159265358979323846;
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<double> jitter(0.0, 1.0);
+	std::vector<GPoint> points;
+	points.reserve(moves + 8192);
+	double extrusion = 0.0;
+	Point2 last{ 0, 0 };
+	float z = 0.0f;
+	auto move = [&](const Point2& to, GcodeType type, float velocity, OutPoints3 center = {}) {
+		GPoint p;
+		p.type = type;
+		p.p1 = { static_cast<float>(to.x / integerization), static_cast<float>(to.y / integerization), z };
+		p.center = center;
+		p.velocity = velocity;
+		if (type != GcodeType::G0)
+			extrusion += std::hypot((to.x - last.x) / integerization, (to.y - last.y) / integerization) * 0.0333;
+		p.extrusion = extrusion;
+		points.push_back(p);
+		last = to;
+		};
+	for (int layer = 1; points.size() < moves; ++layer)
+	{
+		z = static_cast<float>(layer * 200000 / integerization);
+		for (int part = 0; part < 4; ++part)
+		{
+			const double cx = 40.0 * (part + 1) + jitter(gen), cy = 100.0 + 5.0 * jitter(gen), r = 10.0 + 10.0 * jitter(gen);
+			for (int wall = 0; wall < 3; ++wall)
+			{
+				const double radius = r - 0.4 * wall;
+				Polygon polygon;
+				for (int k = 0; k < 300; ++k)
+				{
+					const double a = 2.0 * pi * k / 300;
+					polygon.push_back(Point2{ std::llround((cx + radius * std::cos(a)) * integerization),
+						std::llround((cy + radius * std::sin(a) + 0.3 * std::sin(5.0 * a)) * integerization) });
+				}
+				move(polygon.front(), GcodeType::G0, 9000.0f);
+				for (size_t k = 1; k <= polygon.size(); ++k)
+				{
+					const Point2& to = polygon[k % polygon.size()];
+					if (k % 50 == 0)
+						move(to, GcodeType::G3, 1800.0f, { static_cast<float>(cx - last.x / integerization),
+							static_cast<float>(cy - last.y / integerization), 0.0f });
+					else
+						move(to, GcodeType::G1, 1800.0f);
+				}
+			}
+			for (double y = cy - r + 1.0; y < cy + r - 1.0; y += 0.45)
+			{
+				const double half = std::sqrt((r - 1.0) * (r - 1.0) - (y - cy) * (y - cy));
+				move(Point2{ std::llround((cx - half) * integerization), std::llround(y * integerization) }, GcodeType::G1, 3600.0f);
+				move(Point2{ std::llround((cx + half) * integerization), std::llround(y * integerization) }, GcodeType::G1, 3600.0f);
+			}
+		}
+	}
+	points.resize(moves);
+	// values no grid holds: not finite, huge, negative zero, small values off 10^-6, a center on a line
+	points[3].p1.x = std::numeric_limits<float>::quiet_NaN();
+	points[4].p1.y = 1e30f;
+	points[5].p1.x = -0.0f;
+	points[6].p1.x = 0.123456f;
+	points[7].p1.y = 0.03125f;
+	points[8].center = { 1.0f, 2.0f, 3.0f };
+
+	GPointStore store;
+	store.reserve(moves);
+	for (const auto& p : points) store.push_back(p);
+	BOOST_REQUIRE_EQUAL(store.size(), moves);
+	store.shrink_to_fit();
+	const size_t storeBytes = store.MemoryBytes();
+	const size_t vectorBytes = moves * sizeof(GPoint);
+	BOOST_TEST_MESSAGE("GPoint store " << storeBytes << " bytes, vector " << vectorBytes << " bytes");
+	BOOST_CHECK_LE(storeBytes * 3, vectorBytes);
+
+	BOOST_CHECK(std::isnan(store[3].p1.x));
+	BOOST_CHECK_EQUAL(store[4].p1.y, 1e30f);
+	BOOST_CHECK(std::signbit(store[5].p1.x));
+	BOOST_CHECK_EQUAL(store[6].p1.x, 0.123456f);
+	BOOST_CHECK_EQUAL(store[7].p1.y, 0.03125f);
+	BOOST_CHECK_EQUAL(store[8].center.y, 2.0f);
+
+	// iteration, random access and the original agree bit for bit
+	const auto bits = [](const OutPoints3& p) {
+		return std::array<uint32_t, 3>{ std::bit_cast<uint32_t>(p.x), std::bit_cast<uint32_t>(p.y), std::bit_cast<uint32_t>(p.z) };
+		};
+	const auto same = [&](const GPoint& a, const GPoint& b) {
+		return a.type == b.type && bits(a.p1) == bits(b.p1) && bits(a.center) == bits(b.center) &&
+			std::bit_cast<uint32_t>(a.velocity) == std::bit_cast<uint32_t>(b.velocity) &&
+			std::bit_cast<uint64_t>(a.extrusion) == std::bit_cast<uint64_t>(b.extrusion);
+		};
+	size_t i = 0;
+	size_t mismatches = 0;
+	for (const GPoint p : store)
+	{
+		if (!same(p, points[i]) || (i % 97 == 0 && !same(store[i], points[i])))
+		{
+			++mismatches;
+		}
+		++i;
+	}
+	BOOST_CHECK_EQUAL(i, moves);
+	BOOST_CHECK_EQUAL(mismatches, 0u);
+	auto it = store.At(moves - 2);
+	BOOST_CHECK_EQUAL(it.index(), moves - 2);
+	BOOST_CHECK(same(*it, points[moves - 2]));
+	++it;
+	++it;
+	BOOST_CHECK(it == store.end());
+
+	// the text of the stored moves is the text of the original moves
+	PointsPath path;
+	GCodeWriter writer;
+	writer.Header(GCodeUnits::mm, {});
+	for (size_t m = 0; m < 50000; ++m)
+	{
+		path.push_back(points[m]);
+		writer.Move(points[m]);
+	}
+	BOOST_CHECK(path.ToString() == writer.Take());
+
+	// robot points along the same path: program segments of linear moves with a circular one
+	// now and then, its via point halfway
+	RLPointStore robot;
+	robot.reserve(moves);
+	std::vector<RLPoint> robotPoints;
+	robotPoints.reserve(moves);
+	for (size_t m = 0; m < moves; ++m)
+	{
+		RLPoint p;
+		const size_t k = m % 700;
+		p.type = k == 0 ? RLPointType::MoveJ : k == 1 ? RLPointType::ProgramLStart
+			: k < 600 ? (k % 50 == 0 ? RLPointType::ProgramC : RLPointType::ProgramL)
+			: k == 600 ? RLPointType::ProgramLEnd : RLPointType::MoveL;
+		p.end = points[m].p1;
+		if (p.type == RLPointType::ProgramC)
+		{
+			const OutPoints3& from = points[m - 1].p1;
+			p.middle = { (from.x + p.end.x) * 0.5f, (from.y + p.end.y) * 0.5f, p.end.z };
+		}
+		p.velocity = k < 600 ? 20.0f : 200.0f;
+		p.programIndex = m / 700;
+		robotPoints.push_back(p);
+	}
+	robotPoints[5].middle = { 1.0f, 2.0f, 3.0f };
+	for (const auto& p : robotPoints) robot.push_back(p);
+	robot.shrink_to_fit();
+	BOOST_CHECK_EQUAL(robot[6].end.x, 0.123456f);
+	BOOST_CHECK_EQUAL(robot[7].end.y, 0.03125f);
+	BOOST_CHECK_EQUAL(robot[5].middle.y, 2.0f);
+	const size_t robotBytes = robot.MemoryBytes();
+	BOOST_TEST_MESSAGE("RLPoint store " << robotBytes << " bytes, vector " << moves * sizeof(RLPoint) << " bytes");
+	BOOST_CHECK_LE(robotBytes * 3, moves * sizeof(RLPoint));
+	mismatches = 0;
+	i = 0;
+	for (const RLPoint p : robot)
+	{
+		const RLPoint& o = robotPoints[i];
+		if (p.type != o.type || p.programIndex != o.programIndex ||
+			std::bit_cast<uint32_t>(p.velocity) != std::bit_cast<uint32_t>(o.velocity) ||
+			bits(p.end) != bits(o.end) || bits(p.middle) != bits(o.middle) ||
+			(i % 97 == 0 && bits(robot[i].end) != bits(o.end)))
+		{
+			++mismatches;
+		}
+		++i;
+	}
+	BOOST_CHECK_EQUAL(mismatches, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_script_views)
+{
+	using namespace HsBa::Slicer;
+
+	PointsPath path;
+	double expected_sum = 0.0;
+	for (int i = 0; i < 100000; ++i)
+	{
+		GPoint p;
+		p.type = GcodeType::G1;
+		p.p1 = { static_cast<float>(i) * 0.001f, 1.0f, 0.2f };
+		p.velocity = 1200.0f;
+		p.extrusion = i * 0.01;
+		path.push_back(p);
+		expected_sum += static_cast<double>(p.p1.x);
+	}
+
+	// the points are views over the path: indexing, #, ipairs and pairs work, writes don't.
+	// Counted loops and jumps back and forth read the same points as ipairs
+	std::string script = R"lua(
+local sum = 0
+for i, p in ipairs(points) do sum = sum + p.p1.x end
+local counted = 0
+for i = 1, #points do counted = counted + points[i].p1.x end
+local count = 0
+for i, p in pairs(points) do count = count + 1 end
+local jumps = points[#points].p1.x + points[1].p1.x + points[50001].p1.x + points[50000].p1.x + points[50001].p1.x
+local writable = pcall(function() points[1].velocity = 1 end)
+return string.format("%d,%d,%.3f,%s,%.3f,%s,%s,%s", #points, count, sum, tostring(sum == counted), jumps,
+  tostring(points[#points + 1]), points[2].type, tostring(writable))
+)lua";
+	auto start = std::chrono::steady_clock::now();
+	const auto res = path.ToString(script);
+	const double script_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	BOOST_TEST_MESSAGE("script over " << path.size() << " points took " << script_ms << " ms");
+
+	std::ostringstream expected;
+	const auto x = [](int i) { return static_cast<double>(static_cast<float>(i) * 0.001f); };
+	expected << "100000,100000," << std::fixed << std::setprecision(3) << expected_sum << ",true,"
+		<< x(99999) + x(0) + x(50000) + x(49999) + x(50000) << ",nil,G1,false";
+	BOOST_CHECK_EQUAL(res, expected.str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
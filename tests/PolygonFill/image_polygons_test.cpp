@@ -2,10 +2,13 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "../../2D/ImageToPolygons.hpp"
+#include "base/error.hpp"
+#include "base/thread_pool.hpp"
 #ifdef HAS_OPENCV
 #include <opencv2/opencv.hpp>
 #endif
 #include <filesystem>
+#include <fstream>
 
 using namespace HsBa::Slicer;
 
@@ -119,3 +122,165 @@ end
     // cleanup
     std::filesystem::remove(outPath, ec);
 }
+
+BOOST_AUTO_TEST_CASE(marching_squares_contours)
+{
+    // 6x6 block with a 2x2 hole, traced without any image library
+    int w = 10, h = 10;
+    std::vector<uint8_t> img(w * h, 0);
+    for (int y = 2; y < 8; ++y)
+        for (int x = 2; x < 8; ++x)
+            img[y * w + x] = 255;
+    for (int y = 4; y < 6; ++y)
+        for (int x = 4; x < 6; ++x)
+            img[y * w + x] = 0;
+
+    PolygonsD polys = FromGrayImage(img, w, h, 128, 0.5);
+    BOOST_REQUIRE_EQUAL(polys.size(), 2u);
+    // outer border is positive, the hole negative
+    BOOST_CHECK_GT(Area(polys[0]), 0.0);
+    BOOST_CHECK_LT(Area(polys[1]), 0.0);
+    // borders run halfway between pixel centres, corners are cut by half a pixel
+    BOOST_CHECK_CLOSE(Area(polys[0]), (36.0 - 0.5) * 0.25, 1e-9);
+    BOOST_CHECK_CLOSE(Area(polys[1]), -(4.0 - 0.5) * 0.25, 1e-9);
+
+    // diagonal pixels stay separate in binary mode
+    std::vector<uint8_t> diag(16, 0);
+    diag[1 * 4 + 1] = 255;
+    diag[2 * 4 + 2] = 255;
+    BOOST_CHECK_EQUAL(FromGrayImage(diag, 4, 4, 128).size(), 2u);
+
+    // sub-pixel mode moves the border towards the darker side
+    std::vector<uint8_t> ramp(9, 0);
+    ramp[4] = 255;
+    ramp[5] = 100;
+    auto sharp = FromGrayImage(ramp, 3, 3, 50);
+    auto smooth = FromGrayImage(ramp, 3, 3, 50, 1.0, true);
+    BOOST_REQUIRE_EQUAL(sharp.size(), 1u);
+    BOOST_REQUIRE_EQUAL(smooth.size(), 1u);
+    BOOST_CHECK(std::abs(Area(sharp[0]) - Area(smooth[0])) > 1e-6);
+
+    BOOST_CHECK_THROW(FromGrayImage(img, w + 1, h, 128), InvalidArgumentError);
+}
+
+BOOST_AUTO_TEST_CASE(multi_threshold_single_sweep)
+{
+    // radial gradient, every threshold gives one ring-shaped level set
+    int w = 64, h = 48;
+    std::vector<uint8_t> img(w * h);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            double d = std::hypot(x - w / 2.0, y - h / 2.0);
+            img[y * w + x] = static_cast<uint8_t>(std::max(0.0, 255.0 - d * 8.0));
+        }
+    // unsorted with a duplicate, results must follow this order
+    std::vector<int> thresholds = { 200, 50, 120, 50, 250 };
+    auto layers = FromGrayImageMulti(img, w, h, thresholds, 1.0, true);
+    BOOST_REQUIRE_EQUAL(layers.size(), thresholds.size());
+    for (size_t i = 0; i < thresholds.size(); ++i)
+    {
+        BOOST_CHECK(layers[i] == FromGrayImage(img, w, h, thresholds[i], 1.0, true));
+    }
+    // brighter thresholds enclose less area
+    BOOST_CHECK_GT(Area(layers[1]), Area(layers[2]));
+    BOOST_CHECK_GT(Area(layers[2]), Area(layers[0]));
+
+    ThreadPool pool(3);
+    auto parallel = FromGrayImageMulti(img, w, h, thresholds, 1.0, true, &pool);
+    BOOST_CHECK(parallel == layers);
+}
+
+BOOST_AUTO_TEST_CASE(native_scanline_rasterizer)
+{
+    // 10x5 rectangle with a 2x2 hole, even-odd leaves the hole empty
+    PolygonsD rect = {
+        { {2.0, 2.0}, {12.0, 2.0}, {12.0, 7.0}, {2.0, 7.0} },
+        { {4.0, 3.0}, {4.0, 5.0}, {6.0, 5.0}, {6.0, 3.0} } };
+    int w = 20, h = 10;
+    // padded rows, the padding must stay untouched
+    size_t stride = 24;
+    std::vector<uint8_t> buf(stride * h, 7);
+    RasterizePolygons(Integerization(rect), buf.data(), w, h, stride, 1.0);
+    int filled = 0;
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x) filled += buf[y * stride + x] == MAX_GRAY_VALUE;
+        for (size_t x = w; x < stride; ++x) BOOST_CHECK_EQUAL(buf[y * stride + x], 7);
+    }
+    BOOST_CHECK_EQUAL(filled, 50 - 4);
+
+    // anti-aliased coverage sums to the polygon area and blends along slanted edges
+    PolygonsD tri = { { {0.0, 0.0}, {10.5, 0.0}, {3.0, 9.0} } };
+    RasterOptions options;
+    options.antiAliasSamples = 4;
+    options.tileRows = 3;
+    std::vector<uint8_t> aa(w * h);
+    RasterizePolygons(Integerization(tri), aa.data(), w, h, w, 1.0, options);
+    double coverage = 0;
+    int partial = 0;
+    for (auto v : aa)
+    {
+        coverage += v / 255.0;
+        partial += v > MIN_GRAY_VALUE && v < MAX_GRAY_VALUE;
+    }
+    BOOST_CHECK_CLOSE(coverage, 10.5 * 9.0 / 2.0, 1.0);
+    BOOST_CHECK_GT(partial, 0);
+
+    // tiles rendered on a pool match the serial result
+    ThreadPool pool(3);
+    std::vector<uint8_t> parallel(w * h);
+    RasterizePolygons(Integerization(tri), parallel.data(), w, h, w, 1.0, options, &pool);
+    BOOST_CHECK(parallel == aa);
+
+    BOOST_CHECK_THROW(RasterizePolygons(Integerization(tri), aa.data(), w, h, w - 1, 1.0), InvalidArgumentError);
+
+    // vertices far outside the raster are clipped to it
+    PolygonsD huge = {
+        { {2.0, -1e11}, {8.0, -1e11}, {8.0, 5.0}, {2.0, 5.0} },
+        { {-1e11, 7.0}, {1e11, 7.0}, {1e11, 1e11}, {-1e11, 1e11} } };
+    std::vector<uint8_t> clipped(w * h);
+    RasterizePolygons(Integerization(huge), clipped.data(), w, h, w, 1.0);
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            const bool inside = y >= 7 || (y < 5 && x >= 2 && x < 8);
+            BOOST_CHECK_EQUAL(clipped[y * w + x], inside ? MAX_GRAY_VALUE : MIN_GRAY_VALUE);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(in_memory_png_encoding)
+{
+    std::vector<PolygonsD> layers;
+    for (int i = 0; i < 4; ++i)
+    {
+        double s = 4.0 + i;
+        layers.push_back({ { {2.0, 2.0}, {2.0 + s, 2.0}, {2.0 + s, 2.0 + s}, {2.0, 2.0 + s} } });
+    }
+    int w = 16, h = 16;
+    auto pngs = ToPNGs(layers, w, h, 1.0);
+    BOOST_REQUIRE_EQUAL(pngs.size(), layers.size());
+    const std::string signature = "\x89PNG\r\n\x1a\n";
+    for (const auto& png : pngs)
+        BOOST_CHECK_EQUAL(png.substr(0, signature.size()), signature);
+
+    ThreadPool pool(3);
+    BOOST_CHECK(ToPNGs(layers, w, h, 1.0, {}, -1, &pool) == pngs);
+
+    // the encoded bytes decode back to the rasterized square
+    auto tmp = std::filesystem::temp_directory_path() / "in_memory_png_test.png";
+    {
+        std::ofstream ofs(tmp, std::ios::binary);
+        ofs.write(pngs[2].data(), static_cast<std::streamsize>(pngs[2].size()));
+    }
+    auto polys = FromImage(tmp.string(), 128, 1.0);
+    BOOST_REQUIRE_EQUAL(polys.size(), 1u);
+    // pixel-centre rule fills 6x6 pixels, tracing cuts their corners by half a pixel
+    BOOST_CHECK_CLOSE(Area(polys[0]), 36.0 - 0.5, 1e-9);
+    std::error_code ec; std::filesystem::remove(tmp, ec);
+
+    std::vector<uint8_t> img(8, 0);
+    BOOST_CHECK_THROW(EncodePNG(img.data(), 4, 2, 3), InvalidArgumentError);
+}
@@ -5,7 +5,13 @@
 #include <fstream>
 #include <iostream>
 
+#include "2D/2Dhull.hpp"
+#include "2D/BoundedPolygons.hpp"
 #include "2D/LuaAdapter.hpp"
+#include "2D/Simplify.hpp"
+#include "base/error.hpp"
+#include "base/thread_pool.hpp"
+#include "utils/LuaNewObject.hpp"
 
 using namespace HsBa::Slicer;
 
@@ -91,3 +97,174 @@ PolygonOperations.dumpPolygons(poly, "__FILENAME2__")
     std::filesystem::remove(dump_path1, ec);
     std::filesystem::remove(dump_path2, ec);
 }
+
+BOOST_AUTO_TEST_CASE(batch_boolean_operations)
+{
+    // three overlapping squares along x, each 10 wide and shifted by 5
+    std::vector<PolygonsD> squares;
+    for (int i = 0; i < 3; ++i)
+    {
+        double x = i * 5.0;
+        squares.push_back(PolygonsD{ PolygonD{ {x, 0.0}, {x + 10.0, 0.0}, {x + 10.0, 10.0}, {x, 10.0} } });
+    }
+    auto merged = UnionAll(squares);
+    BOOST_CHECK_EQUAL(merged.size(), 1);
+    BOOST_CHECK_CLOSE(std::abs(Area(merged)), 200.0, 1e-6);
+
+    auto common = IntersectionAll(squares);
+    BOOST_CHECK(common.empty());
+
+    auto diff = BooleanBatch(Clipper2Lib::ClipType::Difference,
+        std::span<const PolygonsD>{ squares.data(), 1 }, std::span<const PolygonsD>{ squares.data() + 1, 2 });
+    BOOST_CHECK_CLOSE(std::abs(Area(diff)), 50.0, 1e-6);
+
+    // pairwise overloads route through the same engine
+    auto pair = Union(squares[0], squares[2]);
+    BOOST_CHECK_EQUAL(pair.size(), 2);
+
+    auto L = MakeUniqueLuaState();
+    BOOST_REQUIRE(L);
+    luaL_openlibs(L.get());
+    RegisterLuaPolygonOperations(L.get());
+    const char* lua_code = R"(
+local a = { { { x = 0, y = 0 }, { x = 10, y = 0 }, { x = 10, y = 10 }, { x = 0, y = 10 } } }
+local b = { { { x = 5, y = 0 }, { x = 15, y = 0 }, { x = 15, y = 10 }, { x = 5, y = 10 } } }
+local u = PolygonOperations.unionAll({ a, b })
+union_count = #u
+local d = PolygonOperations.booleanBatch({ a }, { b }, "difference")
+diff_area = math.abs(PolygonOperations.area(d[1]))
+)";
+    int ret = luaL_dostring(L.get(), lua_code);
+    if (ret != LUA_OK)
+    {
+        const char* message = lua_tostring(L.get(), -1);
+        std::cerr << (message ? message : "Lua execution failed without error message") << std::endl;
+        BOOST_CHECK(false);
+    }
+    lua_getglobal(L.get(), "union_count");
+    BOOST_CHECK_EQUAL(lua_tointeger(L.get(), -1), 1);
+    lua_getglobal(L.get(), "diff_area");
+    BOOST_CHECK_CLOSE(lua_tonumber(L.get(), -1), 50.0, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(bounded_polygons_early_reject)
+{
+    auto square = [](int64_t x, int64_t y, int64_t w) {
+        return Polygon{ Point2{ x, y }, Point2{ x + w, y }, Point2{ x + w, y + w }, Point2{ x, y + w } };
+        };
+    Polygons partPaths{ square(0, 0, 100) };
+    const Polygons farPaths{ square(1000, 1000, 10) };
+    const Polygons nearPaths{ square(50, 50, 100), square(5000, 5000, 10) };
+    BoundedPolygons part{ partPaths };
+    const BoundedPolygons far{ farPaths };
+    const BoundedPolygons near{ nearPaths };
+
+    BOOST_CHECK_EQUAL(part.Bounds().right, 100);
+    BOOST_CHECK_CLOSE(std::abs(part.Area()), 10000.0, 1e-9);
+    BOOST_CHECK_EQUAL(near.PathBounds(1).left, 5000);
+
+    // disjoint operands never reach Clipper
+    BOOST_CHECK(Intersection(part, far).empty());
+    BOOST_CHECK(Difference(part, far) == part.Paths());
+    BOOST_CHECK_EQUAL(Union(part, far).size(), 2);
+
+    // the far square of `near` is dropped, the result matches the plain call
+    BOOST_CHECK(PathsNear(near, part.Bounds()) == std::vector<size_t>{ 0 });
+    BOOST_CHECK(&near.Paths() == &nearPaths);
+    BOOST_CHECK_CLOSE(std::abs(Area(Difference(part, near))), 7500.0, 1e-9);
+    BOOST_CHECK_CLOSE(std::abs(Area(Intersection(part, near))), 2500.0, 1e-9);
+
+    BOOST_CHECK(PointInPolygons(Point2{ 2000, 2000 }, part) == Clipper2Lib::PointInPolygonResult::IsOutside);
+    BOOST_CHECK(PointInPolygons(Point2{ 50, 50 }, part) == Clipper2Lib::PointInPolygonResult::IsInside);
+
+    // Refresh drops the cached bounds after the viewed paths change
+    partPaths.push_back(square(200, 0, 10));
+    part.Refresh();
+    BOOST_CHECK_EQUAL(part.Bounds().right, 210);
+    partPaths.clear();
+    part.Refresh();
+    BOOST_CHECK(part.empty());
+    BOOST_CHECK_EQUAL(part.Bounds().right, 0);
+}
+
+BOOST_AUTO_TEST_CASE(simplify_contours)
+{
+    // dense wavy ring with a plain circular hole inside it
+    constexpr int count = 4000;
+    PolygonD outer, hole;
+    for (int i = 0; i < count; ++i)
+    {
+        double t = 2.0 * 3.14159265358979323846 * i / count;
+        double r = 10.0 + 0.3 * std::sin(7.0 * t) + 0.001 * std::sin(900.0 * t);
+        outer.push_back({ r * std::cos(t), r * std::sin(t) });
+        hole.push_back({ 9.0 * std::cos(-t), 9.0 * std::sin(-t) });
+    }
+    PolygonsD layer{ outer, hole };
+    for (auto method : { SimplifyMethod::RamerDouglasPeucker, SimplifyMethod::Visvalingam })
+    {
+        SimplifyOptions options;
+        options.tolerance = 0.01;
+        options.method = method;
+        options.chunkSize = 1;
+        SimplifyStats stats;
+        auto simplified = SimplifyPolygons(layer, options, &stats);
+        BOOST_REQUIRE_EQUAL(simplified.size(), 2u);
+        BOOST_CHECK_EQUAL(stats.pointsIn, 2u * count);
+        BOOST_CHECK_EQUAL(stats.pointsOut, simplified[0].size() + simplified[1].size());
+        BOOST_CHECK_GT(stats.Reduction(), 0.9);
+        BOOST_CHECK_CLOSE(Area(simplified), Area(layer), 0.5);
+
+        ThreadPool pool(3);
+        BOOST_CHECK(SimplifyPolygons(layer, options, nullptr, &pool) == simplified);
+    }
+
+    // dropping the notch would make the outer border cut through the hole, so it is kept
+    PolygonsD notch{
+        PolygonD{ {0.0, 0.0}, {4.9, 0.0}, {5.0, -0.009}, {5.1, 0.0}, {10.0, 0.0}, {10.0, 10.0}, {0.0, 10.0} },
+        PolygonD{ {4.98, -0.006}, {5.0, 0.5}, {5.02, -0.006} } };
+    SimplifyOptions options;
+    options.tolerance = 0.01;
+    SimplifyStats stats;
+    auto kept = SimplifyPolygons(notch, options, &stats);
+    BOOST_CHECK(kept == notch);
+    BOOST_CHECK_EQUAL(stats.reverted, 1u);
+    // without the hole the notch goes
+    BOOST_CHECK_EQUAL(SimplifyPolygons(PolygonsD{ notch[0] }, options).front().size(), 4u);
+
+    BOOST_CHECK_THROW(SimplifyPolygons(notch, SimplifyOptions{ -1.0 }), InvalidArgumentError);
+}
+
+BOOST_AUTO_TEST_CASE(monotone_chain_hull)
+{
+    // about 200000 points on a 333x600 grid, several chunks of 65536 points for the pool and
+    // rows of 333 points that cross the chunk boundaries. One row in the second chunk pokes out
+    // to the left, so the hull is the bounding rectangle plus a triangle only that chunk sees
+    Polygons layer;
+    for (int64_t row = 0; row < 600; ++row)
+    {
+        Polygon path;
+        for (int64_t col = 0; col < 333; ++col)
+            path.push_back(Point2{ col * 1000, row * 1000 });
+        if (row == 300) path.push_back(Point2{ int64_t{ -50000 }, row * 1000 });
+        layer.push_back(path);
+    }
+    auto hull = ConvexHull(layer);
+    BOOST_REQUIRE_EQUAL(hull.size(), 5u);
+    BOOST_CHECK(Clipper2Lib::IsPositive(hull));
+    BOOST_CHECK_CLOSE(Clipper2Lib::Area(hull), 332000.0 * 599000.0 + 0.5 * 599000.0 * 50000.0, 1e-9);
+
+    ThreadPool pool(3);
+    BOOST_CHECK(ConvexHull(layer, &pool) == hull);
+
+    // the running envelope over layers matches the hull of everything
+    HullAccumulator envelope;
+    for (const auto& path : layer) envelope.Add(path);
+    BOOST_CHECK(envelope.Hull() == hull);
+
+    // extra points are inserted along each hull edge in order
+    PolygonD square{ {0.0, 0.0}, {10.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}, {5.0, 5.0} };
+    auto dense = ConcaveHullSimulation(square, 1);
+    BOOST_REQUIRE_EQUAL(dense.size(), 8u);
+    BOOST_CHECK_CLOSE(Clipper2Lib::Area(dense), 100.0, 1e-9);
+    BOOST_CHECK(dense[1] == (Point2D{ 5.0, 0.0 }));
+}
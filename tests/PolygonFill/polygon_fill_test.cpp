@@ -1,10 +1,15 @@
 #define BOOST_TEST_MODULE polygon_fill_test
 #include <boost/test/included/unit_test.hpp>
 
+#include <chrono>
 #include <filesystem>
+#include <memory_resource>
 
 #include "2D/PolygonFill.hpp"
 #include "2D/IntPolygon.hpp"
+#include "2D/FillCache.hpp"
+#include "2D/PathOrder.hpp"
+#include "base/thread_pool.hpp"
 
 using namespace HsBa::Slicer;
 
@@ -114,3 +119,271 @@ end
     for (const auto &p : luares) if (p.size() == 2) { anyLine = true; break; }
     BOOST_CHECK(anyLine);
 }
+
+BOOST_AUTO_TEST_CASE(multi_island_fill)
+{
+    // three separate squares, the middle one has a hole
+    Polygons layer;
+    for (int i = 0; i < 3; ++i)
+    {
+        PolygonD sq;
+        double x = i * 20000.0;
+        sq.emplace_back(Point2D{ x, 0.0 });
+        sq.emplace_back(Point2D{ x + 10000.0, 0.0 });
+        sq.emplace_back(Point2D{ x + 10000.0, 10000.0 });
+        sq.emplace_back(Point2D{ x, 10000.0 });
+        layer.push_back(Integerization(sq));
+    }
+    PolygonD hole;
+    hole.emplace_back(Point2D{ 24000.0, 4000.0 });
+    hole.emplace_back(Point2D{ 24000.0, 6000.0 });
+    hole.emplace_back(Point2D{ 26000.0, 6000.0 });
+    hole.emplace_back(Point2D{ 26000.0, 4000.0 });
+    layer.push_back(Integerization(hole));
+
+    auto islands = SplitIslands(layer);
+    BOOST_CHECK_EQUAL(islands.size(), 3);
+    size_t withHole = 0;
+    for (const auto& island : islands) if (island.size() == 2) ++withHole;
+    BOOST_CHECK_EQUAL(withHole, 1);
+
+    auto serial = MultiIslandFill(layer, FillMode::Zigzag, 1000.0, 0.0, 200.0);
+    BOOST_CHECK(!serial.empty());
+
+    ThreadPool pool(4);
+    auto parallel = MultiIslandFill(layer, FillMode::Zigzag, 1000.0, 0.0, 200.0, &pool);
+    // stable island order gives identical output regardless of scheduling
+    BOOST_CHECK(serial == parallel);
+
+    // every island gets filled
+    for (const auto& island : islands)
+    {
+        bool covered = false;
+        for (const auto& path : parallel)
+        {
+            for (const auto& pt : path)
+            {
+                if (PointInPolygons(pt, island) != Clipper2Lib::PointInPolygonResult::IsOutside)
+                {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) break;
+        }
+        BOOST_CHECK(covered);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pattern_infills)
+{
+    PolygonD polyd;
+    polyd.emplace_back(Point2D{ 0.0, 0.0 });
+    polyd.emplace_back(Point2D{ 100.0, 0.0 });
+    polyd.emplace_back(Point2D{ 100.0, 100.0 });
+    polyd.emplace_back(Point2D{ 0.0, 100.0 });
+    auto poly = Polygons{ Integerization(polyd) };
+
+    auto all_inside = [&](const Polygons& paths) {
+        for (const auto& path : paths)
+            for (const auto& pt : path)
+                if (PointInPolygons(pt, poly) == Clipper2Lib::PointInPolygonResult::IsOutside)
+                    return false;
+        return true;
+        };
+
+    auto gyroid = GyroidFill(poly, 5.0, 0.3, 0.0);
+    BOOST_CHECK(!gyroid.empty());
+    BOOST_CHECK(all_inside(gyroid));
+    // the gyroid changes from layer to layer
+    BOOST_CHECK(gyroid != GyroidFill(poly, 5.0, 2.0, 0.0));
+
+    auto honeycomb = HoneycombFill(poly, 5.0, 30.0);
+    BOOST_CHECK(!honeycomb.empty());
+    BOOST_CHECK(all_inside(honeycomb));
+
+    auto triangles = TriangularFill(poly, 5.0, 0.0);
+    BOOST_CHECK(!triangles.empty());
+    BOOST_CHECK(all_inside(triangles));
+    // 3 families of lines, roughly 100 / 5 lines each across the square
+    BOOST_CHECK(triangles.size() >= 3 * 15);
+
+    auto cubic0 = CubicFill(poly, 5.0, 0.0, 0.0);
+    auto cubic1 = CubicFill(poly, 5.0, 1.0, 0.0);
+    BOOST_CHECK(!cubic0.empty());
+    BOOST_CHECK(all_inside(cubic1));
+    BOOST_CHECK(cubic0 != cubic1);
+}
+
+BOOST_AUTO_TEST_CASE(fill_cache_lru)
+{
+    PolygonD polyd;
+    polyd.emplace_back(Point2D{ 0.0, 0.0 });
+    polyd.emplace_back(Point2D{ 100.0, 0.0 });
+    polyd.emplace_back(Point2D{ 100.0, 100.0 });
+    polyd.emplace_back(Point2D{ 0.0, 100.0 });
+    auto poly = Polygons{ Integerization(polyd) };
+
+    FillCache cache(2);
+    auto first = cache.ZigzagFill(poly, 5.0, 45.0, 1.0);
+    auto second = cache.ZigzagFill(poly, 5.0, 45.0, 1.0);
+    BOOST_CHECK(first == second);
+    BOOST_CHECK(first == ZigzagFill(poly, 5.0, 45.0, 1.0));
+
+    // different parameters are a different entry
+    cache.ZigzagFill(poly, 5.0, 0.0, 1.0);
+    cache.OffsetFill(poly, 5.0);
+    auto stats = cache.Stats();
+    BOOST_CHECK_EQUAL(stats.hits, 1);
+    BOOST_CHECK_EQUAL(stats.misses, 3);
+    BOOST_CHECK_EQUAL(stats.entries, 2);
+    BOOST_CHECK_EQUAL(stats.evictions, 1);
+    BOOST_CHECK_CLOSE(stats.HitRate(), 0.25, 1e-9);
+
+    // the 45 degree fill was the least recently used one and got evicted
+    cache.ZigzagFill(poly, 5.0, 45.0, 1.0);
+    BOOST_CHECK_EQUAL(cache.Stats().misses, 4);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Stats().entries, 0);
+}
+
+BOOST_AUTO_TEST_CASE(travel_minimizing_order)
+{
+    // line fill of two islands far apart, emitted alternating between them
+    Polygons lines;
+    for (int i = 0; i < 50; ++i)
+    {
+        int64_t x = (i % 2 == 0 ? 0 : 100000000) + (i / 2) * 1000000;
+        lines.push_back(Polygon{ Point2{ x, int64_t{ 0 } }, Point2{ x, int64_t{ 10000000 } } });
+    }
+    lines.push_back(Polygon{});
+
+    PathOrderOptions options;
+    PathOrderStats stats;
+    auto ordered = OrderPaths(lines, options, &stats);
+    BOOST_REQUIRE_EQUAL(ordered.size(), 50u);
+    BOOST_CHECK_LT(stats.travelAfter, stats.travelBefore * 0.1);
+    // alternating directions turn the lines into a zigzag
+    BOOST_CHECK_GT(stats.reversed, 0u);
+    // every path is kept, possibly reversed
+    for (const auto& path : lines)
+    {
+        if (path.empty()) continue;
+        Polygon reversed(path.rbegin(), path.rend());
+        BOOST_CHECK(std::count(ordered.begin(), ordered.end(), path) + std::count(ordered.begin(), ordered.end(), reversed) == 1);
+    }
+
+    // 2-opt only ever shortens the greedy tour
+    options.twoOptBudgetMs = 50.0;
+    PathOrderStats improved;
+    OrderPaths(lines, options, &improved);
+    BOOST_CHECK_LE(improved.travelAfter, stats.travelAfter + 1e-6);
+
+    // without reversal every path keeps its direction
+    options.allowReverse = false;
+    PathOrderStats forward;
+    for (const auto& path : OrderPaths(lines, options, &forward))
+        BOOST_CHECK_LT(path.front().y, path.back().y);
+    BOOST_CHECK_EQUAL(forward.reversed, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(bulk_integerization)
+{
+    // odd lengths, exact ties and negative values must round like Point64 does
+    PolygonsD polysD{
+        PolygonD{ Point2D{ 2.5e-6, -2.5e-6 }, Point2D{ 0.0000015, -0.0000015 }, Point2D{ 123.4567891, -98.7654321 } },
+        PolygonD{},
+        PolygonD{ Point2D{ -1e6, 1e6 }, Point2D{ 1e12, -1e12 } } };
+    Polygons polys;
+    Integerization(polysD, polys);
+    BOOST_REQUIRE_EQUAL(polys.size(), polysD.size());
+    for (size_t i = 0; i < polysD.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(polys[i].size(), polysD[i].size());
+        for (size_t j = 0; j < polysD[i].size(); ++j)
+        {
+            Point2 expect{ polysD[i][j].x * integerization, polysD[i][j].y * integerization };
+            BOOST_CHECK(polys[i][j] == expect);
+        }
+    }
+    BOOST_CHECK(Integerization(polysD) == polys);
+
+    PolygonsD back;
+    UnIntegerization(polys, back);
+    BOOST_REQUIRE_EQUAL(back.size(), polys.size());
+    for (size_t i = 0; i < polys.size(); ++i)
+    {
+        for (size_t j = 0; j < polys[i].size(); ++j)
+        {
+            BOOST_CHECK_EQUAL(back[i][j].x, polys[i][j].x / integerization);
+            BOOST_CHECK_EQUAL(back[i][j].y, polys[i][j].y / integerization);
+        }
+    }
+
+    // converting into the same buffer again does not reallocate
+    const auto* data = polys[0].data();
+    Integerization(polysD, polys);
+    BOOST_CHECK_EQUAL(polys[0].data(), data);
+}
+
+// a grid of 64 square islands
+static Polygons IslandGrid()
+{
+    Polygons layer;
+    for (int i = 0; i < 64; ++i)
+    {
+        double x = (i % 8) * 20000.0, y = (i / 8) * 20000.0;
+        layer.push_back(Integerization(PolygonD{ Point2D{ x, y }, Point2D{ x + 10000.0, y },
+            Point2D{ x + 10000.0, y + 10000.0 }, Point2D{ x, y + 10000.0 } }));
+    }
+    return layer;
+}
+
+BOOST_AUTO_TEST_CASE(arena_scratch_fill)
+{
+    const Polygons layer = IslandGrid();
+
+    // the same island gives the same paths whatever the temporaries are allocated from
+    std::pmr::monotonic_buffer_resource arena;
+    Polygons island{ layer.front() };
+    BOOST_CHECK(ZigzagFill(island, 100.0, 30.0, 50.0) == ZigzagFill(island, 100.0, 30.0, 50.0, &arena));
+    BOOST_CHECK(SimpleZigzagFill(island, 100.0, 30.0, 50.0) == SimpleZigzagFill(island, 100.0, 30.0, 50.0, &arena));
+    BOOST_CHECK(LineFill(island, 100.0, 30.0, 50.0) == LineFill(island, 100.0, 30.0, 50.0, &arena));
+    arena.release();
+
+    // release() rewinds the thread arena to its fixed first block instead of freeing it
+    auto& local = ThreadLocalArena();
+    void* first = local.allocate(64, alignof(std::max_align_t));
+    local.release();
+    BOOST_CHECK_EQUAL(local.allocate(64, alignof(std::max_align_t)), first);
+    local.release();
+
+    ThreadPool pool(4);
+    const Polygons heapResult = MultiIslandFill(layer,
+        [](const Polygons& p) { return ZigzagFill(p, 100.0, 30.0, 50.0); }, &pool);
+    BOOST_CHECK(!heapResult.empty());
+    BOOST_CHECK(MultiIslandFill(layer, FillMode::Zigzag, 100.0, 30.0, 50.0, &pool) == heapResult);
+}
+
+// timing only, run it explicitly with --run_test=arena_fill_benchmark
+BOOST_AUTO_TEST_CASE(arena_fill_benchmark, *boost::unit_test::disabled())
+{
+    const Polygons layer = IslandGrid();
+    ThreadPool pool(4);
+    auto timed = [&](const IslandFillFunc& fill, Polygons& out) {
+        auto start = std::chrono::steady_clock::now();
+        for (int rep = 0; rep < 4; ++rep) out = MultiIslandFill(layer, fill, &pool);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    Polygons heapResult, arenaResult;
+    double heapMs = timed([](const Polygons& p) { return ZigzagFill(p, 100.0, 30.0, 50.0); }, heapResult);
+    double arenaMs = timed([](const Polygons& p) {
+        auto& local = ThreadLocalArena();
+        auto res = ZigzagFill(p, 100.0, 30.0, 50.0, &local);
+        local.release();
+        return res;
+        }, arenaResult);
+    BOOST_TEST_MESSAGE("zigzag fill of 64 islands x4 on 4 threads: default allocator " << heapMs << " ms, arena " << arenaMs << " ms");
+    BOOST_CHECK(heapResult == arenaResult);
+}
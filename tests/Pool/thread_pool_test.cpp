@@ -2,6 +2,8 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <vector>
 
 #include "base/thread_pool.hpp"
 #include "base/coroutine.hpp"
@@ -32,6 +34,44 @@ BOOST_AUTO_TEST_CASE(thread_pool_normal)
     BOOST_CHECK_EQUAL(counter.load(std::memory_order_relaxed), 3);
 }
 
+BOOST_AUTO_TEST_CASE(thread_pool_run_ordered)
+{
+    ThreadPool pool(3);
+    std::vector<size_t> order;
+    RunOrdered(pool, 50, 4, [](size_t i) { return i * i; },
+        [&order](size_t i, size_t square) {
+            BOOST_CHECK_EQUAL(square, i * i);
+            order.push_back(i);
+        });
+    BOOST_REQUIRE_EQUAL(order.size(), 50u);
+    for (size_t i = 0; i < order.size(); ++i) BOOST_CHECK_EQUAL(order[i], i);
+
+    // a throwing task: the results before it are consumed, the error is rethrown as it was and
+    // every task already submitted has finished by then
+    std::atomic<int> running{ 0 };
+    std::atomic<int> started{ 0 };
+    order.clear();
+    auto produce = [&](size_t i) {
+        ++running;
+        ++started;
+        std::this_thread::sleep_for(std::chrono::milliseconds(i % 3));
+        --running;
+        if (i == 5) throw OutOfRangeError("task 5");
+        return i;
+    };
+    BOOST_CHECK_THROW(RunOrdered(pool, 50, 4, produce, [&order](size_t i, size_t) { order.push_back(i); }),
+        OutOfRangeError);
+    BOOST_CHECK_EQUAL(running.load(), 0);
+    BOOST_CHECK_EQUAL(order.size(), 5u);
+    BOOST_CHECK_LE(started.load(), 5 + 4);
+
+    // a throwing consumer waits for the tasks as well
+    running = 0;
+    BOOST_CHECK_THROW(RunOrdered(pool, 50, 4, produce,
+        [](size_t, size_t) { throw RuntimeError("consume"); }), RuntimeError);
+    BOOST_CHECK_EQUAL(running.load(), 0);
+}
+
 #ifdef HSBA_ENABLE_THREAD_POOL_COROUTINE
 BOOST_AUTO_TEST_CASE(thread_pool_coroutine)
 {